@@ -0,0 +1,86 @@
+#pragma once
+
+#include <stdint.h>
+
+// 延迟预算：每条控制路径声明允许的最长耗时，由软件期限监视和硬件看门狗两层执行，超了按该路径的逃生动作处理。
+// 路径分两类：
+//   代码路径（us）：loop() 里的后台工作、一次控制步，按每次执行的耗时计。后台超时下一轮不发遥测；
+//     控制步超时由 controlDue() 丢拍、航位推算补推（见 control.h、odometry.h）。
+//     整轮 loop() 卡住 BUDGET_WDT_MS 没回来，看门狗中断记下卡在哪条路径，再过一个周期复位。
+//   动作路径（ms）：代替原来阻塞 while 循环的动作序列（跨 gap 直行、绕障、丢线搜索），从开始计到结束，
+//     main.cpp 的期限监视发现超过预算就放弃该动作，执行逃生动作（见 README）。
+//
+// 每次上电算一轮：本轮各路径见过的最长耗时、超时次数写进 EEPROM 的两个槽之一，上电换槽，
+// 所以断电重开（包括插 USB）以后上一轮的记录还在。看门狗复位不换槽，接着记同一轮并计一次复位。
+// 串口 'b' 打印本轮和上一轮的记录。写 EEPROM 同 lap.h：走掩码队列，每轮最多写一个字节，不阻塞。
+//
+// EEPROM 布局（从 BUDGET_EEPROM_BASE 起，紧接圈学习记录区）：'B' 'G' 版本 当前槽（bit1 表示另一槽有效），之后两个槽，
+// 每槽：看门狗复位次数、最后一次复位时的路径，再每条路径 最长耗时lo 最长耗时hi 超时次数。
+
+enum BudgetPath : uint8_t {
+  BUDGET_BACKGROUND, // loop() 里控制步之前的后台工作（测距、扫描器、遥测、EEPROM），us
+  BUDGET_CONTROL,    // 一次控制步（含电机输出、航位推算），us
+  BUDGET_GAP,        // 跨 gap 直行到重新压线，ms
+  BUDGET_BYPASS,     // 绕障从停车扫描到回到巡线，ms
+  BUDGET_SEARCH,     // 丢线搜索到重新压线，ms
+  BUDGET_COUNT
+};
+
+const uint8_t BUDGET_NONE = 0xFF;
+
+#ifndef BUDGET_BACKGROUND_US
+#define BUDGET_BACKGROUND_US 500   // 后台超过半个节拍，控制步就可能赶不上下一拍
+#endif
+#ifndef BUDGET_CONTROL_US
+#define BUDGET_CONTROL_US 800      // 控制步加上后台不能超过一个节拍（control.h）
+#endif
+#ifndef BUDGET_GAP_MS
+#define BUDGET_GAP_MS 2500         // 仿真里最长约 1.4 s
+#endif
+#ifndef BUDGET_BYPASS_MS
+#define BUDGET_BYPASS_MS 6000      // 仿真里约 3 s
+#endif
+#ifndef BUDGET_SEARCH_MS
+#define BUDGET_SEARCH_MS 4000      // 仿真里急弯最长约 2.3 s
+#endif
+#ifndef BUDGET_WDT_MS
+#define BUDGET_WDT_MS 120          // 看门狗周期：15/30/60/120/250/500/1000
+#endif
+
+const uint16_t BUDGET_EEPROM_BASE = 262;  // lap.h：LAP_EEPROM_BASE + 6 字节头 + LAP_MAX_BYTES
+const uint8_t BUDGET_VERSION = 1;
+const unsigned long BUDGET_SAVE_MS = 1000; // 新的记录攒这么久再写，免得峰值爬升时反复写同一格
+
+uint16_t budgetLimit(uint8_t path);
+
+// setup() 最先调用：看门狗复位后接着本轮记录，否则换槽开始新一轮；然后开看门狗
+void budgetBegin();
+
+// 每轮 loop() 开头调用：喂狗
+void budgetFeed();
+
+// 进入一条代码路径，看门狗中断把它当作卡住的地方
+void budgetEnter(uint8_t path);
+
+// 记一次耗时（代码路径 us、动作路径 ms，超过 65535 按 65535 记），超过预算计一次超时并返回 true
+bool budgetRecord(uint8_t path, unsigned long value);
+
+// 动作路径：开始计时（已在计时则重新开始）、正常结束记入耗时、中途取消不记
+void budgetStart(uint8_t path, unsigned long nowMs);
+void budgetStop(uint8_t path, unsigned long nowMs);
+void budgetCancel(uint8_t path);
+bool budgetRunning(uint8_t path);
+
+// 期限监视：正在计时且超过预算时记一次超时、停止计时并返回 true，调用方执行逃生动作
+bool budgetExpired(uint8_t path, unsigned long nowMs);
+
+uint16_t budgetWorst(uint8_t path);    // 本轮最长耗时
+uint8_t budgetOverruns(uint8_t path);  // 本轮超时次数（到 255 为止）
+uint8_t budgetResets();                // 本轮看门狗复位次数
+uint8_t budgetResetPath();             // 最后一次看门狗复位时的路径，没有为 BUDGET_NONE
+
+// 每轮调用，写一个待写的 EEPROM 字节
+void budgetService(unsigned long nowMs);
+
+// 串口 'b'：打印本轮和上一轮（EEPROM 另一个槽）的记录
+void budgetDump();
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stdint.h>
+
+// 闭环绕障：停车后用扫描器扫一遍前方，得到障碍的“角度-距离”剖面，
+// 据此选绕行侧和贴墙距离；绕行时按侧向测距做比例控制，保持距离直到重新压线。
+// 角度一律相对舵机正前（90 度），正值偏左。以“障碍在车左侧、从右边绕”为基准，
+// 另一侧由动作调度左右镜像。
+
+const uint8_t BYPASS_SCAN_STEPS = 5;
+extern const int8_t BYPASS_SCAN_ANGLES[BYPASS_SCAN_STEPS]; // PROGMEM：-30 -15 0 15 30
+
+const int BYPASS_FOLLOW_ANGLE = 55;     // 贴墙时舵机朝障碍一侧的偏角
+
+const int BYPASS_EDGE_CM = 15;     // 与最近点相差在此以内的方向算作障碍本体
+const int BYPASS_TARGET_MIN = 15;  // 贴墙距离（cm）下限，车身半宽加余量
+const int BYPASS_TARGET_MAX = 30;
+const int BYPASS_ACQUIRE_CM = 10;  // 转向时测到 目标+此值 以内即认为对准了障碍侧面
+const int BYPASS_LOST_CM = 25;     // 超过 目标+此值 认为已绕过，按固定弧线往回切
+const int BYPASS_KP = 5;           // PWM / cm
+const int BYPASS_STEER_MAX = 70;
+const int BYPASS_STEER_LOST = 25;  // 丢失障碍后朝障碍侧回切的转向量
+
+struct BypassPlan {
+  bool mirror;      // true：障碍在右，从左边绕
+  int16_t nearCm;   // 扫描到的最近距离，没扫到为 RANGE_FAR_CM
+  int16_t widthCm;  // 障碍横向宽度估计
+  int16_t targetCm; // 贴墙距离
+};
+
+// 预先给定下一次绕障的规划（例如圈学习记下的）：下一次不扫描，舵机直接转到贴墙角度
+void bypassPreset(bool mirror, int16_t targetCm);
+
+// 开始扫描；剖面对称时按 preferMirror 选侧
+void bypassScanBegin(bool preferMirror, unsigned long nowMs);
+// 每轮调用，扫完并生成规划时返回 true
+bool bypassScanTick();
+
+const BypassPlan &bypassPlan();
+int16_t bypassProfile(uint8_t i);
+
+// 贴墙转向量：> 0 表示转向障碍一侧
+int16_t bypassSteer(long cm);
+// 转向过程中是否已经从侧面看到障碍
+bool bypassWallSeen();
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stdint.h>
+
+// 固定频率控制节拍：Timer2 CTC 中断按 CONTROL_HZ 触发，中断里只采样巡线头（一次端口读）并计数。
+// loop() 先做后台工作（测距、扫描器、遥测、EEPROM），controlDue() 为真时再跑一次控制步
+// （巡线判断、转向输出、动作推进、赛程），所以巡线采样和转向更新的间隔是固定的，
+// 各种以 ms 计的阈值都以这个节拍为采样时钟，不再随 loop 耗时抖动。
+// 一次控制步没赶上下一个节拍（后台或控制步本身超时）就记一次超时，丢掉的节拍不补跑。
+// Timer2 被占用：D3、D11 不能再用 analogWrite，也不能用 tone()。
+
+#ifndef CONTROL_HZ
+#define CONTROL_HZ 1000
+#endif
+
+static_assert(CONTROL_HZ >= 500 && CONTROL_HZ <= 2000, "CONTROL_HZ 取 500~2000");
+
+// Timer2 计数时钟：>= 1kHz 用 64 分频（250kHz），再低用 128 分频（125kHz），OCR2A 都在 8 位内
+const uint32_t CONTROL_TIMER_HZ = CONTROL_HZ >= 1000 ? 250000UL : 125000UL;
+const uint8_t CONTROL_OCR = (uint8_t)(CONTROL_TIMER_HZ / CONTROL_HZ - 1);
+const uint32_t CONTROL_PERIOD_US = 1000000UL * (CONTROL_OCR + 1) / CONTROL_TIMER_HZ; // 实际周期
+
+// 在中断里调用的采样函数，返回这一刻的输入快照
+typedef uint8_t (*ControlSampler)();
+
+void controlBegin(ControlSampler sampler);
+
+// 有新节拍时返回 true（每个节拍只返回一次）；距上次超过一个节拍时计入超时
+bool controlDue();
+
+uint8_t controlSample();      // 最近一个节拍采到的快照
+uint32_t controlTicks();      // 上电以来的节拍数
+uint16_t controlOverruns();   // 丢掉的节拍数（到 65535 为止）
+
+// Timer0 改了分频时代替 millis()/micros() 的时基（见 hal.h），controlBegin() 之前为 0。
+// micros 分辨率为 Timer2 的一个计数（4us 或 8us）。
+unsigned long controlMillis();
+unsigned long controlMicros();
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stdint.h>
+
+// 赛程脚本：整条赛道写成编译期常量的分段列表，每段说明做什么、何时结束、用多快的巡线速度。
+// 解释器只维护当前段下标和段内计数，主循环按当前段决定是否测障、是否跨 gap、是否在黑块停车。
+// 换赛道或调每段速度只改表，不动控制逻辑。
+
+enum SegmentKind : uint8_t {
+  SEG_FOLLOW,                // 巡线 ms 毫秒
+  SEG_FOLLOW_UNTIL_OBSTACLE, // 巡线并测障，前方出现障碍时结束
+  SEG_BYPASS_LEFT,           // 执行绕障动作（扫描选侧，剖面对称时障碍放左侧），完成后结束
+  SEG_BRIDGE_GAPS,           // 进段 ms 毫秒后开启跨 gap 直行，跨过 count 个 gap 后结束
+  SEG_STOP_ON_PAD,           // 巡线并检测大黑块，第 count 块时停车，赛程结束
+  SEG_FOLLOW_UNTIL_VTURN,    // 巡线直到过 count 个 V 弯
+};
+
+struct CourseSegment {
+  uint8_t kind;
+  uint8_t speed;  // 本段巡线基础速度
+  uint8_t count;
+  uint16_t ms;
+};
+
+enum CourseEvent : uint8_t {
+  CEV_OBSTACLE,     // 前方确认有障碍
+  CEV_BYPASS_DONE,  // 绕障动作结束
+  CEV_GAP_BRIDGED,  // 跨过一个 gap
+  CEV_PAD,          // 检测到一块大黑块
+  CEV_VTURN,        // 过了一个 V 弯
+};
+
+// segments 须放在 PROGMEM；当前段会复制一份到 RAM
+void courseBegin(const CourseSegment *segments, uint8_t count, uint8_t start, unsigned long nowMs);
+
+// 投递事件，满足当前段结束条件时前进到下一段
+void courseEvent(uint8_t ev, unsigned long nowMs);
+
+// 处理按时间结束的段，每轮调用
+void courseTick(unsigned long nowMs);
+
+const CourseSegment &courseSegment();
+uint8_t courseIndex();
+bool courseDone();
+
+// 当前段是否处于跨 gap 直行阶段
+bool courseBridging(unsigned long nowMs);
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "hal.h"
+#include "course.h"
+
+// ISRC 2025 决赛赛程：两次偏左绕障 -> 第二个障碍后 2.5s 开始跨两个 gap -> 过 V 弯 -> 终点黑块停车
+const CourseSegment COURSE[] PROGMEM = {
+  {SEG_FOLLOW_UNTIL_OBSTACLE, 110, 0, 0},
+  {SEG_BYPASS_LEFT,           110, 0, 0},
+  {SEG_FOLLOW_UNTIL_OBSTACLE, 110, 0, 0},
+  {SEG_BYPASS_LEFT,           110, 0, 0},
+  {SEG_BRIDGE_GAPS,           110, 2, 2500},
+  // V 弯顶点两灯也会压黑：冲出顶点丢线算过了 V 弯，之后才检测终点黑块
+  {SEG_FOLLOW_UNTIL_VTURN,    110, 1, 0},
+  {SEG_STOP_ON_PAD,           110, 1, 0},
+};
+
+const uint8_t COURSE_LEN = sizeof(COURSE) / sizeof(COURSE[0]);
+
+// 从第几段开始：调试后面的段时用 -DCOURSE_START=n 跳过前面的段，板上比赛保持 0
+#ifndef COURSE_START
+#define COURSE_START 0
+#endif
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "hal.h"
+
+// 直接操作端口寄存器的 GPIO：引脚号在编译期解析成 PORTx/PINx 与位掩码，
+// 每次读写编译成一两条 sbi/cbi/in 指令，省掉 digitalRead/analogWrite 的查表开销。
+// 引脚编号按 Uno（ATmega328P）：D0~D7 -> PORTD，D8~D13 -> PORTB，A0~A5 -> PORTC。
+// 主机编译时退回到 hal 的 digitalRead/analogWrite，接口不变。
+
+#ifdef ARDUINO
+
+template <uint8_t Pin>
+struct FastPin {
+  static_assert(Pin < 20, "FastPin 只支持 Uno 的 D0~D13、A0~A5");
+
+  static constexpr uint8_t bit = Pin < 8 ? Pin : (Pin < 14 ? Pin - 8 : Pin - 14);
+  static constexpr uint8_t mask = 1 << bit;
+  static constexpr uint8_t port = Pin < 8 ? 'D' : (Pin < 14 ? 'B' : 'C');
+
+  static inline volatile uint8_t &out() { return Pin < 8 ? PORTD : (Pin < 14 ? PORTB : PORTC); }
+  static inline volatile uint8_t &in()  { return Pin < 8 ? PIND : (Pin < 14 ? PINB : PINC); }
+  static inline volatile uint8_t &ddr() { return Pin < 8 ? DDRD : (Pin < 14 ? DDRB : DDRC); }
+
+  static inline void output() { ddr() |= mask; }
+  static inline void input()  { ddr() &= (uint8_t)~mask; }
+  static inline void high()   { out() |= mask; }
+  static inline void low()    { out() &= (uint8_t)~mask; }
+  static inline void write(bool v) { if (v) high(); else low(); }
+  static inline bool read()   { return (in() & mask) != 0; }
+};
+
+// 同一端口上的两个输入一次 PIN 读取，得到同一时刻的快照
+template <uint8_t PinA, uint8_t PinB>
+struct FastPinPair {
+  static_assert(FastPin<PinA>::port == FastPin<PinB>::port, "两个引脚必须在同一端口");
+
+  static constexpr uint8_t maskA = FastPin<PinA>::mask;
+  static constexpr uint8_t maskB = FastPin<PinB>::mask;
+
+  static inline uint8_t read() { return FastPin<PinA>::in(); }
+};
+
+// Timer0 硬件 PWM（D5 = OC0B，D6 = OC0A），直接写 OCR0x。
+// 与 analogWrite 一致：0 和 255 断开比较输出改为纯电平，避免 fast PWM 在 0 时的毛刺。
+template <uint8_t Pin>
+struct FastPwm {
+  static_assert(Pin == 5 || Pin == 6, "FastPwm 只支持 Timer0 的 D5/D6");
+
+  static constexpr uint8_t com = Pin == 6 ? _BV(COM0A1) : _BV(COM0B1);
+
+  static inline volatile uint8_t &ocr() { return Pin == 6 ? OCR0A : OCR0B; }
+
+  static inline void write(uint8_t v) {
+    if (v == 0) {
+      TCCR0A &= (uint8_t)~com;
+      FastPin<Pin>::low();
+    } else if (v == 255) {
+      TCCR0A &= (uint8_t)~com;
+      FastPin<Pin>::high();
+    } else {
+      ocr() = v;
+      TCCR0A |= com;
+    }
+  }
+};
+
+#else
+
+template <uint8_t Pin>
+struct FastPin {
+  static constexpr uint8_t bit = Pin < 8 ? Pin : (Pin < 14 ? Pin - 8 : Pin - 14);
+  static constexpr uint8_t mask = 1 << bit;
+  static constexpr uint8_t port = Pin < 8 ? 'D' : (Pin < 14 ? 'B' : 'C');
+
+  static inline void output() { pinMode(Pin, OUTPUT); }
+  static inline void input()  { pinMode(Pin, INPUT); }
+  static inline void high()   { digitalWrite(Pin, HIGH); }
+  static inline void low()    { digitalWrite(Pin, LOW); }
+  static inline void write(bool v) { digitalWrite(Pin, v ? HIGH : LOW); }
+  static inline bool read()   { return digitalRead(Pin) == HIGH; }
+};
+
+template <uint8_t PinA, uint8_t PinB>
+struct FastPinPair {
+  static constexpr uint8_t maskA = FastPin<PinA>::mask;
+  static constexpr uint8_t maskB = FastPin<PinB>::mask;
+
+  static inline uint8_t read() {
+    return (FastPin<PinA>::read() ? maskA : 0) | (FastPin<PinB>::read() ? maskB : 0);
+  }
+};
+
+template <uint8_t Pin>
+struct FastPwm {
+  static inline void write(uint8_t v) { analogWrite(Pin, v); }
+};
+
+#endif
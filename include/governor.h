@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stdint.h>
+
+#ifdef TUNED_PARAMS
+#include "tuned_params.h"
+#endif
+
+// 自适应巡线速度。两路数字巡线头在直道上是左右交替压线的小幅摆动：每次单侧压线都很短，
+// 且 lastDir 每次都翻转。只要一直保持这种“居中”摆动，就从赛程段速度逐步加到 GOV_TOP_SPEED；
+// 一旦同一侧连续压线（lastDir 不翻转，说明线在持续往一边偏，即弯道）、单侧压线拖长（PD 误差
+// 开始往 ±2 爬，转向快饱和）或双黑，就立刻把目标刹回段速度。
+// 速度变化按周期限幅，加速慢、减速快，避免打滑。
+
+#ifndef GOV_TOP_SPEED
+#define GOV_TOP_SPEED 200
+#endif
+
+const unsigned long GOV_PERIOD_MS = 10;
+const uint8_t GOV_ACCEL = 2;               // 每周期最多加 2 PWM（200 PWM/s）
+const uint8_t GOV_DECEL = 10;              // 每周期最多减 10 PWM
+const unsigned long GOV_STABLE_MS = 250;   // 稳定这么久才开始加速
+const uint8_t GOV_RAMP_SHIFT = 10;         // 再稳定 1024ms 目标到顶
+const unsigned long GOV_CURVE_STABLE_MS = GOV_STABLE_MS + 512; // 直行这么久后的弯道才算值得记的弯道起点
+const unsigned long GOV_BRAKE_MS = 100;     // 每次外部减速要求的持续时间
+const unsigned long GOV_BRAKE_HOLD_MS = 180; // 单侧压线超过此时长视为进弯（直道摆动约 120ms）
+
+// 段速度变化或动作结束后调用，从 speed 重新开始
+void governorReset(int speed, unsigned long nowMs);
+
+// 每轮在 lineFollow 之前调用（lastDir 还是上一次压线的方向），返回本轮巡线基础速度
+int governorUpdate(uint8_t valL, uint8_t valR, int8_t lastDir, unsigned long nowMs, int base);
+
+// 外部要求减速（前方有障碍、已知弯道将到）：GOV_BRAKE_MS 内目标不超过 cap（至少为段速度），
+// 按减速限幅降下来；不打断稳定计时，减速要求撤掉后直接回到原来的加速曲线
+void governorBrake(unsigned long nowMs, int cap = 0);
+
+// 本轮是否刚从稳定直行进入弯道：-1 左弯、1 右弯、0 否（不受 governorBrake 影响）
+int8_t governorCurveStart();
+
+int governorSpeed();
@@ -0,0 +1,34 @@
+#pragma once
+
+// 硬件抽象层：固件只通过这里拿到 Arduino 接口（digitalRead、analogWrite、millis、
+// delay、pulseIn、Servo、EEPROM、PROGMEM 等）。板上编译直接用 Arduino 核心；主机（native）编译换成
+// hal_native.h 的同名实现，由仿真器或测试驱动，控制代码本身不用改。
+
+#ifdef ARDUINO
+
+#include <Arduino.h>
+#include <Servo.h>
+#include <avr/eeprom.h>
+#include <avr/pgmspace.h>
+#include <util/atomic.h>
+
+// 与中断共享的多字节变量读写
+#define HAL_ATOMIC ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+
+// 电机 PWM 改了 Timer0 分频（见 motor.h）时，核心的 millis()/micros() 不再准，
+// 改由控制节拍（Timer2）计时；核心的 delay() 也跟着失效，固件里不要用。
+#if defined(MOTOR_PWM_HZ) && MOTOR_PWM_HZ != 976
+#define HAL_T2_TIMEBASE
+unsigned long controlMillis();
+unsigned long controlMicros();
+#define millis() controlMillis()
+#define micros() controlMicros()
+#endif
+
+#else
+
+#include "hal_native.h"
+
+#define HAL_ATOMIC
+
+#endif
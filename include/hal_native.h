@@ -0,0 +1,147 @@
+#pragma once
+
+// 主机端的 Arduino 接口替身，只覆盖固件用到的部分。
+// 时间是虚拟的：delay()/delayMicroseconds() 和 halsim::spend() 推进时钟，
+// 推进过程中由 halsim::Backend（仿真器）更新输入引脚、投递引脚变化回调。
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+using std::abs;
+
+typedef uint8_t byte;
+
+#define HIGH 0x1
+#define LOW 0x0
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+const uint8_t A0 = 14;
+const uint8_t A1 = 15;
+const uint8_t A2 = 16;
+const uint8_t A3 = 17;
+const uint8_t A4 = 18;
+const uint8_t A5 = 19;
+
+const uint8_t HAL_NUM_PINS = 20;
+
+#define F(s) (s)
+
+// 主机上没有单独的程序存储器，PROGMEM 表就是普通常量
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+#define memcpy_P memcpy
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+void analogWrite(uint8_t pin, int val);
+int analogRead(uint8_t pin);
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+unsigned long pulseIn(uint8_t pin, uint8_t state, unsigned long timeout = 1000000UL);
+
+inline void interrupts() {}
+inline void noInterrupts() {}
+
+// 代替板上的引脚变化中断：输入电平变化时调用 handler（相当于 ISR）
+void attachPinChange(uint8_t pin, void (*handler)());
+
+// 代替板上的定时器比较中断：虚拟时间每走过 periodUs 调用一次 handler，periodUs 为 0 时停止
+void attachTimer(unsigned long periodUs, void (*handler)());
+
+// EEPROM：avr/eeprom.h 的子集，地址用指针表示。写一个字节约 3.3ms 内 eeprom_is_ready() 为假，
+// 未就绪时再写会像板上一样等到就绪（推进虚拟时间）
+#define E2END 0x3FF
+
+uint8_t eeprom_read_byte(const uint8_t *addr);
+void eeprom_update_byte(uint8_t *addr, uint8_t value);
+bool eeprom_is_ready();
+
+class Servo {
+public:
+  uint8_t attach(int pin);
+  void detach();
+  void write(int angle);
+  int read();
+  bool attached();
+
+private:
+  int8_t pin_ = -1;
+};
+
+class HardwareSerial {
+public:
+  void begin(unsigned long baud);
+  int available();
+  int read();
+  int availableForWrite();
+  size_t write(uint8_t b);
+  size_t write(const uint8_t *buf, size_t len);
+  size_t print(const char *s);
+  size_t print(char c);
+  size_t print(long v);
+  size_t print(unsigned long v);
+  size_t print(int v) { return print((long)v); }
+  size_t print(unsigned int v) { return print((unsigned long)v); }
+  size_t println();
+  size_t println(const char *s);
+  size_t println(long v);
+  size_t println(unsigned long v);
+  size_t println(int v) { return println((long)v); }
+  size_t println(unsigned int v) { return println((unsigned long)v); }
+  void flush() {}
+  explicit operator bool() const { return true; }
+};
+
+extern HardwareSerial Serial;
+
+namespace halsim {
+
+class Backend {
+public:
+  virtual ~Backend() {}
+  // 把世界推进到 toUs；期间可以用 setNow()/setInput() 投递中途发生的事件
+  virtual void advance(unsigned long long toUs) = 0;
+  // 固件写了输出引脚（analog 为 true 时 value 是 PWM 占空比）
+  virtual void pinWritten(uint8_t pin, int value, bool analog) { (void)pin; (void)value; (void)analog; }
+  // 返回输入引脚此刻的电平；返回 -1 表示使用 setInput() 设置的值
+  virtual int pinLevel(uint8_t pin) { (void)pin; return -1; }
+  // 返回 analogRead() 的读数（0~1023）；返回 -1 表示按数字电平给 0 或 1023
+  virtual int analogLevel(uint8_t pin) { (void)pin; return -1; }
+};
+
+void setBackend(Backend *backend);
+
+unsigned long long now();
+void setNow(unsigned long long us);
+// 模拟一段代码执行耗时，按虚拟时间推进
+void spend(unsigned long us);
+
+void setInput(uint8_t pin, int level);
+int output(uint8_t pin);
+int pwm(uint8_t pin);
+int servoAngle();
+
+// Serial 替身：输出可转给回调（默认丢弃），输入由 feedSerial() 注入
+void setSerialSink(void (*sink)(const uint8_t *buf, size_t len));
+void feedSerial(const char *data, size_t len);
+
+// EEPROM 内容与文件互存，仿真多次运行之间保留（学习 -> 比赛）；文件不存在时 load 返回 false
+bool loadEeprom(const char *path);
+bool saveEeprom(const char *path);
+
+// 清空所有引脚、时钟、回调，EEPROM 恢复为全 0xFF，测试之间复位用
+void reset();
+
+} // namespace halsim
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stdint.h>
+
+// 圈学习：赛道每次都一样，学习模式下把沿途事件（弯道起点、gap、黑块、障碍、绕障结果）
+// 按“距上一事件的时间差”压缩写进 EEPROM；比赛模式开机读回，按顺序对齐实际事件，
+// 提前知道下一个是什么、大约何时到，用作前馈：障碍前预减速、gap 前提前进入跨 gap 直行、
+// 已知障碍直接用学到的绕行侧和距离，省掉扫描（弯前限速见 main 的 LAP_CURVE_SPEED）。
+//
+// 模式：EEPROM 里有完整的记录（学到了终点黑块）就进比赛模式，否则学习；
+// 编译时加 -DLAP_RELEARN 或串口发 'l' 重新学习。
+//
+// EEPROM 布局（从 LAP_EEPROM_BASE 起）：'L' 'P' 版本 标志 长度lo 长度hi，之后是记录，标志见 LAP_COMPLETE。
+// 每条记录是一个变长整数 (时间差 >> LAP_TIME_SHIFT) << 3 | 事件类型，每字节低 7 位有效、
+// 最高位表示后面还有；LAP_BYPASS 之后再跟一个字节：bit7 镜像，低 7 位贴墙距离（cm）。
+// 写 EEPROM 走队列，每轮 lapService() 只在 eeprom_is_ready() 时写一个字节，不阻塞主循环。
+
+enum LapEvent : uint8_t {
+  LAP_CURVE_L,   // 稳定直行后进入左弯
+  LAP_CURVE_R,
+  LAP_GAP,
+  LAP_PAD,
+  LAP_OBSTACLE,  // 前方确认障碍
+  LAP_BYPASS,    // 绕障结束，带绕行规划
+};
+
+enum LapMode : uint8_t { LAP_LEARN, LAP_RACE };
+
+const uint16_t LAP_EEPROM_BASE = 0;
+const uint16_t LAP_MAX_BYTES = 256;     // 记录区上限，EEPROM 其余部分留给别的用途
+const uint8_t LAP_VERSION = 1;
+const uint8_t LAP_COMPLETE = 0x01;      // 头里的标志：学到了终点黑块
+const uint8_t LAP_TIME_SHIFT = 3;       // 时间差以 8ms 为单位
+const uint8_t LAP_QUEUE = 16;           // 待写字节队列
+const uint8_t LAP_RESYNC = 3;           // 事件对不上时最多往后找几条
+
+const unsigned long LAP_LEAD_MS = 400;  // 预计到达前多久开始前馈
+const unsigned long LAP_LATE_MS = 800;  // 过了预计时间多久仍没等到就不再前馈
+
+// 读 EEPROM 决定模式；学习模式会先把旧记录作废
+void lapBegin(unsigned long nowMs);
+uint8_t lapMode();
+
+// 串口 'l'：当场改回学习模式，旧记录随即作废，下次上电也从学习开始
+void lapRelearn(unsigned long nowMs);
+
+// 投递一个实际发生的事件：学习模式记录，比赛模式用来对齐
+void lapEvent(uint8_t ev, unsigned long nowMs, uint8_t extra = 0);
+
+// 每轮调用，写一个排队的 EEPROM 字节
+void lapService();
+
+// 比赛模式：下一条预期事件在 mask 里，且已进入 [预计 - leadMs, 预计 + LAP_LATE_MS]
+bool lapExpect(uint8_t mask, unsigned long nowMs, unsigned long leadMs = LAP_LEAD_MS);
+
+// 比赛模式：下一条预期事件是 LAP_BYPASS 时取出它的附加字节
+bool lapBypassPlan(uint8_t &extra);
+
+uint16_t lapLength(); // 已记录/已读入的字节数
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <stdint.h>
+
+// 模拟巡线模式（build_flags 加 -DLINE_ANALOG）：给带模拟输出的巡线模块用。
+// ADC 自由运行，转换完成中断里轮流采两路（左对齐只取高 8 位），最新读数一直在共享变量里，
+// 控制步随取随用，不再有 analogRead() 的 100us 忙等。
+// 上电后每个读数都更新该路的最小/最大值（出发时扫过白底和黑框）。两路的差都够 LINE_ADC_MIN_SPAN 后
+// 再过 LINE_ADC_CAL_MS 冻结；出发后一直骑在线上没见过全黑的那一路，先直接用原始读数，直到第一次压线。
+// 归一化到 0~255（黑为 255）后两路加权得到连续的线位置，单位与 linepd.h 的误差一致（Q8.8）：
+//   两路读数相等为 0，线在一路正下方（另一路全白）为 ±1，两路都看不到线（丢线）按最后所在侧取 ±2。
+// valL/valR（gap、黑块检测、调速、轨迹记录）改由归一化读数与 LINE_ADC_BLACK 比较得到。
+// 开启后 ADC 被占用，analogRead() 不能再用；两路关掉数字输入，巡线头边沿队列（lineedge.h）不再使用。
+
+#ifndef LINE_ADC_PRESCALE
+#define LINE_ADC_PRESCALE 64   // 16MHz / 64 = 250kHz，每次转换 52us，两路各约 9.6kHz
+#endif
+#ifndef LINE_ADC_CAL_MS
+#define LINE_ADC_CAL_MS 2000   // 两路都标定到够用的范围后再继续标定的时长
+#endif
+#ifndef LINE_ADC_BLACK
+#define LINE_ADC_BLACK 128     // 归一化读数不低于此值算黑
+#endif
+#ifndef LINE_ADC_LOST
+#define LINE_ADC_LOST 40       // 两路归一化读数之和低于此值算丢线
+#endif
+
+static_assert(LINE_ADC_PRESCALE == 16 || LINE_ADC_PRESCALE == 32 || LINE_ADC_PRESCALE == 64 ||
+                  LINE_ADC_PRESCALE == 128,
+              "LINE_ADC_PRESCALE 取 16/32/64/128");
+
+const uint8_t LINE_ADC_MIN_SPAN = 96;  // 最大最小值相差不到此值（8 位原始读数）算没标定，直接用原始读数
+const int16_t LINE_ADC_SIDE_Q8 = 64;   // 位置超过 ±1/4 才改记所在侧
+
+// 标定范围换成归一化用的倍率（Q8），范围太小返回 0
+inline uint16_t lineAdcScale(uint8_t lo, uint8_t hi) {
+  if (hi < lo + LINE_ADC_MIN_SPAN) return 0;
+  uint8_t span = hi - lo;
+  return (uint16_t)((255U * 256U + span - 1) / span); // 向上取整，读数到 hi 时正好是 255
+}
+
+// 原始读数归一化到 0~255；scale 为 0（没标定）时原样返回
+inline uint8_t lineAdcNormalize(uint8_t raw, uint8_t lo, uint16_t scale) {
+  if (scale == 0) return raw;
+  if (raw <= lo) return 0;
+  uint32_t n = ((uint32_t)(raw - lo) * scale) >> 8;
+  return n > 255 ? 255 : (uint8_t)n;
+}
+
+// 两路归一化读数得到线位置（Q8.8，负为线在左）。side 为最后所在侧（-1/0/1），丢线时用它，其余时候更新它
+inline int16_t lineAdcPositionOf(uint8_t nL, uint8_t nR, int8_t &side) {
+  int16_t sum = (int16_t)nL + nR;
+  if (sum < LINE_ADC_LOST) return (int16_t)(side * 512);
+  int16_t p = (int16_t)(((int32_t)((int16_t)nR - nL) << 8) / sum);
+  if (p < -LINE_ADC_SIDE_Q8) side = -1;
+  else if (p > LINE_ADC_SIDE_Q8) side = 1;
+  return p;
+}
+
+#ifdef LINE_ANALOG
+
+// 两路必须在 A0~A5；开始自由运行并进入标定
+void lineAdcBegin(uint8_t pinL, uint8_t pinR);
+
+// 每个控制步调用一次：取最新读数，结束到时的标定，算出本步的快照和位置
+void lineAdcUpdate(unsigned long nowMs);
+
+uint8_t lineAdcSnapshot();   // bit0 左、bit1 右，黑为 1（同 lineSnapshot()）
+int16_t lineAdcPosition();   // 线位置，Q8.8
+bool lineAdcLost();          // 两路都看不到线
+int8_t lineAdcSide();        // 最后所在侧：-1 左、1 右、0 还不知道
+bool lineAdcCalibrating();
+
+#endif
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stdint.h>
+
+// 巡线头边沿队列：A0/A1 的引脚变化中断（经 pinchange.h 分发）把每次变化连同 micros() 时间戳
+// 推进一个单生产者/单消费者的无锁环形队列，控制步取出。控制节拍只在每拍开头采一次快照，
+// 两拍之间一闪而过的黑线（高速下压过细线、gap 边缘抖动）靠这里补上，
+// loop 在做什么（测距、遥测、EEPROM）都不影响。
+// 中断只写 head，主循环只写 tail，两边各读对方的下标，单字节读写本身是原子的，不用关中断。
+
+#ifndef LINE_EDGE_QUEUE
+#define LINE_EDGE_QUEUE 16
+#endif
+
+static_assert(LINE_EDGE_QUEUE >= 4 && LINE_EDGE_QUEUE <= 128 && (LINE_EDGE_QUEUE & (LINE_EDGE_QUEUE - 1)) == 0,
+              "LINE_EDGE_QUEUE 取 4~128 的 2 的幂");
+
+struct LineEdge {
+  unsigned long us;  // 变化发生的 micros()
+  uint8_t state;     // 变化后的快照，同 lineSnapshot()：bit0 左、bit1 右，黑为 1
+};
+
+// 登记两个巡线头引脚（必须在 A0~A5），清空队列
+void lineEdgeBegin(uint8_t pinL, uint8_t pinR);
+
+// 取出最旧的一个边沿，队列空返回 false
+bool lineEdgePop(LineEdge &e);
+
+// 队列满时丢掉的边沿数（到 65535 为止），说明控制步取得不够勤
+uint16_t lineEdgeDrops();
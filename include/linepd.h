@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stdint.h>
+
+#ifdef TUNED_PARAMS
+#include "tuned_params.h"
+#endif
+
+// 定点 PD（可选 I）巡线转向。误差与增益用 Q8.8，乘积为 Q16.16 后取整数 PWM，
+// 热路径里没有浮点。增益在编译期给定，可在 build_flags 里覆盖，例如 -DLINE_KP=32。
+//
+// 误差估计（负值表示线在左侧）：
+//   左黑右白 -> -1 起，保持越久越往 -2 靠（线在继续往外偏）
+//   左白右黑 -> +1 起，同理到 +2
+//   双黑     -> 0
+//   双白     -> 按 lastDir 记为 ±2（丢线），lastDir 为 0 时保持上一次误差
+
+#ifndef LINE_KP
+#define LINE_KP 35      // PWM / 单位误差
+#endif
+#ifndef LINE_KD
+#define LINE_KD 15      // PWM / (单位误差 / 采样周期)
+#endif
+#ifndef LINE_KI
+#define LINE_KI 0       // PWM / (单位误差 * 采样周期)，默认不用
+#endif
+
+const int16_t Q8_ONE = 256;
+
+const int16_t LINE_KP_Q8 = (int16_t)(LINE_KP * Q8_ONE);
+const int16_t LINE_KD_Q8 = (int16_t)(LINE_KD * Q8_ONE);
+const int16_t LINE_KI_Q8 = (int16_t)(LINE_KI * Q8_ONE);
+
+const unsigned long LINE_PD_PERIOD_MS = 5;   // 微分/积分的采样周期
+const unsigned long LINE_RAMP_MS = 120;      // 单侧压线从 ±1 爬到 ±2 的时间
+// held * 256 / LINE_RAMP_MS 改成乘倒数再 >>8，避免 32 位除法
+const uint16_t LINE_RAMP_RECIP = (Q8_ONE * 256UL + LINE_RAMP_MS - 1) / LINE_RAMP_MS;
+const uint8_t LINE_D_FILTER_SHIFT = 2;       // 微分一阶低通：每周期靠近 1/4
+const int32_t LINE_I_LIMIT_Q8 = 40L * Q8_ONE; // 积分项输出上限（PWM）
+
+void linePdReset();
+
+// 用本次采样更新误差估计并返回转向量 steer（PWM）：
+// 左轮 = base + steer，右轮 = base - steer；已按 minSpeed 和 255 饱和，两轮都不会低于 minSpeed。
+int16_t linePdUpdate(uint8_t valL, uint8_t valR, int8_t lastDir, unsigned long nowMs, int base, int minSpeed);
+
+// 同上，误差直接用测得的线位置（Q8.8，见 lineadc.h），不再按状态和持续时间估计
+int16_t linePdUpdatePosition(int16_t position, unsigned long nowMs, int base, int minSpeed);
+
+int16_t linePdError(); // 最近一次误差估计（Q8.8）
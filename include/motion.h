@@ -0,0 +1,71 @@
+#pragma once
+
+#include <stdint.h>
+
+// 协作式动作调度：一个动作是若干步骤的序列，每轮 loop() 只推进一次，
+// 步骤按时间或传感器条件结束，期间巡线采样、测距照常进行，不再用 delay() 阻塞。
+
+enum StepAct : uint8_t {
+  ACT_DRIVE,        // 以 left/right 的 PWM 行驶（负值反转）
+  ACT_HOLD,         // 保持当前电机输出不变
+  ACT_WALL_FOLLOW,  // 以 left 为基础速度，按侧向测距比例控制贴墙绕障（距离由 bypass 规划）
+  ACT_SKIP,         // cond 成立时跳过后面 arg 个步骤（用于分支）
+  ACT_BRAKE,        // 主动刹车（见 motor.h），按 ms 结束
+  ACT_SCAN,         // 停车扫描障碍剖面，扫完结束；之后的步骤按规划结果决定是否左右镜像，arg 非 0 表示剖面对称时从左边绕
+  ACT_TURN,         // 以 left 的 PWM 原地转到 基准航向 + right 度（左转为正），按航位推算的惯性余量提前收手
+  ACT_GO,           // 以 left 的 PWM 保持 基准航向 + right 度行驶，走满 arg cm 结束（0 不限）；给了基准直线时沿直线走
+};
+
+enum StepCond : uint8_t {
+  COND_NONE,            // 只按时间结束
+  COND_ALWAYS,
+  COND_ANY_BLACK,       // 任一侧压线
+  COND_ONE_SIDE,        // 恰好一侧压线
+  COND_NOT_LEFT_ONLY,   // 不再是“左黑右白”
+  COND_NOT_RIGHT_ONLY,  // 不再是“左白右黑”
+  COND_BOTH_WHITE,      // 双白，已离开黑线
+  COND_NOT_BOTH_WHITE,  // 不再双白
+  COND_LAST_NOT_LEFT,   // lastDir != -1
+  COND_LAST_NOT_RIGHT,  // lastDir != 1
+  COND_WALL_SEEN,       // 舵机到位后侧向测到障碍（贴墙距离 + 余量以内）
+};
+
+const int16_t SERVO_KEEP = -1;
+
+// ACT_GO 的航向保持：按预计停下来时的朝向算误差（补上电机惯性），比例转向
+const int16_t MOTION_HOLD_KP = 4;          // PWM / 度
+const int16_t MOTION_HOLD_STEER_MAX = 80;
+// 沿基准直线走：偏离 d cm 时航向朝直线多拐 d / MOTION_TRACK_LOOKAHEAD_CM 弧度，d 按 MOTION_TRACK_MAX_CM 限幅
+const int16_t MOTION_TRACK_LOOKAHEAD_CM = 20;
+const int16_t MOTION_TRACK_MAX_CM = 10;
+
+struct MotionStep {
+  uint8_t act;
+  uint8_t cond;      // 条件满足即结束本步骤（ACT_SKIP 时为跳转条件）
+  int16_t left;
+  int16_t right;
+  int16_t servo;     // 进入步骤时舵机角度，SERVO_KEEP 不动
+  uint16_t ms;       // 持续时间；带条件的步骤为超时，0 表示不超时
+  int16_t arg;
+};
+
+typedef void (*MotionDone)();
+
+// 镜像时 ACT_DRIVE/ACT_WALL_FOLLOW 左右轮互换，舵机角取 180 - servo，左右相关的条件互换，
+// ACT_TURN/ACT_GO 的航向偏移取反。
+
+// 开始执行一个动作序列（steps 须放在 PROGMEM），会顶替正在执行的动作；done 在最后一步结束时调用
+void motionStart(const MotionStep *steps, uint8_t count, MotionDone done = nullptr);
+
+// 每轮 loop 调用一次，返回动作是否仍在进行
+bool motionTick();
+
+bool motionBusy();
+void motionCancel();
+const MotionStep *motionSequence(); // 正在执行的序列，没有为 nullptr
+
+// ACT_TURN/ACT_GO 的基准航向（二进制角，见 odometry.h）。motionStart 时取当前车头朝向，
+// 之后可用 motionReference 换成别的（例如线方向）；motionTrack 再给一个直线上的点，
+// ACT_GO 就按巡线头偏离这条直线的距离修正航向，走到直线上再沿它走
+void motionReference(uint32_t heading);
+void motionTrack(int32_t x, int32_t y, uint32_t heading);
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <stdint.h>
+
+// 电机输出级：控制代码只给目标 PWM（负值反转），motorUpdate() 在每个控制节拍把实际输出
+// 按斜率逼近目标后写到引脚，不再从 190 一步跳到 0、从 0 一步跳到满速。
+//  - 斜率限制：整车从静止起步时每 ms 最多加 MOTOR_SLEW_UP，减到 0 时每 ms 最多减 MOTOR_SLEW_DOWN，
+//    换向先减到 0；轮子已在死区以上同向转动（巡线差速）时直接跟随，不给转向加滞后
+//  - 死区补偿：输出在 (0, MOTOR_DEADBAND) 之间时抬到 MOTOR_DEADBAND，电机低于此只响不转
+//  - 主动刹车：motorBrake() 按当前输出反向打一个短脉冲再归零（PWM + DIR 驱动没有短路刹车）
+//  - PWM 频率：MOTOR_PWM_HZ 选 Timer0 的分频，见下；改了以后 millis()/micros() 由 Timer2 计时（见 hal.h）
+
+// 接线：PWM 必须在 Timer0（D5 = OC0B，D6 = OC0A）
+const uint8_t MOTOR_L_PWM = 5;
+const uint8_t MOTOR_L_DIR = 7;
+const uint8_t MOTOR_R_PWM = 6;
+const uint8_t MOTOR_R_DIR = 4;
+
+// Timer0 PWM 频率：976（Arduino 默认，fast PWM /64）、7812（fast /8）、
+// 31250（phase-correct /1，听不到，推荐）、62500（fast /1，驱动芯片开关损耗大）
+#ifndef MOTOR_PWM_HZ
+#define MOTOR_PWM_HZ 976
+#endif
+
+static_assert(MOTOR_PWM_HZ == 976 || MOTOR_PWM_HZ == 7812 || MOTOR_PWM_HZ == 31250 || MOTOR_PWM_HZ == 62500,
+              "MOTOR_PWM_HZ 取 976 / 7812 / 31250 / 62500");
+
+#ifndef MOTOR_SLEW_UP
+#define MOTOR_SLEW_UP 4     // PWM/ms，0 -> 190 约 50ms
+#endif
+#ifndef MOTOR_SLEW_DOWN
+#define MOTOR_SLEW_DOWN 16  // PWM/ms，190 -> 0 约 12ms
+#endif
+#ifndef MOTOR_DEADBAND
+#define MOTOR_DEADBAND 60   // 与 main.cpp 的 MIN_SPEED 一致
+#endif
+#ifndef MOTOR_BRAKE_MS
+#define MOTOR_BRAKE_MS 30   // 满速（255）时的反向脉冲长度，按当前输出等比缩短；0 关闭主动刹车
+#endif
+const uint8_t MOTOR_BRAKE_PWM = 120; // 反向脉冲的 PWM
+
+// 轮速模型：cm/s ≈ (PWM - MOTOR_STALL_PWM) × MOTOR_CMS_PER_PWM_Q8 / 256，
+// 与赛道文件 robot 行的 deadband / gain 对应，实车按直道计时标定
+const uint8_t MOTOR_STALL_PWM = 40;
+const uint8_t MOTOR_CMS_PER_PWM_Q8 = 90; // 0.35 cm/s
+
+void motorBegin();
+
+// 设定目标（-255~255），取消进行中的刹车
+void motorSet(int16_t left, int16_t right);
+
+// 目标归零，正在转的轮子先反向打刹车脉冲
+void motorBrake();
+
+// 每个控制节拍调用一次：推进斜率、刹车脉冲并写引脚
+void motorUpdate();
+
+// 本节拍写到引脚的输出（含死区补偿与刹车脉冲，负值反转）
+int16_t motorOutputL();
+int16_t motorOutputR();
+
+// 按轮速模型从当前输出估计的前进速度（cm/s，后退为负），不含电机惯性
+int16_t motorSpeedCmS();
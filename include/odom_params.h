@@ -0,0 +1,6 @@
+#pragma once
+
+// 航位推算的电机模型参数：由 tools/odom_fit.py 从实车上 -DODOM_CALIBRATE 标定动作的遥测拟合，
+// 重新生成会覆盖本文件。这里没有的参数用 odometry.h 的默认值；build_flags 里的 -D 优先于这里。
+//
+// 还没有实车标定：全部用 odometry.h 的默认值（名义模型，与仿真赛道的 robot 行一致）。
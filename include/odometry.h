@@ -0,0 +1,81 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "odom_params.h" // tools/odom_fit.py 生成，覆盖下面 #ifndef 的默认值
+
+// 航位推算：没有编码器，按电机模型从每个节拍实际写出的 PWM（motorOutputL/R）推出两轮速度，
+// 再积分成位姿 (x, y, heading)。模型与赛道文件 robot 行一致：
+//   目标轮速 = (|PWM| - ODOM_STALL_PWM) × 该轮增益，低于 ODOM_STALL_PWM 为 0，负值反转
+//   实际轮速按一阶惯性 ODOM_TAU_MS 逼近目标
+//   前进速度 = 两轮平均，角速度 = 两轮之差 / ODOM_WHEELBASE_MM
+// 参数用 ODOM_CALIBRATE 标定动作加 tools/odom_fit.py 拟合（见 README）。全部定点，热路径没有浮点：
+//   轮速 cm/s Q12，位置 cm Q16，航向为二进制角（一圈 2^32，自然回绕），正值逆时针（左转）。
+// 坐标系以 odomReset() 时的车体为原点、车头为 +x。打滑、碰撞推不出来，只适合短距离（跨 gap、绕障）。
+
+#ifndef ODOM_GAIN_L_Q12
+#define ODOM_GAIN_L_Q12 1434   // 左轮 cm/s 每 PWM，Q12（0.35）
+#endif
+#ifndef ODOM_GAIN_R_Q12
+#define ODOM_GAIN_R_Q12 1434
+#endif
+#ifndef ODOM_STALL_PWM
+#define ODOM_STALL_PWM 40      // 低于此 PWM 轮子不转（与 motor.h 的 MOTOR_STALL_PWM 同义）
+#endif
+#ifndef ODOM_TAU_MS
+#define ODOM_TAU_MS 80
+#endif
+#ifndef ODOM_WHEELBASE_MM
+#define ODOM_WHEELBASE_MM 140  // 等效轮距，打滑的车标定出来会比尺量的大
+#endif
+#ifndef ODOM_SENSOR_MM
+#define ODOM_SENSOR_MM 90      // 巡线头在轮轴前方的距离
+#endif
+#ifndef ODOM_SENSOR_SPACING_MM
+#define ODOM_SENSOR_SPACING_MM 30 // 左右巡线头间距
+#endif
+
+static_assert(ODOM_TAU_MS >= 5 && ODOM_TAU_MS <= 1000, "ODOM_TAU_MS 取 5~1000");
+static_assert(ODOM_WHEELBASE_MM >= 50 && ODOM_WHEELBASE_MM <= 400, "ODOM_WHEELBASE_MM 取 50~400");
+
+const int32_t ODOM_ONE_CM = 65536L;            // 位置 Q16
+const uint32_t ODOM_DEG = 11930465UL;          // 二进制角的 1 度（2^32 / 360）
+const uint8_t ODOM_MAX_CATCHUP = 16;           // 一次最多补推的节拍数
+// 线方向：巡线时车头朝向的低通，每走 1/4 cm 靠近 1/2^ODOM_LINE_SHIFT，巡线的左右摆动被平均掉
+const uint8_t ODOM_LINE_SHIFT = 4;
+
+// 度换成二进制角，|deg| <= 180（180 度回绕成 -180 度，是同一个方向）；按无符号乘，不会有符号溢出
+constexpr int32_t odomDeg(int16_t deg) { return (int32_t)((uint32_t)(int32_t)deg * ODOM_DEG); }
+
+// sin/cos，Q14；四分之一周期表加线性插值，误差 < 0.0005
+int16_t odomSin(uint32_t angle);
+int16_t odomCos(uint32_t angle);
+
+// 位姿清零，轮速也当作静止
+void odomReset();
+
+// 每个控制步在 motorUpdate() 之后调用一次，传入本节拍写出的输出；按上次以来经过的节拍数推进
+void odomUpdate(int16_t outL, int16_t outR);
+
+int32_t odomX();           // cm Q16
+int32_t odomY();
+uint32_t odomHeading();
+uint32_t odomTravel();     // 上电以来两轮平均走过的路程（前后都算），cm Q16，回绕后相减仍对
+int16_t odomSpeedCmS();    // 前进速度（后退为负）
+// 现在断电，车还会按惯性再转多少（二进制角，左转为正）、再走多少（cm Q16，后退为负）
+int32_t odomCoastTurn();
+int32_t odomCoastCm();
+
+// 到 heading 还差多少（二进制角，左转为正，取 ±180 度以内）
+inline int32_t odomTurnTo(uint32_t heading) { return (int32_t)(heading - odomHeading()); }
+
+// 巡线时更新线方向和最近的压线点（巡线头位置，单侧压线时偏到那一侧）；
+// 两侧都白（gap、丢线）时不更新，保留离线前的线。每个巡线的控制步调用一次
+void odomTrackLine(uint8_t valL, uint8_t valR);
+uint32_t odomLineHeading();
+// 最近一个压线点，跨 gap 时沿这一点和线方向给出的直线走
+int32_t odomLineX();
+int32_t odomLineY();
+
+// 巡线头所在的点偏离直线 (x0, y0, dir) 多少，cm Q16，偏左为正；只在几米以内有意义
+int32_t odomCrossTrack(int32_t x0, int32_t y0, uint32_t dir);
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stdint.h>
+
+// 表驱动的时序模式检测：每种赛道特征（gap、大黑块、V 弯……）是规则表里的一行，
+// 写明匹配哪些传感器状态、要保持多久、触发时给哪个计数器加 1。
+// 每轮用同一份传感器快照更新全部规则，每条规则 O(1)，触发结果以事件位返回。
+
+// 传感器快照：bit0 = valL，bit1 = valR（黑为 1）
+inline uint8_t lineSnapshot(uint8_t valL, uint8_t valR) { return (valL & 1) | (valR & 1) << 1; }
+
+// 规则匹配的状态集合，按快照值取位
+const uint8_t SNAP_BOTH_WHITE = 1 << 0b00;
+const uint8_t SNAP_LEFT_ONLY = 1 << 0b01;
+const uint8_t SNAP_RIGHT_ONLY = 1 << 0b10;
+const uint8_t SNAP_BOTH_BLACK = 1 << 0b11;
+const uint8_t SNAP_ONE_SIDE = SNAP_LEFT_ONLY | SNAP_RIGHT_ONLY;
+
+enum PatternKind : uint8_t {
+  PAT_HOLD,   // 状态连续保持满 minMs 时触发一次（直到状态结束才会再次触发）
+  PAT_PULSE,  // 状态结束时，若持续时间在 [minMs, maxMs] 内则触发
+};
+
+struct PatternRule {
+  uint8_t states;   // 匹配的快照集合（SNAP_*）
+  uint8_t kind;     // PatternKind
+  uint16_t minMs;
+  uint16_t maxMs;   // 仅 PAT_PULSE 使用
+  uint8_t counter;  // 触发时加 1 的计数器编号
+};
+
+const uint8_t PATTERN_MAX_RULES = 8;
+const uint8_t PATTERN_MAX_COUNTERS = 8;
+
+// 装入规则表（放在 PROGMEM，最多 PATTERN_MAX_RULES 行），清空状态与计数；enableMask 为初始启用的规则
+void patternBegin(const PatternRule *rules, uint8_t count, uint8_t enableMask);
+
+// 用一份快照推进所有启用的规则，返回本轮触发的规则位（bit i 对应第 i 行）
+uint8_t patternUpdate(uint8_t snapshot, unsigned long nowMs);
+
+// 启用/停用某行规则；停用时其计时状态清零，计数器保留
+void patternEnable(uint8_t rule, bool on);
+bool patternEnabled(uint8_t rule);
+
+uint8_t patternCount(uint8_t counter);
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "hal.h"
+
+// 控制环耗时统计：loop 周期和各函数执行时间的 min/max/均值与对数直方图，
+// 固定占用 SRAM，串口收到 'p' 打印、'r' 清零（命令由 main.cpp 的 pollSerial 分发）。
+// 默认编译掉（探针为空语句）；build_flags 加 -DPERF_ENABLE 打开。
+// 计时直接读 Timer0 计数与溢出次数，单位 4us，每个探针只有几十个周期（Timer0 改了分频时退回 micros()）。
+
+enum PerfId : uint8_t {
+  PERF_LOOP,          // 相邻两次 loop() 入口的间隔
+  PERF_LINE_FOLLOW,
+  PERF_GAPS,
+  PERF_GET_DISTANCE,
+  PERF_AVOID,         // 避障动作每一步的推进
+  PERF_MOTION,        // 其它动作（跨 gap、丢线搜索）每一步的推进
+  PERF_CONTROL,       // 一次控制步（见 control.h）
+  PERF_COUNT
+};
+
+const uint8_t PERF_BUCKETS = 12;  // 第 i 桶为 [2^(i-1), 2^i) 个计数，最后一桶兜底
+const uint8_t PERF_TICK_US = 4;
+
+#ifdef PERF_ENABLE
+
+#if defined(ARDUINO) && !defined(HAL_T2_TIMEBASE)
+extern volatile unsigned long timer0_overflow_count;
+
+// 与 micros() 同源但不做乘法，返回 4us 为单位的 16 位计数（约 262ms 回绕）
+inline uint16_t perfTicks() {
+  uint8_t sreg = SREG;
+  cli();
+  uint8_t t = TCNT0;
+  uint16_t ovf = (uint16_t)timer0_overflow_count;
+  if ((TIFR0 & _BV(TOV0)) && t < 255) ovf++;
+  SREG = sreg;
+  return (uint16_t)(ovf << 8) | t;
+}
+#else
+inline uint16_t perfTicks() { return (uint16_t)(micros() / PERF_TICK_US); }
+#endif
+
+void perfRecord(uint8_t id, uint16_t ticks);
+void perfLoopMark();
+void perfCommand(int c);
+void perfDump();
+void perfReset();
+
+struct PerfProbe {
+  uint8_t id;
+  uint16_t start;
+  explicit PerfProbe(uint8_t i) : id(i), start(perfTicks()) {}
+  ~PerfProbe() { perfRecord(id, perfTicks() - start); }
+};
+
+#define PERF_CAT_(a, b) a##b
+#define PERF_CAT(a, b) PERF_CAT_(a, b)
+#define PERF_SCOPE(id) PerfProbe PERF_CAT(perfProbe_, __LINE__)(id)
+#define PERF_LOOP_MARK() perfLoopMark()
+#define PERF_COMMAND(c) perfCommand(c)
+
+#else
+
+#define PERF_SCOPE(id) ((void)0)
+#define PERF_LOOP_MARK() ((void)0)
+#define PERF_COMMAND(c) ((void)(c))
+
+#endif
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <stdint.h>
+
+// PORTC（A0~A5）的引脚变化中断共用一个向量 PCINT1_vect：巡线头（A0/A1）和超声 echo（A3）都挂在上面。
+// 这里统一持有这个中断：进中断读一次 PINC，与上次比较得出变化的位，按登记时的位掩码分发，
+// 各模块不再各自定义 ISR。处理函数在中断里运行，只做记录，不要调用 Serial 之类。
+
+const uint8_t PCINT_MAX_HANDLERS = 3;
+
+// pins 为这一刻的 PINC（A0 为 bit0），changed 为与上次相比变化的位
+typedef void (*PinChangeHandler)(uint8_t pins, uint8_t changed);
+
+// 给 A0~A5 中 mask 指定的引脚打开变化中断，变化时调用 handler；同一个 handler 再登记只更新掩码
+// （重新上电初始化时不会占满），登记满了返回 false
+bool pinChangeAttach(uint8_t mask, PinChangeHandler handler);
+
+// A0~A5 的引脚号换成 PINC 里的位
+constexpr uint8_t pinChangeBit(uint8_t pin) { return (uint8_t)(1 << (pin - 14)); }
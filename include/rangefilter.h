@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stdint.h>
+
+// 正前方测距的跟踪滤波，夹在扫描器样本和模式判断之间，单个假回波不再直接触发绕障。
+//  - 中值：最近 3 个原始样本取中值（超时的 999 也参与），孤立的一个近值或一个丢波都被压掉
+//  - 变化率门限：障碍是静止的，下一样本应在“上次距离 - 车速 × 间隔”附近，
+//    偏离超过 RF_GATE_CM（再加一半的行程余量）视为野值，扣置信度
+//  - 置信度：连续一致的近距离样本累加，到 RF_CONFIRM 才算确认
+//  - 到达时间：用车速把最近一次确认的距离外推到现在，算还有多久到某个距离，
+//    模式判断据此在最晚的安全时刻触发绕障，而不是固定在某个 cm
+
+const int16_t RF_MAX_CM = 150;      // 超过此距离不跟踪，当作前方无物
+const int16_t RF_GATE_CM = 6;       // 与预测距离的允许偏差
+const uint8_t RF_CONFIRM = 2;       // 置信度到此才算确认
+const uint8_t RF_CONF_MAX = 4;
+const unsigned long RF_STALE_MS = 250; // 这么久没有一致样本，跟踪重新开始
+
+struct RangeTrack {
+  int16_t cm;          // 最近 3 个样本的中值
+  int16_t lastCm;      // 最近一次通过门限的样本
+  unsigned long lastMs; // 该样本的触发时刻
+  uint8_t confidence;
+};
+
+void rangeFilterReset();
+
+// 每个正前方新样本调用一次；speedCmS 为本车前进速度估计
+void rangeFilterPush(int16_t cm, unsigned long ms, int16_t speedCmS);
+
+const RangeTrack &rangeFilterTrack();
+
+// 置信度已到 RF_CONFIRM
+bool rangeFilterConfirmed();
+
+// 从最近一次一致样本按 speedCmS 外推，nowMs 起还要多少 ms 到 cm：已在 cm 以内为 0，
+// 没有确认的障碍或车没在前进为 0xFFFF
+uint16_t rangeFilterTimeTo(int16_t cm, unsigned long nowMs, int16_t speedCmS);
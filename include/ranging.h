@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stdint.h>
+
+// 超声波异步测距：trig 发触发脉冲后立即返回，echo 的上升/下降沿由引脚变化中断
+// 记录时间，loop() 只需 O(1) 读取最近一次结果，不再被 pulseIn 卡住最多 30ms。
+// 注意：echo 必须接在 PORTC（A0~A5），中断向量 PCINT1_vect 与巡线头共用，由 pinchange.h 分发。
+
+const unsigned long RANGE_TIMEOUT_US = 30000; // 回波超时，与原 pulseIn 一致
+const unsigned long RANGE_INTERVAL_MS = 40;   // 两次触发的最小间隔，避免上一次余波干扰
+const long RANGE_FAR_CM = 999;                // 超时当作很远
+
+// 回波时长（us）换算成 cm，等价于原来的 (long)(us * 0.034f / 2.0f) = floor(us * 17 / 1000)。
+// 先 ×17 再 >>3（精确的 floor(/8)），剩下的 /125 用倒数乘法 ×67109 >>23，
+// 在 0~30000us 范围内与浮点版逐点一致，且中间结果不超过 32 位。
+constexpr uint32_t echoUsToCm(uint32_t us) {
+  return (((us * 17) >> 3) * 67109UL) >> 23;
+}
+
+static_assert(echoUsToCm(0) == 0 && echoUsToCm(58) == 0 && echoUsToCm(59) == 1, "echoUsToCm");
+static_assert(echoUsToCm(1470) == 24 && echoUsToCm(1471) == 25, "echoUsToCm");
+static_assert(echoUsToCm(29999) == 509 && echoUsToCm(30000) == 510, "echoUsToCm");
+
+void rangingBegin(uint8_t trig, uint8_t echo);
+
+// 每轮 loop 调用：空闲且到间隔就发下一次触发，回波结束或超时就发布结果
+void rangingUpdate();
+
+// 在 ms 之前不发新的触发（舵机还在转），已发出的这一次照常完成
+void rangingHoldUntil(unsigned long ms);
+
+// 触发脉冲发出后立即调用（在 rangingUpdate 里，不在中断里），扫描器借此马上转下一个角度
+typedef void (*RangingHook)();
+void rangingOnTrigger(RangingHook hook);
+
+long rangingDistance();        // 最近一次距离（cm）
+unsigned long rangingStamp();  // 最近一次结果对应的触发时刻（ms），用来判断是否在舵机到位后测得
+uint8_t rangingSeq();          // 每发布一次新结果加 1，用来判断是否有新数据
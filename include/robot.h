@@ -0,0 +1,27 @@
+#pragma once
+
+#include "hal.h"
+
+// main.cpp 里的共享状态与底层动作，供各子模块使用
+
+// 小车状态压成两个字节的位域，每轮都要读写的传感器位和方向也在里面
+struct RobotState {
+  uint8_t valL : 1;          // 黑线为 1、白底为 0
+  uint8_t valR : 1;
+  int8_t lastDir : 2;        // -1 左、0 双线/未知、1 右
+  uint8_t mode : 1;          // NORMAL / AVOID
+  uint8_t finished : 1;      // 达到终点后停止
+  uint8_t originCleared : 1; // 已离开起点黑块后才允许终点判定
+  uint8_t bridgeGaps : 1;    // 跨 gap 直行模式（由赛程的 SEG_BRIDGE_GAPS 段开启）
+  uint8_t obstaclesSeen : 3; // 本次运行已完成的绕障次数（到 7 为止）
+  uint8_t gapsBridged : 3;   // 已跨过的 gap 数（到 7 为止）
+};
+static_assert(sizeof(RobotState) == 2, "RobotState 应为两个字节");
+
+extern RobotState robot;
+extern Servo myServo;
+
+void setForwardSpeeds(int leftPwm, int rightPwm);
+void setWheelSpeeds(int leftPwm, int rightPwm); // 负值表示该轮反转
+void stop();
+long getDistance();
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stdint.h>
+
+// 舵机扫描器：按角度表转舵机测距，流水线执行——本角度的触发脉冲一发出就转向下一个角度，
+// 舵机转动与回波飞行重叠；下一次触发由 rangingHoldUntil 卡到舵机按转速模型估计到位之后。
+// 结果记在一个小的滚动极坐标表里（角度、距离、触发时刻），巡线测障和绕障规划都从这里查。
+// 角度一律相对舵机正前（90 度），正值偏左。舵机只应通过这里转动。
+
+#ifndef SCAN_MS_PER_DEG
+#define SCAN_MS_PER_DEG 2   // 舵机转速估计 ms/度（SG90 约 0.1s/60°，取整偏保守）
+#endif
+
+const unsigned long SCAN_SETTLE_MS = 20; // 到位后的固定余量，等舵机抖动停下
+const uint8_t SCAN_MAP_SIZE = 8;         // 极坐标表容量，够存一遍绕障扫描
+
+struct ScanSample {
+  int8_t angle;
+  int16_t cm;
+  unsigned long ms;  // 触发时刻
+};
+
+// 在 rangingBegin、舵机 attach 之后调用，舵机回正
+void scannerBegin(unsigned long nowMs);
+
+// 转到 angle 并停住，之后每次测距都记在这个角度
+void scannerPoint(int8_t angle, unsigned long nowMs);
+// 按角度表（放在 PROGMEM）扫描；repeat 为 false 时扫完一遍停在最后一个角度
+void scannerSweep(const int8_t *angles, uint8_t count, bool repeat, unsigned long nowMs);
+bool scannerSweeping();
+
+// 每轮 loop 在 rangingUpdate 之后调用，把新结果记入极坐标表
+void scannerUpdate();
+
+uint8_t scannerSeq();              // 每记一个样本加 1
+const ScanSample &scannerLatest();
+int8_t scannerAim();               // 当前指向
+// 舵机最近一次到位后，当前指向上是否已经测到样本
+bool scannerFresh();
+
+// angle 方向在 sinceMs 之后触发的最新距离，没有则返回 -1
+long scannerRangeAt(int8_t angle, unsigned long sinceMs);
+// [from, to] 方向内 sinceMs 之后触发的最近距离，没有则返回 RANGE_FAR_CM
+long scannerNearest(int8_t from, int8_t to, unsigned long sinceMs, int8_t *angleOut = nullptr);
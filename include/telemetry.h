@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stdint.h>
+
+// 二进制遥测：定时把控制状态打成定长帧，经 HardwareSerial 的中断发送缓冲发出。
+// 发送前检查缓冲剩余空间，放不下就丢帧并计数，绝不阻塞控制环。
+//
+// 帧格式（小端）：A5 5A len payload[len] crc8
+//   crc8 多项式 0x07，覆盖 len 与 payload；payload 见 TelemetrySample 的打包顺序，
+//   主机端用 tools/telemetry_decode.py 转成 CSV。
+
+const unsigned long TELEMETRY_BAUD = 250000;     // 16MHz 下 250000 误差为 0
+const unsigned long TELEMETRY_PERIOD_MS = 20;
+const uint8_t TELEMETRY_VERSION = 1;
+
+struct TelemetrySample {
+  uint16_t tMs;          // millis() 低 16 位，主机端展开回绕
+  uint8_t valL, valR;
+  uint8_t mode;          // 0 NORMAL / 1 AVOID
+  int8_t lastDir;        // -1 / 0 / 1
+  int16_t pwmL, pwmR;    // 带方向的电机指令，负值为反转
+  uint8_t gapsSeen, obstaclesSeen, gapsBridged;
+  uint16_t distanceCm;
+};
+
+void telemetryBegin();
+
+// 距上一帧已满一个周期时返回 true，调用方再填样本调用 telemetrySend
+bool telemetryDue();
+void telemetrySend(const TelemetrySample &s);
+
+uint16_t telemetryDrops();
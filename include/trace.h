@@ -0,0 +1,133 @@
+#pragma once
+
+#include <stdint.h>
+
+// 传感器轨迹记录：巡线头状态变化、每次测距结果、电机指令变化按控制节拍打时间戳，
+// 紧凑编码后存进 SRAM 环形缓冲，满了丢最旧的记录。跑完（到达黑块）或串口收到 't' 时
+// 以文本发出，主机上用仿真程序的 --replay 把这段输入按原来的节拍重新喂给同一份控制代码，
+// 逐条对比电机指令，找出在哪一拍做了不同的决定（见 src/sim/replay.h）。
+// 默认编译掉（调用为空语句）；build_flags 加 -DTRACE_ENABLE 打开，缓冲大小 TRACE_BYTES。
+//
+// 记录格式：首字节 高 3 位种类、bit4 续位、低 4 位 dt；续位为 1 时 dt 的其余位按 7 位一组的
+// varint 跟在后面（低位在前）。dt 是与上一条记录相隔的控制节拍数。种类之后是负载：
+//   TR_LINE + 快照（0~3）  无负载，快照即 lineSnapshot()（bit0 左、bit1 右，黑为 1）
+//   TR_RANGE              varint 距离（cm）
+//   TR_RANGE_SAME         无负载，距离与上一次相同（前方没东西时一直是 999）
+//   TR_MOTOR              两个 int8：左、右电机指令 / TRACE_MOTOR_DIV（负值反转）
+//
+// 发出的文本（与遥测帧共用串口，发送期间暂停遥测）：
+//   #trace 1 <节拍 us> <首条之前的节拍> <首条之前的快照> <左> <右> <距离> <丢弃条数> <字节数>
+//   #t <十六进制，每行 TRACE_HEX_BYTES 字节>
+//   #end
+
+#ifndef TRACE_BYTES
+#define TRACE_BYTES 384
+#endif
+
+static_assert(TRACE_BYTES >= 32 && TRACE_BYTES <= 32768, "TRACE_BYTES 取 32~32768");
+
+const uint8_t TRACE_VERSION = 1;
+const uint8_t TRACE_MOTOR_DIV = 4;   // 电机指令量化，变化小于一格不记
+const uint8_t TRACE_HEX_BYTES = 16;  // 每行 32 个十六进制字符，放得进 64 字节的串口发送缓冲
+const uint8_t TRACE_MAX_RECORD = 8;
+
+enum TraceKind : uint8_t {
+  TR_LINE = 0,  // 0~3，低两位是快照
+  TR_RANGE = 4,
+  TR_MOTOR = 5,
+  TR_RANGE_SAME = 6,
+};
+
+struct TraceRecord {
+  uint32_t dt;     // 节拍
+  uint8_t kind;    // TR_LINE 时已去掉快照位
+  uint8_t line;    // TR_LINE 的快照
+  int16_t a, b;    // TR_RANGE：a = cm；TR_MOTOR：a、b = 量化后的左右指令；TR_RANGE_SAME 不填
+};
+
+// 解码一条记录，返回占用的字节数；at(i) 取第 i 个字节（环形缓冲和主机端文件共用）。
+// 格式不对（未知种类、varint 过长）返回 0
+template <typename ByteAt>
+uint8_t traceDecode(ByteAt at, uint16_t avail, TraceRecord &r) {
+  if (avail == 0) return 0;
+  uint8_t b = at(0), n = 1;
+  uint8_t kind = b >> 5;
+  r.dt = b & 0x0F;
+  r.kind = kind < TR_RANGE ? (uint8_t)TR_LINE : kind;
+  r.line = kind & 3;
+  r.a = r.b = 0;
+  if (b & 0x10) {
+    uint8_t shift = 4, c;
+    do {
+      if (n >= avail || shift > 25) return 0;
+      c = at(n++);
+      r.dt |= (uint32_t)(c & 0x7F) << shift;
+      shift += 7;
+    } while (c & 0x80);
+  }
+  if (kind == TR_RANGE) {
+    uint8_t shift = 0, c;
+    uint16_t cm = 0;
+    do {
+      if (n >= avail || shift > 7) return 0;
+      c = at(n++);
+      cm |= (uint16_t)(c & 0x7F) << shift;
+      shift += 7;
+    } while (c & 0x80);
+    r.a = (int16_t)cm;
+  } else if (kind == TR_MOTOR) {
+    if (n + 2 > avail) return 0;
+    r.a = (int8_t)at(n);
+    r.b = (int8_t)at(n + 1);
+    n += 2;
+  } else if (kind > TR_RANGE_SAME) {
+    return 0;
+  }
+  return n;
+}
+
+// 环形缓冲里最旧一条之前的状态，回放从这里开始
+struct TraceHeader {
+  uint32_t baseTick;   // 最旧一条记录的 dt 从这一拍算起
+  uint8_t baseLine;    // 此时的巡线快照（0xFF 为未知）
+  int8_t baseMotorL, baseMotorR;
+  int16_t baseRangeCm;  // 此时最近一次测距（-1 为未知），TR_RANGE_SAME 从这里接上
+  uint16_t dropped;    // 为腾空间丢掉的记录数，为 0 表示从上电起完整
+  uint16_t used;       // 缓冲里的字节数
+};
+
+#ifdef TRACE_ENABLE
+
+void traceBegin();                         // 清空缓冲，从当前节拍开始记
+void traceLine(uint8_t snapshot);          // 快照变化时记一条
+void traceRange(int16_t cm);               // 每个新测距结果记一条
+void traceMotor(int16_t left, int16_t right); // 量化后变化时记一条
+
+// 开始发出缓冲内容；发出期间不记录，发完清空重新开始
+void traceFlush();
+bool traceFlushing();
+// 每轮 loop 调用：发送中时按串口发送缓冲的剩余空间写一行，绝不阻塞
+void traceService();
+
+const TraceHeader &traceHeader();
+uint8_t traceByte(uint16_t i);             // 从最旧一条起的第 i 个字节
+
+#define TRACE_BEGIN() traceBegin()
+#define TRACE_LINE(s) traceLine(s)
+#define TRACE_RANGE(cm) traceRange(cm)
+#define TRACE_MOTOR(l, r) traceMotor(l, r)
+#define TRACE_FLUSH() traceFlush()
+#define TRACE_FLUSHING() traceFlushing()
+#define TRACE_SERVICE() traceService()
+
+#else
+
+#define TRACE_BEGIN() ((void)0)
+#define TRACE_LINE(s) ((void)0)
+#define TRACE_RANGE(cm) ((void)0)
+#define TRACE_MOTOR(l, r) ((void)0)
+#define TRACE_FLUSH() ((void)0)
+#define TRACE_FLUSHING() false
+#define TRACE_SERVICE() ((void)0)
+
+#endif
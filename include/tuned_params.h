@@ -0,0 +1,31 @@
+#pragma once
+
+// 参数覆盖：由 tools/tune.py 在主机仿真赛道上搜索后生成，重新生成会覆盖本文件，不要手改。
+// 只在 -DTUNED_PARAMS 时包含（[env:sim] 打开，板上实测确认之前不用）。
+// 这里没有的参数用各自定义处的默认值；build_flags 里的 -D 优先于这里。
+// 可调参数：LINE_KP LINE_KD（linepd.h）、GOV_TOP_SPEED（governor.h）、
+// SEARCH_TURN TURN_STRONG GAP_DETECT_MS OBST_STANDOFF OBST_STOP_MS（main.cpp）
+//
+// 本次搜索：LINE_KP LINE_KD GOV_TOP_SPEED SEARCH_TURN TURN_STRONG GAP_DETECT_MS OBST_STANDOFF OBST_STOP_MS
+// 2026-10-17  tracks/isrc2025.trk  loop-us 200,400,600,800,1000,1200,1400,1600,1800,2000,2200,2400,2600,2800,3000  seed 3
+// 计分：圈速
+// 得分 84.440 -> 81.447
+
+#ifndef LINE_KP
+#define LINE_KP 54
+#endif
+#ifndef LINE_KD
+#define LINE_KD 20
+#endif
+#ifndef GOV_TOP_SPEED
+#define GOV_TOP_SPEED 231
+#endif
+#ifndef SEARCH_TURN
+#define SEARCH_TURN 66
+#endif
+#ifndef TURN_STRONG
+#define TURN_STRONG 100
+#endif
+#ifndef GAP_DETECT_MS
+#define GAP_DETECT_MS 208
+#endif
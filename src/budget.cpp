@@ -0,0 +1,251 @@
+#include "hal.h"
+
+#include "budget.h"
+#include "lap.h"
+
+#ifdef ARDUINO
+#include <avr/wdt.h>
+#endif
+
+static_assert(BUDGET_EEPROM_BASE >= LAP_EEPROM_BASE + 6 + LAP_MAX_BYTES, "延迟预算记录与圈学习记录区重叠");
+
+namespace {
+
+const uint8_t HDR_LEN = 4;
+const uint8_t SLOT_BYTES = 2 + 3 * BUDGET_COUNT;
+const uint16_t SLOTS = BUDGET_EEPROM_BASE + HDR_LEN;
+const uint8_t ENTRY = 2; // 槽内第一条路径的偏移
+
+static_assert(SLOTS + 2 * SLOT_BYTES - 1 <= E2END, "延迟预算记录超出 EEPROM");
+static_assert(SLOT_BYTES <= 32, "待写字节掩码只有 32 位");
+
+const uint16_t LIMITS[BUDGET_COUNT] PROGMEM = {
+  BUDGET_BACKGROUND_US, BUDGET_CONTROL_US, BUDGET_GAP_MS, BUDGET_BYPASS_MS, BUDGET_SEARCH_MS,
+};
+// 这个模块一直编译进去，名字放 PROGMEM 不占 SRAM
+const char NAMES[BUDGET_COUNT][11] PROGMEM = {"background", "control", "gap", "bypass", "search"};
+
+uint8_t slot = 0;
+uint8_t image[SLOT_BYTES]; // 本轮记录，与 EEPROM 槽的布局相同
+uint32_t dirty = 0;        // 改过、还没排队的字节
+uint32_t pending = 0;      // 排队待写的字节
+uint8_t hdrIdx = HDR_LEN;  // 正在写的头字节，HDR_LEN 表示没有
+bool headerPending = false;
+bool havePrev = false;     // EEPROM 另一个槽是上一轮的有效记录
+unsigned long savedMs = 0;
+
+uint8_t running = 0;       // 动作路径正在计时的位
+unsigned long startMs[BUDGET_COUNT];
+
+volatile uint8_t active = BUDGET_NONE;
+
+uint8_t readByte(uint16_t addr) { return eeprom_read_byte((const uint8_t *)(uintptr_t)addr); }
+
+void printName(uint8_t path) {
+  if (path >= BUDGET_COUNT) {
+    Serial.print('-');
+    return;
+  }
+  for (const char *c = NAMES[path]; pgm_read_byte(c); c++) Serial.print((char)pgm_read_byte(c));
+}
+
+uint16_t worstAt(const uint8_t *e) { return e[0] | (uint16_t)e[1] << 8; }
+
+void mark(uint8_t i, uint8_t n = 1) {
+  while (n--) dirty |= 1UL << (i + n);
+}
+
+#ifdef ARDUINO
+
+const uint16_t HANG_MAGIC = 0xB6E7;
+
+// 放在 .noinit：启动代码不清零，看门狗复位后还能读到复位前记下的内容（上电时是随机值，靠 magic 区分）
+struct HangNote {
+  uint16_t magic;
+  uint8_t path;
+};
+HangNote hang __attribute__((section(".noinit")));
+
+// 看门狗周期换成 WDP 位
+const uint8_t WDT_PRESCALE = BUDGET_WDT_MS <= 15 ? WDTO_15MS : BUDGET_WDT_MS <= 30 ? WDTO_30MS :
+                             BUDGET_WDT_MS <= 60 ? WDTO_60MS : BUDGET_WDT_MS <= 120 ? WDTO_120MS :
+                             BUDGET_WDT_MS <= 250 ? WDTO_250MS : BUDGET_WDT_MS <= 500 ? WDTO_500MS : WDTO_1S;
+
+// 中断加复位模式：第一次超时进中断，硬件同时清 WDIE，下一次超时复位
+void armWatchdog() {
+  HAL_ATOMIC {
+    wdt_reset();
+    WDTCSR = _BV(WDCE) | _BV(WDE);
+    WDTCSR = _BV(WDIE) | _BV(WDE) | ((WDT_PRESCALE & 8) ? _BV(WDP3) : 0) | (WDT_PRESCALE & 7);
+  }
+}
+
+#endif
+
+} // namespace
+
+#ifdef ARDUINO
+ISR(WDT_vect) {
+  hang.magic = HANG_MAGIC;
+  hang.path = active;
+}
+#endif
+
+uint16_t budgetLimit(uint8_t path) { return pgm_read_word(&LIMITS[path]); }
+
+void budgetBegin() {
+  bool resumed = false;
+  uint8_t hangPath = BUDGET_NONE;
+#ifdef ARDUINO
+  MCUSR &= ~_BV(WDRF); // 不清复位标志就关不掉 WDE
+  resumed = hang.magic == HANG_MAGIC;
+  hangPath = hang.path;
+  hang.magic = 0;
+#endif
+  active = BUDGET_NONE;
+  running = 0;
+  dirty = pending = 0;
+  hdrIdx = HDR_LEN;
+  headerPending = false;
+  savedMs = millis();
+
+  uint8_t stored = readByte(BUDGET_EEPROM_BASE + 3);
+  bool valid = readByte(BUDGET_EEPROM_BASE) == 'B' && readByte(BUDGET_EEPROM_BASE + 1) == 'G' &&
+               readByte(BUDGET_EEPROM_BASE + 2) == BUDGET_VERSION && stored <= 3;
+
+  if (resumed && valid) {
+    // 看门狗复位：还是同一轮，读回已记下的部分，计一次复位
+    slot = stored & 1;
+    havePrev = stored & 2;
+    for (uint8_t i = 0; i < SLOT_BYTES; i++) image[i] = readByte(SLOTS + slot * SLOT_BYTES + i);
+    if (image[0] < 255) image[0]++;
+    image[1] = hangPath;
+    mark(0, 2);
+  } else {
+    // 新的一轮：换到另一个槽，上一轮的留着；先写槽，最后写头，断电时头不会指向写了一半的槽
+    slot = valid ? (stored & 1) ^ 1 : 0;
+    memset(image, 0, sizeof(image));
+    image[1] = BUDGET_NONE;
+    mark(0, SLOT_BYTES);
+    headerPending = true;
+    havePrev = valid;
+  }
+  pending = dirty;
+  dirty = 0;
+
+#ifdef ARDUINO
+  armWatchdog();
+#endif
+}
+
+void budgetFeed() {
+#ifdef ARDUINO
+  wdt_reset();
+  // 中断已经触发但 loop() 又赶了回来，没有复位：撤掉记号，按那条路径超时记一次，重新打开中断
+  if (!(WDTCSR & _BV(WDIE))) {
+    hang.magic = 0;
+    if (hang.path < BUDGET_COUNT) budgetRecord(hang.path, 0xFFFF);
+    armWatchdog();
+  }
+#endif
+}
+
+void budgetEnter(uint8_t path) { active = path; }
+
+bool budgetRecord(uint8_t path, unsigned long value) {
+  uint16_t v = value > 0xFFFF ? 0xFFFF : (uint16_t)value;
+  uint8_t i = ENTRY + 3 * path;
+  uint8_t *e = &image[i];
+  if (v > worstAt(e)) {
+    e[0] = v & 0xFF;
+    e[1] = v >> 8;
+    mark(i, 2);
+  }
+  if (v <= budgetLimit(path)) return false;
+  if (e[2] < 255) {
+    e[2]++;
+    mark(i + 2);
+  }
+  return true;
+}
+
+void budgetStart(uint8_t path, unsigned long nowMs) {
+  startMs[path] = nowMs;
+  running |= 1 << path;
+}
+
+void budgetStop(uint8_t path, unsigned long nowMs) {
+  if (!budgetRunning(path)) return;
+  running &= ~(1 << path);
+  budgetRecord(path, nowMs - startMs[path]);
+}
+
+void budgetCancel(uint8_t path) { running &= ~(1 << path); }
+
+bool budgetRunning(uint8_t path) { return running & (1 << path); }
+
+bool budgetExpired(uint8_t path, unsigned long nowMs) {
+  if (!budgetRunning(path) || nowMs - startMs[path] <= budgetLimit(path)) return false;
+  budgetStop(path, nowMs);
+  return true;
+}
+
+uint16_t budgetWorst(uint8_t path) { return worstAt(&image[ENTRY + 3 * path]); }
+uint8_t budgetOverruns(uint8_t path) { return image[ENTRY + 3 * path + 2]; }
+uint8_t budgetResets() { return image[0]; }
+uint8_t budgetResetPath() { return image[1]; }
+
+void budgetService(unsigned long nowMs) {
+  if (!pending && dirty && nowMs - savedMs >= BUDGET_SAVE_MS) {
+    pending = dirty;
+    dirty = 0;
+    savedMs = nowMs;
+  }
+  if ((!pending && !headerPending) || !eeprom_is_ready()) return;
+
+  if (pending) {
+    uint8_t i = 0;
+    while (!(pending & (1UL << i))) i++;
+    pending &= ~(1UL << i);
+    eeprom_update_byte((uint8_t *)(uintptr_t)(SLOTS + slot * SLOT_BYTES + i), image[i]);
+    return;
+  }
+
+  if (hdrIdx == HDR_LEN) hdrIdx = 0;
+  const uint8_t hdr[HDR_LEN] = {'B', 'G', BUDGET_VERSION, (uint8_t)(slot | (havePrev ? 2 : 0))};
+  eeprom_update_byte((uint8_t *)(uintptr_t)(BUDGET_EEPROM_BASE + hdrIdx), hdr[hdrIdx]);
+  if (++hdrIdx == HDR_LEN) headerPending = false;
+}
+
+void budgetDump() {
+  uint16_t prev = SLOTS + (slot ^ 1) * SLOT_BYTES;
+  Serial.println(F("# budget: path unit limit worst overruns prev_worst prev_overruns"));
+  for (uint8_t p = 0; p < BUDGET_COUNT; p++) {
+    printName(p);
+    Serial.print(p <= BUDGET_CONTROL ? F(" us ") : F(" ms "));
+    Serial.print((unsigned long)budgetLimit(p));
+    Serial.print(' ');
+    Serial.print((unsigned long)budgetWorst(p));
+    Serial.print(' ');
+    Serial.print((unsigned long)budgetOverruns(p));
+    if (havePrev) {
+      uint16_t at = prev + ENTRY + 3 * p;
+      Serial.print(' ');
+      Serial.print((unsigned long)(readByte(at) | (uint16_t)readByte(at + 1) << 8));
+      Serial.print(' ');
+      Serial.print((unsigned long)readByte(at + 2));
+    }
+    Serial.println();
+  }
+  Serial.print(F("# budget: resets last_path "));
+  Serial.print((unsigned long)budgetResets());
+  Serial.print(' ');
+  printName(budgetResetPath());
+  if (havePrev) {
+    Serial.print(F(" prev "));
+    Serial.print((unsigned long)readByte(prev));
+    Serial.print(' ');
+    printName(readByte(prev + 1));
+  }
+  Serial.println();
+}
@@ -0,0 +1,97 @@
+#include "bypass.h"
+#include "ranging.h"
+#include "robot.h"
+#include "scanner.h"
+
+namespace {
+
+bool preferred = false;
+bool presetReady = false;
+bool skipScan = false;
+unsigned long scanSince = 0;
+int16_t profile[BYPASS_SCAN_STEPS];
+BypassPlan plan = {false, (int16_t)RANGE_FAR_CM, 0, BYPASS_TARGET_MIN};
+
+void makePlan() {
+  int16_t nearCm = (int16_t)RANGE_FAR_CM;
+  for (uint8_t i = 0; i < BYPASS_SCAN_STEPS; i++) {
+    if (profile[i] < nearCm) nearCm = profile[i];
+  }
+
+  plan.nearCm = nearCm;
+  plan.mirror = preferred;
+  plan.widthCm = 0;
+  plan.targetCm = BYPASS_TARGET_MIN;
+  if (nearCm >= RANGE_FAR_CM) return; // 扫不到就按默认侧、最小距离绕
+
+  // 障碍本体向左、向右各延伸到的角度
+  int leftExt = -90, rightExt = -90;
+  for (uint8_t i = 0; i < BYPASS_SCAN_STEPS; i++) {
+    if (profile[i] > nearCm + BYPASS_EDGE_CM) continue;
+    int a = (int8_t)pgm_read_byte(&BYPASS_SCAN_ANGLES[i]);
+    if (a > leftExt) leftExt = a;
+    if (-a > rightExt) rightExt = -a;
+  }
+
+  // 从障碍伸得少的一侧绕：左边短就把障碍放在右侧
+  if (leftExt != rightExt) plan.mirror = leftExt < rightExt;
+
+  // 弧长近似横向宽度：near * 度数 * pi/180，pi/180 ≈ 143/8192
+  int spanDeg = leftExt + rightExt;
+  if (spanDeg < 0) spanDeg = 0;
+  plan.widthCm = (int16_t)(((long)nearCm * spanDeg * 143) >> 13);
+  // 障碍越宽，拐角越可能蹭到，贴墙距离相应放大
+  plan.targetCm = constrain(BYPASS_TARGET_MIN + plan.widthCm / 4, BYPASS_TARGET_MIN, BYPASS_TARGET_MAX);
+}
+
+} // namespace
+
+const int8_t BYPASS_SCAN_ANGLES[BYPASS_SCAN_STEPS] PROGMEM = {-30, -15, 0, 15, 30};
+
+void bypassPreset(bool mirror, int16_t targetCm) {
+  plan.mirror = mirror;
+  plan.nearCm = (int16_t)RANGE_FAR_CM;
+  plan.widthCm = 0;
+  plan.targetCm = constrain(targetCm, BYPASS_TARGET_MIN, BYPASS_TARGET_MAX);
+  presetReady = true;
+}
+
+void bypassScanBegin(bool preferMirror, unsigned long nowMs) {
+  skipScan = presetReady;
+  presetReady = false;
+  if (skipScan) {
+    // 不扫描，舵机直接转到贴墙角度，等到位测到一个样本再开始转向
+    scannerPoint(plan.mirror ? -BYPASS_FOLLOW_ANGLE : BYPASS_FOLLOW_ANGLE, nowMs);
+    return;
+  }
+
+  preferred = preferMirror;
+  scanSince = nowMs;
+  scannerSweep(BYPASS_SCAN_ANGLES, BYPASS_SCAN_STEPS, false, nowMs);
+}
+
+bool bypassScanTick() {
+  if (skipScan) return scannerFresh();
+  if (scannerSweeping()) return false;
+
+  for (uint8_t i = 0; i < BYPASS_SCAN_STEPS; i++) {
+    long cm = scannerRangeAt((int8_t)pgm_read_byte(&BYPASS_SCAN_ANGLES[i]), scanSince);
+    profile[i] = cm < 0 ? (int16_t)RANGE_FAR_CM : (int16_t)cm;
+  }
+  makePlan();
+  return true;
+}
+
+const BypassPlan &bypassPlan() { return plan; }
+
+int16_t bypassProfile(uint8_t i) { return i < BYPASS_SCAN_STEPS ? profile[i] : (int16_t)RANGE_FAR_CM; }
+
+int16_t bypassSteer(long cm) {
+  long err = cm - plan.targetCm;
+  if (err > BYPASS_LOST_CM) return BYPASS_STEER_LOST;
+  return (int16_t)constrain(err * BYPASS_KP, (long)-BYPASS_STEER_MAX, (long)BYPASS_STEER_MAX);
+}
+
+bool bypassWallSeen() {
+  return scannerFresh() && scannerLatest().cm <= plan.targetCm + BYPASS_ACQUIRE_CM;
+}
@@ -0,0 +1,106 @@
+#include "hal.h"
+#include "control.h"
+
+namespace {
+
+ControlSampler sampler = nullptr;
+volatile uint16_t tickCount = 0; // 中断里累加，低 16 位足够判断丢了几拍
+volatile uint8_t sample = 0;
+uint16_t seenTicks = 0;
+uint32_t ticks = 0;
+uint16_t overruns = 0;
+
+#ifdef HAL_T2_TIMEBASE
+volatile unsigned long clockUs = 0;
+volatile unsigned long clockMs = 0;
+uint16_t clockFracUs = 0;
+#endif
+
+void onTick() {
+#ifdef HAL_T2_TIMEBASE
+  clockUs += CONTROL_PERIOD_US;
+  clockFracUs += CONTROL_PERIOD_US;
+  while (clockFracUs >= 1000) {
+    clockFracUs -= 1000;
+    clockMs++;
+  }
+#endif
+  if (sampler) sample = sampler();
+  tickCount++;
+}
+
+} // namespace
+
+#ifdef ARDUINO
+ISR(TIMER2_COMPA_vect) { onTick(); }
+#endif
+
+void controlBegin(ControlSampler s) {
+  sampler = s;
+  HAL_ATOMIC {
+    tickCount = 0;
+    sample = s ? s() : 0;
+  }
+  seenTicks = 0;
+  ticks = 0;
+  overruns = 0;
+
+#ifdef ARDUINO
+  // CTC，OCR2A 为 TOP
+  TCCR2A = _BV(WGM21);
+  TCCR2B = CONTROL_TIMER_HZ == 250000UL ? _BV(CS22) : (_BV(CS22) | _BV(CS20));
+  OCR2A = CONTROL_OCR;
+  TCNT2 = 0;
+  TIFR2 = _BV(OCF2A);
+  TIMSK2 = _BV(OCIE2A);
+#else
+  attachTimer(CONTROL_PERIOD_US, onTick);
+#endif
+}
+
+bool controlDue() {
+  uint16_t now;
+  HAL_ATOMIC { now = tickCount; }
+  uint16_t elapsed = now - seenTicks;
+  if (elapsed == 0) return false;
+  seenTicks = now;
+  ticks += elapsed;
+  if (elapsed > 1) {
+    uint16_t missed = elapsed - 1;
+    overruns = overruns > 0xFFFF - missed ? 0xFFFF : overruns + missed;
+  }
+  return true;
+}
+
+uint8_t controlSample() { return sample; }
+
+uint32_t controlTicks() { return ticks; }
+
+uint16_t controlOverruns() { return overruns; }
+
+#ifdef HAL_T2_TIMEBASE
+
+unsigned long controlMillis() {
+  unsigned long ms;
+  HAL_ATOMIC { ms = clockMs; }
+  return ms;
+}
+
+unsigned long controlMicros() {
+  unsigned long us;
+  uint8_t t;
+  HAL_ATOMIC {
+    us = clockUs;
+    t = TCNT2;
+    // 计数已回到 0 但中断还没进（关中断期间）：补上这一拍
+    if ((TIFR2 & _BV(OCF2A)) && t < CONTROL_OCR) us += CONTROL_PERIOD_US;
+  }
+  return us + t * (1000000UL / CONTROL_TIMER_HZ);
+}
+
+#else
+
+unsigned long controlMillis() { return millis(); }
+unsigned long controlMicros() { return micros(); }
+
+#endif
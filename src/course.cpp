@@ -0,0 +1,77 @@
+#include "hal.h"
+#include "course.h"
+
+namespace {
+
+// 赛程走完后停在这一段上：不测障、不跨 gap
+const CourseSegment FINISHED = {SEG_FOLLOW, 0, 0, 0};
+
+const CourseSegment *table = nullptr; // PROGMEM
+uint8_t segCount = 0;
+uint8_t idx = 0;
+uint8_t hits = 0;  // 当前段内已发生的计数事件
+unsigned long segStartMs = 0;
+CourseSegment seg = FINISHED; // 当前段在 RAM 里的副本
+
+void load() {
+  if (idx < segCount) memcpy_P(&seg, &table[idx], sizeof(seg));
+  else seg = FINISHED;
+}
+
+void advance(unsigned long nowMs) {
+  if (idx < segCount) idx++;
+  hits = 0;
+  segStartMs = nowMs;
+  load();
+}
+
+} // namespace
+
+void courseBegin(const CourseSegment *segments, uint8_t count, uint8_t start, unsigned long nowMs) {
+  table = segments;
+  segCount = count;
+  idx = start < count ? start : count;
+  hits = 0;
+  segStartMs = nowMs;
+  load();
+}
+
+void courseEvent(uint8_t ev, unsigned long nowMs) {
+  if (courseDone()) return;
+
+  switch (seg.kind) {
+    case SEG_FOLLOW_UNTIL_OBSTACLE:
+      if (ev == CEV_OBSTACLE) advance(nowMs);
+      break;
+    case SEG_BYPASS_LEFT:
+      if (ev == CEV_BYPASS_DONE) advance(nowMs);
+      break;
+    case SEG_BRIDGE_GAPS:
+      if (ev == CEV_GAP_BRIDGED && ++hits >= seg.count) advance(nowMs);
+      break;
+    case SEG_STOP_ON_PAD:
+      if (ev == CEV_PAD && ++hits >= seg.count) advance(nowMs);
+      break;
+    case SEG_FOLLOW_UNTIL_VTURN:
+      if (ev == CEV_VTURN && ++hits >= seg.count) advance(nowMs);
+      break;
+    default:
+      break;
+  }
+}
+
+void courseTick(unsigned long nowMs) {
+  if (courseDone()) return;
+  if (seg.kind == SEG_FOLLOW && nowMs - segStartMs >= seg.ms) advance(nowMs);
+}
+
+const CourseSegment &courseSegment() { return seg; }
+
+uint8_t courseIndex() { return idx; }
+
+bool courseDone() { return idx >= segCount; }
+
+bool courseBridging(unsigned long nowMs) {
+  if (courseDone()) return false;
+  return seg.kind == SEG_BRIDGE_GAPS && nowMs - segStartMs >= seg.ms;
+}
@@ -0,0 +1,79 @@
+#include "governor.h"
+
+namespace {
+
+int speed = 0;
+unsigned long lastStepMs = 0;
+unsigned long stableSinceMs = 0; // 巡线状态稳定的起点
+unsigned long brakeUntilMs = 0;  // 外部要求减速，到此时刻前目标不超过 brakeCap
+int brakeCap = 0;
+unsigned long sideSinceMs = 0;   // 当前单侧压线的开始时刻
+uint8_t lastState = 0;
+int8_t curveStart = 0;
+
+int target(unsigned long nowMs, int base) {
+  if (base >= GOV_TOP_SPEED) return base;
+
+  unsigned long stable = nowMs - stableSinceMs;
+  if (stable <= GOV_STABLE_MS) return base;
+  stable -= GOV_STABLE_MS;
+  if (stable >= (1UL << GOV_RAMP_SHIFT)) return GOV_TOP_SPEED;
+
+  long span = GOV_TOP_SPEED - base;
+  return base + (int)((span * (long)stable) >> GOV_RAMP_SHIFT);
+}
+
+} // namespace
+
+void governorReset(int s, unsigned long nowMs) {
+  speed = s;
+  lastStepMs = nowMs;
+  stableSinceMs = nowMs;
+  brakeUntilMs = nowMs;
+  sideSinceMs = nowMs;
+  lastState = 0;
+  curveStart = 0;
+}
+
+int governorUpdate(uint8_t valL, uint8_t valR, int8_t lastDir, unsigned long nowMs, int base) {
+  uint8_t state = (valL ? 1 : 0) | (valR ? 2 : 0);
+  bool curve = false;
+
+  if (state != lastState) {
+    sideSinceMs = nowMs;
+    lastState = state;
+    if (state == 0b01 || state == 0b10) {
+      // 新的一次单侧压线（lastDir 还是上一次的）：同侧说明没翻转，线在持续偏向一边
+      int8_t side = state == 0b01 ? -1 : 1;
+      if (side == lastDir) curve = true;
+    }
+  }
+
+  // 单侧压线拖长（转向快饱和）或双黑（急弯、路口）也算不稳定
+  if ((state == 0b01 || state == 0b10) && nowMs - sideSinceMs > GOV_BRAKE_HOLD_MS) curve = true;
+  // 稳定直行到足以加起速来之后第一次判为弯道，记作一个弯道起点（只看时间，与是否被要求减速无关）
+  curveStart = 0;
+  if (curve && nowMs - stableSinceMs > GOV_CURVE_STABLE_MS) curveStart = state == 0b01 ? -1 : 1;
+  if (curve || state == 0b11) stableSinceMs = nowMs;
+
+  if (speed < base) speed = base;
+  int goal = nowMs == stableSinceMs ? base : target(nowMs, base);
+  if ((long)(brakeUntilMs - nowMs) > 0 && goal > brakeCap) goal = brakeCap > base ? brakeCap : base;
+
+  // 按周期限幅逼近目标，减速步长比加速大
+  while (nowMs - lastStepMs >= GOV_PERIOD_MS) {
+    lastStepMs += GOV_PERIOD_MS;
+    if (speed < goal) speed = speed + GOV_ACCEL < goal ? speed + GOV_ACCEL : goal;
+    else if (speed > goal) speed = speed - GOV_DECEL > goal ? speed - GOV_DECEL : goal;
+  }
+  return speed;
+}
+
+void governorBrake(unsigned long nowMs, int cap) {
+  brakeUntilMs = nowMs + GOV_BRAKE_MS;
+  brakeCap = cap;
+}
+
+int8_t governorCurveStart() { return curveStart; }
+
+int governorSpeed() { return speed; }
@@ -0,0 +1,192 @@
+#include "hal.h"
+#include "lap.h"
+
+namespace {
+
+const uint8_t HDR_LEN = 6;
+const uint16_t DATA = LAP_EEPROM_BASE + HDR_LEN;
+
+uint8_t mode = LAP_LEARN;
+uint16_t length = 0;      // 学习：已排队的字节数；比赛：读入的记录长度
+unsigned long anchorMs = 0; // 上一个事件的时刻
+
+// 学习模式的写队列
+uint8_t queue[LAP_QUEUE];
+uint8_t qHead = 0, qCount = 0;
+uint16_t written = 0;     // 已写进 EEPROM 的数据字节数
+uint16_t headerLen = 0xFFFF;
+uint8_t flags = 0, headerFlags = 0xFF;
+uint8_t hdr[HDR_LEN];
+uint8_t hdrIdx = HDR_LEN; // 正在写的头字节，HDR_LEN 表示没有
+bool full = false;
+
+// 比赛模式：下一条预期记录
+uint16_t cursor = 0;
+uint8_t nextKind = 0xFF;
+unsigned long nextDeltaMs = 0;
+uint16_t nextExtra = 0;
+
+uint8_t readByte(uint16_t addr) { return eeprom_read_byte((const uint8_t *)(uintptr_t)addr); }
+
+// 从 off 解一条记录，off 移到下一条；越界或格式不对返回 false
+bool decode(uint16_t &off, uint8_t &kind, unsigned long &deltaMs, uint16_t &extraAt) {
+  uint32_t v = 0;
+  for (uint8_t shift = 0;; shift += 7) {
+    if (off >= length || shift > 28) return false;
+    uint8_t b = readByte(DATA + off++);
+    v |= (uint32_t)(b & 0x7F) << shift;
+    if (!(b & 0x80)) break;
+  }
+  kind = v & 0x07;
+  deltaMs = (v >> 3) << LAP_TIME_SHIFT;
+  extraAt = off;
+  if (kind == LAP_BYPASS) {
+    if (off >= length) return false;
+    off++;
+  }
+  return true;
+}
+
+void peek() {
+  uint16_t off = cursor;
+  if (!decode(off, nextKind, nextDeltaMs, nextExtra)) nextKind = 0xFF;
+}
+
+bool push(const uint8_t *bytes, uint8_t n) {
+  if (full || length + n > LAP_MAX_BYTES || qCount + n > LAP_QUEUE) {
+    full = true; // 写不下就停止学习，已记下的部分仍然有效
+    return false;
+  }
+  for (uint8_t i = 0; i < n; i++) queue[(qHead + qCount + i) % LAP_QUEUE] = bytes[i];
+  qCount += n;
+  length += n;
+  return true;
+}
+
+// 学习：清空写队列，头在下一次 lapService() 改成长度 0，旧记录作废
+void learn() {
+  mode = LAP_LEARN;
+  length = 0;
+  cursor = 0;
+  nextKind = 0xFF;
+  qHead = qCount = 0;
+  written = 0;
+  headerLen = 0xFFFF;
+  headerFlags = 0xFF;
+  hdrIdx = HDR_LEN;
+  flags = 0;
+  full = false;
+}
+
+} // namespace
+
+void lapBegin(unsigned long nowMs) {
+  anchorMs = nowMs;
+  length = 0;
+  cursor = 0;
+  nextKind = 0xFF;
+
+  uint16_t len = readByte(LAP_EEPROM_BASE + 4) | ((uint16_t)readByte(LAP_EEPROM_BASE + 5) << 8);
+  // 没学到终点黑块的记录（学习圈中途断电、停车）不完整，不能拿来比赛
+  bool valid = readByte(LAP_EEPROM_BASE) == 'L' && readByte(LAP_EEPROM_BASE + 1) == 'P' &&
+               readByte(LAP_EEPROM_BASE + 2) == LAP_VERSION && (readByte(LAP_EEPROM_BASE + 3) & LAP_COMPLETE) &&
+               len > 0 && len <= LAP_MAX_BYTES;
+#ifdef LAP_RELEARN
+  valid = false;
+#endif
+
+  if (valid) {
+    mode = LAP_RACE;
+    length = len;
+    peek();
+    return;
+  }
+  learn();
+}
+
+void lapRelearn(unsigned long nowMs) {
+  anchorMs = nowMs;
+  learn();
+}
+
+uint8_t lapMode() { return mode; }
+
+void lapEvent(uint8_t ev, unsigned long nowMs, uint8_t extra) {
+  if (mode == LAP_RACE) {
+    // 按顺序对齐；对不上时往后找几条（漏检或多检了一个事件）
+    uint16_t off = cursor;
+    for (uint8_t i = 0; i <= LAP_RESYNC; i++) {
+      uint8_t kind;
+      unsigned long d;
+      uint16_t e;
+      if (!decode(off, kind, d, e)) return;
+      if (kind == ev) {
+        cursor = off;
+        anchorMs = nowMs;
+        peek();
+        return;
+      }
+    }
+    return;
+  }
+
+  unsigned long units = (nowMs - anchorMs) >> LAP_TIME_SHIFT;
+  anchorMs = nowMs;
+  uint32_t v = ((uint32_t)units << 3) | (ev & 0x07);
+
+  uint8_t buf[6];
+  uint8_t n = 0;
+  do {
+    uint8_t b = v & 0x7F;
+    v >>= 7;
+    buf[n++] = v ? (b | 0x80) : b;
+  } while (v);
+  if (ev == LAP_BYPASS) buf[n++] = extra;
+
+  if (push(buf, n) && ev == LAP_PAD) flags |= LAP_COMPLETE;
+}
+
+void lapService() {
+  if (mode != LAP_LEARN || !eeprom_is_ready()) return;
+
+  // 先写数据，队列空了再更新头里的长度，断电时头里的长度不会超过已写的数据
+  if (qCount) {
+    eeprom_update_byte((uint8_t *)(uintptr_t)(DATA + written), queue[qHead]);
+    qHead = (qHead + 1) % LAP_QUEUE;
+    qCount--;
+    written++;
+    return;
+  }
+
+  if (hdrIdx < HDR_LEN) {
+    eeprom_update_byte((uint8_t *)(uintptr_t)(LAP_EEPROM_BASE + hdrIdx), hdr[hdrIdx]);
+    hdrIdx++;
+    return;
+  }
+
+  if (written != headerLen || flags != headerFlags) {
+    headerLen = written;
+    headerFlags = flags;
+    hdr[0] = 'L';
+    hdr[1] = 'P';
+    hdr[2] = LAP_VERSION;
+    hdr[3] = flags;
+    hdr[4] = written & 0xFF;
+    hdr[5] = written >> 8;
+    hdrIdx = 0;
+  }
+}
+
+bool lapExpect(uint8_t mask, unsigned long nowMs, unsigned long leadMs) {
+  if (mode != LAP_RACE || nextKind == 0xFF || !(mask & (1 << nextKind))) return false;
+  unsigned long due = anchorMs + nextDeltaMs;
+  return (long)(nowMs + leadMs - due) >= 0 && (long)(due + LAP_LATE_MS - nowMs) >= 0;
+}
+
+bool lapBypassPlan(uint8_t &extra) {
+  if (mode != LAP_RACE || nextKind != LAP_BYPASS) return false;
+  extra = readByte(DATA + nextExtra);
+  return true;
+}
+
+uint16_t lapLength() { return length; }
@@ -0,0 +1,137 @@
+#include "hal.h"
+#include "lineadc.h"
+
+#ifdef LINE_ANALOG
+
+namespace {
+
+volatile uint8_t raw[2];          // 中断写，最新读数
+volatile uint8_t lo[2], hi[2];    // 标定期间中断写
+volatile bool calibrating = false;
+volatile bool calChanged = false;
+
+unsigned long calSinceMs = 0;  // 两路都标定够用的时刻
+uint16_t scale[2] = {0, 0};
+uint8_t snapshot = 0;
+int16_t position = 0;
+int8_t side = 0;
+bool lost = true;
+
+void store(uint8_t ch, uint8_t v) {
+  raw[ch] = v;
+  if (!calibrating) return;
+  if (v < lo[ch]) {
+    lo[ch] = v;
+    calChanged = true;
+  }
+  if (v > hi[ch]) {
+    hi[ch] = v;
+    calChanged = true;
+  }
+}
+
+#ifdef ARDUINO
+
+const uint8_t ADMUX_BASE = _BV(REFS0) | _BV(ADLAR); // AVcc 参考，左对齐
+const uint8_t ADPS_BITS = LINE_ADC_PRESCALE == 16 ? _BV(ADPS2)
+                          : LINE_ADC_PRESCALE == 32 ? (_BV(ADPS2) | _BV(ADPS0))
+                          : LINE_ADC_PRESCALE == 64 ? (_BV(ADPS2) | _BV(ADPS1))
+                                                    : (_BV(ADPS2) | _BV(ADPS1) | _BV(ADPS0));
+
+uint8_t mux[2];
+uint8_t curCh = 0;   // 刚转换完的那一路
+uint8_t nextCh = 0;  // 已经开始的那次转换的通道
+
+#else
+
+uint8_t pinOf[2];
+
+#endif
+
+} // namespace
+
+#ifdef ARDUINO
+// 自由运行模式下进中断时下一次转换已经开始，这里改的通道从再下一次起生效
+ISR(ADC_vect) {
+  store(curCh, ADCH);
+  curCh = nextCh;
+  nextCh ^= 1;
+  ADMUX = ADMUX_BASE | mux[nextCh];
+}
+#endif
+
+void lineAdcBegin(uint8_t pinL, uint8_t pinR) {
+  HAL_ATOMIC {
+    for (uint8_t c = 0; c < 2; c++) {
+      raw[c] = 0;
+      lo[c] = 0xFF;
+      hi[c] = 0;
+      scale[c] = 0;
+    }
+    calibrating = true;
+    calChanged = false;
+  }
+  calSinceMs = millis();
+  snapshot = 0;
+  position = 0;
+  side = 0;
+  lost = true;
+
+#ifdef ARDUINO
+  mux[0] = pinL - A0;
+  mux[1] = pinR - A0;
+  DIDR0 |= _BV(mux[0]) | _BV(mux[1]);
+  curCh = nextCh = 0;
+  ADMUX = ADMUX_BASE | mux[0];
+  ADCSRB = 0; // 自由运行
+  ADCSRA = _BV(ADEN) | _BV(ADSC) | _BV(ADATE) | _BV(ADIF) | _BV(ADIE) | ADPS_BITS;
+#else
+  pinOf[0] = pinL;
+  pinOf[1] = pinR;
+#endif
+}
+
+void lineAdcUpdate(unsigned long nowMs) {
+#ifndef ARDUINO
+  // 主机上没有 ADC 中断，每步按当前电平各转换一次
+  for (uint8_t c = 0; c < 2; c++) store(c, (uint8_t)(analogRead(pinOf[c]) >> 2));
+#endif
+  uint8_t r[2], l[2], h[2];
+  bool changed;
+  HAL_ATOMIC {
+    for (uint8_t c = 0; c < 2; c++) {
+      r[c] = raw[c];
+      l[c] = lo[c];
+      h[c] = hi[c];
+    }
+    changed = calChanged;
+    calChanged = false;
+  }
+  // 除法只在标定范围变了时做，冻结以后不再有
+  if (changed) {
+    scale[0] = lineAdcScale(l[0], h[0]);
+    scale[1] = lineAdcScale(l[1], h[1]);
+  }
+  if (calibrating) {
+    if (!scale[0] || !scale[1]) calSinceMs = nowMs;
+    else if (nowMs - calSinceMs >= LINE_ADC_CAL_MS) calibrating = false;
+  }
+
+  uint8_t nL = lineAdcNormalize(r[0], l[0], scale[0]);
+  uint8_t nR = lineAdcNormalize(r[1], l[1], scale[1]);
+  snapshot = (nL >= LINE_ADC_BLACK ? 1 : 0) | (nR >= LINE_ADC_BLACK ? 2 : 0);
+  lost = (int16_t)nL + nR < LINE_ADC_LOST;
+  position = lineAdcPositionOf(nL, nR, side);
+}
+
+uint8_t lineAdcSnapshot() { return snapshot; }
+
+int16_t lineAdcPosition() { return position; }
+
+bool lineAdcLost() { return lost; }
+
+int8_t lineAdcSide() { return side; }
+
+bool lineAdcCalibrating() { return calibrating; }
+
+#endif
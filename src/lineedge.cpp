@@ -0,0 +1,60 @@
+#include "hal.h"
+#include "lineedge.h"
+#include "pinchange.h"
+
+namespace {
+
+// 编译器屏障：先写完数据再移动下标，先读下标再读数据（AVR 单核，不需要硬件屏障）
+#define LINE_EDGE_BARRIER() __asm__ __volatile__("" ::: "memory")
+
+const uint8_t MASK = LINE_EDGE_QUEUE - 1;
+
+LineEdge queue[LINE_EDGE_QUEUE];
+volatile uint8_t head = 0;   // 中断写
+volatile uint8_t tail = 0;   // 主循环写
+volatile uint16_t drops = 0; // 中断写
+
+uint8_t bitL = 0, bitR = 0;
+
+// 引脚变化中断里调用
+void onEdge(uint8_t pins, uint8_t changed) {
+  (void)changed;
+  uint8_t h = head;
+  if ((uint8_t)(h - tail) >= LINE_EDGE_QUEUE) {
+    if (drops != 0xFFFF) drops = drops + 1;
+    return;
+  }
+  LineEdge &e = queue[h & MASK];
+  e.us = micros();
+  e.state = ((pins & bitL) ? 1 : 0) | ((pins & bitR) ? 2 : 0);
+  LINE_EDGE_BARRIER();
+  head = h + 1;
+}
+
+} // namespace
+
+void lineEdgeBegin(uint8_t pinL, uint8_t pinR) {
+  bitL = pinChangeBit(pinL);
+  bitR = pinChangeBit(pinR);
+  HAL_ATOMIC {
+    head = tail = 0;
+    drops = 0;
+  }
+  pinChangeAttach(bitL | bitR, onEdge);
+}
+
+bool lineEdgePop(LineEdge &e) {
+  uint8_t t = tail;
+  if (t == head) return false;
+  LINE_EDGE_BARRIER();
+  e = queue[t & MASK];
+  LINE_EDGE_BARRIER();
+  tail = t + 1;
+  return true;
+}
+
+uint16_t lineEdgeDrops() {
+  uint16_t n;
+  HAL_ATOMIC { n = drops; }
+  return n;
+}
@@ -0,0 +1,83 @@
+#include "linepd.h"
+
+namespace {
+
+int16_t err = 0;        // Q8.8
+int16_t errSample = 0;  // 上一个采样周期的误差
+int16_t dFilt = 0;      // 滤波后的每周期误差变化量，Q8.8
+int32_t iAcc = 0;       // 积分项（已乘 KI），Q16.16
+unsigned long lastSampleMs = 0;
+unsigned long stateSinceMs = 0;
+uint8_t lastState = 0xFF;
+
+int16_t estimate(uint8_t state, int8_t lastDir, unsigned long nowMs) {
+  unsigned long held = nowMs - stateSinceMs;
+  int16_t ramp = held >= LINE_RAMP_MS ? Q8_ONE : (int16_t)((held * LINE_RAMP_RECIP) >> 8);
+
+  switch (state) {
+    case 0b01: return -(Q8_ONE + ramp);  // 仅左侧黑
+    case 0b10: return Q8_ONE + ramp;     // 仅右侧黑
+    case 0b11: return 0;
+    default:
+      if (lastDir < 0) return -2 * Q8_ONE;
+      if (lastDir > 0) return 2 * Q8_ONE;
+      return err;
+  }
+}
+
+int16_t saturate(int32_t v, int16_t lim) {
+  if (v > lim) return lim;
+  if (v < -lim) return -lim;
+  return (int16_t)v;
+}
+
+// 用当前误差 err 更新微分/积分并算出转向量
+int16_t steer(unsigned long nowMs, int base, int minSpeed) {
+  // 微分和积分按固定周期采样，不依赖 loop 频率，也不需要除法
+  if (nowMs - lastSampleMs >= LINE_PD_PERIOD_MS) {
+    lastSampleMs = nowMs;
+    int16_t d = err - errSample;
+    errSample = err;
+    dFilt += (d - dFilt) >> LINE_D_FILTER_SHIFT;
+    if (LINE_KI_Q8 != 0) {
+      iAcc += (int32_t)LINE_KI_Q8 * err;
+      int32_t lim = LINE_I_LIMIT_Q8 << 8;
+      if (iAcc > lim) iAcc = lim;
+      if (iAcc < -lim) iAcc = -lim;
+    }
+  }
+
+  int32_t out = (int32_t)LINE_KP_Q8 * err + (int32_t)LINE_KD_Q8 * dFilt + iAcc; // Q16.16
+
+  // 慢轮不低于 minSpeed，快轮不超过 255
+  int16_t lim = base - minSpeed;
+  if (255 - base < lim) lim = 255 - base;
+  if (lim < 0) lim = 0;
+  return saturate(out >> 16, lim);
+}
+
+} // namespace
+
+void linePdReset() {
+  err = errSample = dFilt = 0;
+  iAcc = 0;
+  lastState = 0xFF;
+}
+
+int16_t linePdUpdate(uint8_t valL, uint8_t valR, int8_t lastDir, unsigned long nowMs, int base, int minSpeed) {
+  uint8_t state = (valL ? 0b01 : 0) | (valR ? 0b10 : 0);
+  if (state != lastState) {
+    lastState = state;
+    stateSinceMs = nowMs;
+  }
+  err = estimate(state, lastDir, nowMs);
+  return steer(nowMs, base, minSpeed);
+}
+
+int16_t linePdUpdatePosition(int16_t position, unsigned long nowMs, int base, int minSpeed) {
+  lastState = 0xFF; // 切回数字估计时重新计持续时间
+  err = position;
+  return steer(nowMs, base, minSpeed);
+}
+
+int16_t linePdError() { return err; }
@@ -1,26 +1,45 @@
-#include <Arduino.h>
-#include <Servo.h>
-
-// 左电机
-const int LEFT_PWM = 5;
-const int LEFT_DIR = 7;
-
-// 右电机
-const int RIGHT_PWM = 6;
-const int RIGHT_DIR = 4;
+#include "hal.h"
+
+#include "budget.h"
+#include "bypass.h"
+#include "control.h"
+#include "course.h"
+#include "course_isrc2025.h"
+#include "fastio.h"
+#include "governor.h"
+#include "lap.h"
+#include "lineadc.h"
+#include "lineedge.h"
+#include "linepd.h"
+#include "motion.h"
+#include "motor.h"
+#include "odometry.h"
+#include "patterns.h"
+#include "perf.h"
+#include "rangefilter.h"
+#include "ranging.h"
+#include "robot.h"
+#include "scanner.h"
+#include "telemetry.h"
+#include "trace.h"
+#ifdef TUNED_PARAMS
+#include "tuned_params.h" // tools/tune.py 在仿真里搜出的参数，-DTUNED_PARAMS 时覆盖下面 #ifndef 的默认值
+#endif
+
+// 电机接线与输出级（斜率、死区、刹车、PWM 频率）见 motor.h
 
 // 速度参数
-const int BASE_SPEED = 110;   // 巡线时基础速度
+const int BASE_SPEED = 110;   // 动作中使用的基础速度；巡线速度由赛程每段给出
 const int MIN_SPEED = 60;     // 最低速度，避免停转
-// const float KP = 0.18f;       // 先加到 0.16，若抖再回 0.14
-const int TURN_STRONG = 80;   // V 形急弯时给的强转差速
+// 转向增益见 linepd.h（LINE_KP / LINE_KD），定点计算
+#ifndef TURN_STRONG
+#define TURN_STRONG 80        // V 形急弯时给的强转差速
+#endif
 // const float TURN_SLOW = 0.6f; // 急弯/宽线时整体降速比例
 
 // 巡线传感器
 const int irPinL = A0;
 const int irPinR = A1;
-int valL = digitalRead(irPinL) == LOW ? 0 : 1;
-int valR = digitalRead(irPinR) == LOW ? 0 : 1;
 
 // 超声波传感器
 const int trigPin = A4;
@@ -37,10 +56,16 @@ const int SERVO_CENTER = 90;
 const int SERVO_LEFT = 30;
 // const int SERVO_RIGHT = 150;
 
-const int OBST = 25; // 障碍阈值（cm）
-const unsigned long PING_INTERVAL = 80; // 前向测距间隔（ms）
+// const int OBST = 25; // 原固定障碍阈值（cm），现按到达时间触发
+#ifndef OBST_STANDOFF
+#define OBST_STANDOFF 22   // 开始绕障时离障碍至少留的距离（cm），扫描和原地转向要用
+#endif
+#ifndef OBST_STOP_MS
+#define OBST_STOP_MS 110   // 决定绕障到车停下的时间（ms，电机惯性），按车速折成提前量
+#endif
+const int OBST_SLOW = 60; // 前方此距离内有东西就不再加速（cm）
 // const int OBST_CLEAR = 33;  // 清障判断：大于此距离认为前方无障碍
-const int SERVO_LEFT20 = 160; // 舵机左偏角，加大初始避障右转幅度
+// const int SERVO_LEFT20 = 160; // 舵机左偏角，加大初始避障右转幅度（现由 BYPASS_FOLLOW_ANGLE 给出）
 // const unsigned long BYPASS_FORWARD_MS = 1300; // 避障直行距离（约 22~26cm，需实测）
 // const unsigned long BYPASS_TURN90_MS = 476;   // 左转 90 度所需时间，需实测调整
 // const unsigned long BYPASS_PIVOT_MS = 400;    // 避障初始右转的最小时间（加长）
@@ -48,70 +73,92 @@ const int SERVO_LEFT20 = 160; // 舵机左偏角，加大初始避障右转幅
 // const unsigned long FORWARD_SEARCH_MS = 3000;   // 左转后直行找线的最长时间
 const unsigned long STEP_PAUSE_MS = 120;        // 步骤间停顿，避免动作连在一起
 const unsigned long AVOID_COOLDOWN_MS = 3000;   // 避障结束后忽略障碍检测的冷却
-const unsigned long GAP_HOLD_MS = 80;   // 双白保持多久才算 gap
-static unsigned long gapStartMs = 0;
-static bool gapStable = false;
 
-// 小车状态
-enum Mode { NORMAL, AVOID };
-Mode mode = NORMAL;
+// 小车状态（位域，见 robot.h）
+enum Mode : uint8_t { NORMAL, AVOID };
+RobotState robot = {};
 
-unsigned long lastPingMs = 0;
+uint8_t lastScanSeq = 0;
+uint8_t lastRangeSeq = 0; // 轨迹记录用：每个新测距结果记一条
+bool traceSent = false;   // 到达黑块后自动发出一次轨迹记录
+bool backgroundLate = false; // 上一轮后台超过预算，这一轮不发遥测
+bool gapLost = false;     // 跨 gap 逃生没找到线：重新压线之前按丢线搜索，不再跨 gap
 unsigned long avoidCooldownUntil = 0;
 
-// 记忆上次看到线的方向：-1 左、0 双线/未知、1 右
-int lastDir = 0;
-// 进度计数
-int obstaclesSeen = 1;  //记得归0
-int gapsSeen = 0;
-int padsSeen = 0;      // 大块黑区计数
-int vTurnsSeen = 0;
-bool finished = false; // 达到终点后停止
-bool originCleared = false; // 已离开起点黑块后才允许终点判定
-bool bridgeGaps = false; // 进入跨gap直行模式
-int gapsBridged = 0;     // 已跨过的 gap 数
-int correctionGap = 0;
-unsigned long bridgeGapsEnableAt = 0; // 第二个障碍结束后延迟开启跨 gap 的时间点
-
-// gap 与 pad 判定
-bool inGap = false, gapCounted = false;
-unsigned long gapStart = 0;
-bool inPad = false, padCounted = false;
-unsigned long padStart = 0;
-
-// V 形弯判定
-bool vActive = false;
-unsigned long vStart = 0;
+int16_t cruiseSpeed = BASE_SPEED; // 本轮巡线速度：赛程段速度经调速器加速后的结果
 
 // 参数：检测窗口
-const unsigned long GAP_DETECT_MS = 80;   // 白底持续视为 gap
+#ifndef GAP_DETECT_MS
+#define GAP_DETECT_MS 200       // 白底持续视为 gap（跨 gap 模式下）
+#endif
 const unsigned long PAD_DETECT_MS = 150;  // 双黑持续视为大黑块
-const unsigned long V_WINDOW_MS = 400;    // 单侧压线持续视为一次 V 转
+const unsigned long V_LOST_MS = 150;      // V 弯段里双白持续视为冲出 V 弯顶点
+
+// 赛道特征检测规则，下标即规则编号
+enum TrackRule : uint8_t { RULE_GAP, RULE_PAD, RULE_VTURN };
+enum TrackCounter : uint8_t { CNT_GAPS, CNT_PADS, CNT_VTURNS };
+
+const PatternRule TRACK_PATTERNS[] PROGMEM = {
+  {SNAP_BOTH_WHITE, PAT_HOLD, GAP_DETECT_MS, 0, CNT_GAPS},
+  // 终点黑块：只在赛程最后一段（SEG_STOP_ON_PAD）启用，起点黑框早已走过不会计入；
+  // V 弯顶点两灯也会压黑，这一段要等前一段 SEG_FOLLOW_UNTIL_VTURN 过了 V 弯才开始
+  {SNAP_BOTH_BLACK, PAT_HOLD, PAD_DETECT_MS, 0, CNT_PADS},
+  // V 弯：只在 SEG_FOLLOW_UNTIL_VTURN 段启用。第二个 gap 之后的直道巡线时双白只是一闪，丢线这么久就是冲出了顶点
+  {SNAP_BOTH_WHITE, PAT_HOLD, V_LOST_MS, 0, CNT_VTURNS},
+};
+
+uint8_t patternEvents = 0; // 本轮触发的规则位
+
+// 最近一次下发的电机指令（负值为反转），供遥测使用；实际输出由 motorUpdate() 按斜率逼近
+int16_t pwmCmdL = 0, pwmCmdR = 0;
 
-unsigned long now = millis();
+// 巡线头走直接端口读写，引脚在编译期绑定
+typedef FastPinPair<irPinL, irPinR> IrPins;
 
 void setForwardSpeeds(int leftPwm, int rightPwm) {
-  // 前进方向保持 HIGH，仅调节左右 PWM 差速
-  analogWrite(LEFT_PWM, constrain(leftPwm, 0, 255));
-  analogWrite(RIGHT_PWM, constrain(rightPwm, 0, 255));
-  digitalWrite(LEFT_DIR, HIGH);
-  digitalWrite(RIGHT_DIR, HIGH);
+  // 只前进，仅调节左右 PWM 差速
+  pwmCmdL = constrain(leftPwm, 0, 255);
+  pwmCmdR = constrain(rightPwm, 0, 255);
+  motorSet(pwmCmdL, pwmCmdR);
+}
+
+void setWheelSpeeds(int leftPwm, int rightPwm) {
+  // 带方向的输出：负值对应该轮反转
+  pwmCmdL = constrain(leftPwm, -255, 255);
+  pwmCmdR = constrain(rightPwm, -255, 255);
+  motorSet(pwmCmdL, pwmCmdR);
+}
+
+// 控制节拍中断里调用：两路在同一端口，一次读 PINC 保证左右是同一时刻的状态
+uint8_t sampleLine() { return IrPins::read(); }
+
+void readLine() {
+#ifdef LINE_ANALOG
+  // 模拟巡线头：ADC 中断里一直在采，这里按标定结果换成本步的快照和线位置
+  lineAdcUpdate(millis());
+  uint8_t s = lineAdcSnapshot();
+  robot.valL = s & 1;
+  robot.valR = s >> 1 & 1;
+#else
+  // 数字巡线头：典型为黑线 LOW、白底 HIGH，取反后黑线为 1、白为 0
+  // 用本节拍中断里采到的快照，采样时刻固定
+  uint8_t pins = controlSample();
+  robot.valL = (pins & IrPins::maskA) ? 1 : 0;
+  robot.valR = (pins & IrPins::maskB) ? 1 : 0;
+  // 上一步以来中断记下的边沿：两拍之间短暂见过黑也算黑，细线和短促的黑白变化不会漏掉
+  LineEdge e;
+  while (lineEdgePop(e)) {
+    robot.valL |= e.state & 1;
+    robot.valR |= e.state >> 1 & 1;
+  }
+#endif
 }
 
 long getDistance() {
-  digitalWrite(trigPin, LOW);
-  delayMicroseconds(2);
-  digitalWrite(trigPin, HIGH);
-  delayMicroseconds(10);
-  digitalWrite(trigPin, LOW);
-
-  long duration = pulseIn(echoPin, HIGH, 30000); // 30ms 超时
-  if (duration == 0) return 999; // 超时当作很远
-  float distance = duration * 0.034f / 2.0f;
-
-  //Serial.print("Distance: ");
-  //Serial.println(distance);
-  return (long)distance;
+  PERF_SCOPE(PERF_GET_DISTANCE);
+  // 异步测距：只取最近一次结果，不再用 pulseIn 阻塞等待回波
+  rangingUpdate();
+  return rangingDistance();
 }
 
 void forward() {
@@ -119,565 +166,436 @@ void forward() {
 }
 
 void stop() {
-  analogWrite(LEFT_PWM, 0);
-  analogWrite(RIGHT_PWM, 0);
-  digitalWrite(LEFT_DIR, HIGH);
-  digitalWrite(RIGHT_DIR, HIGH);
+  // 主动刹车：反向脉冲后归零
+  pwmCmdL = 0;
+  pwmCmdR = 0;
+  motorBrake();
 }
 
 void back() {
-  analogWrite(LEFT_PWM, BASE_SPEED);
-  analogWrite(RIGHT_PWM, BASE_SPEED);
-  digitalWrite(LEFT_DIR, LOW);
-  digitalWrite(RIGHT_DIR, LOW);
+  setWheelSpeeds(-BASE_SPEED, -BASE_SPEED);
 }
 
-void turnLeftBrief() {
-  analogWrite(LEFT_PWM, BASE_SPEED);
-  analogWrite(RIGHT_PWM, BASE_SPEED);
-  digitalWrite(LEFT_DIR, LOW);
-  digitalWrite(RIGHT_DIR, HIGH);
-  delay(250);
-  stop();
-}
+// 丢线搜索可稍微减小转向幅度
+#ifndef SEARCH_TURN
+#define SEARCH_TURN 50 // 原 70，可再微调
+#endif
 
-void turnRightBrief() {
-  analogWrite(LEFT_PWM, BASE_SPEED);
-  analogWrite(RIGHT_PWM, BASE_SPEED);
-  digitalWrite(LEFT_DIR, HIGH);
-  digitalWrite(RIGHT_DIR, LOW);
-  delay(250);
-  stop();
-}
+// 丢线搜索：单侧轮转动，保持 10ms 给转向一点实际执行时间
+const MotionStep SEARCH_LEFT[] PROGMEM = {
+  {ACT_DRIVE, COND_NONE, 0, MIN_SPEED + SEARCH_TURN, SERVO_KEEP, 10, 0},
+};
+
+const MotionStep SEARCH_RIGHT[] PROGMEM = {
+  {ACT_DRIVE, COND_NONE, MIN_SPEED + SEARCH_TURN, 0, SERVO_KEEP, 10, 0},
+};
 
 void lineFollow() {
-  // 数字巡线头：典型为黑线 LOW、白底 HIGH，取反后黑线为 1、白为 0
-  valL = digitalRead(irPinL) == LOW ? 0 : 1;
-  valR = digitalRead(irPinR) == LOW ? 0 : 1;
-
-  // 更新行进进度（gap、pad、V 转统计）
-  now = millis();
-
-  // // pad 检测：双黑持续一段时间
-  // if (valL == 1 && valR == 1) {
-  //   if (!inPad) {
-  //     inPad = true;
-  //     padCounted = false;
-  //     padStart = now;
-  //   } else if (!padCounted && (now - padStart) >= PAD_DETECT_MS) {
-  //     padsSeen++;
-  //     padCounted = true;
-  //   }
-  // } else {
-  //   inPad = false;
-  //   padCounted = false;
-  //   // 只要离开过第一块黑区，允许后续黑块作为终点判断
-  //   if (padsSeen > 0) originCleared = true;
-  // }
-
-  // 跨 gap 模式：在第二个障碍之后，连续直行跨过 2 个 gap，直到再次看到黑线
-  // if (bridgeGaps) {
-  //   bool bothWhite = (valL == 1 && valR == 1); // 你说白是 1
-  //   bool gap = false;
-  //   if (bothWhite) {
-  //     // myServo.write(60);
-  //     // delay(80);
-  //     // myServo.write(120);
-  //     // if (gapStartMs == 0) gapStartMs = now;
-  //     // if (!gapStable && now - gapStartMs >= GAP_HOLD_MS) {
-  //     //   gapStable = true;
-  //     //   gapsSeen++;
-  //     // }
-      
-  //     // gap 检测：双白持续一段时间
-  //     if (valL == 1 && valR == 1) {
-  //       if (!inGap) {
-  //         inGap = true;
-  //         gapCounted = false;
-  //         gapStart = now;
-
-  //         stop();
-  //         //测试
-  //         myServo.write(60);
-  //         delay(80);
-  //         myServo.write(120);
-  //         delay(80);
-  //         const int GAP_BIAS = 25;
-  //         if (correctionGap == 0) {
-  //           if (lastDir == 1) {
-  //             //测试
-  //             myServo.write(60);
-  //             delay(80);
-  //             myServo.write(120);
-  //             delay(80);
-  //             // 往右微调：左轮快一点
-  //             setForwardSpeeds(BASE_SPEED + GAP_BIAS, BASE_SPEED - GAP_BIAS);
-  //             delay(100);
-  //           } else if (lastDir == -1) {
-  //             //测试
-  //             myServo.write(60);
-  //             delay(80);
-  //             myServo.write(120);
-  //             delay(80);
-  //             // 往左微调：右轮快一点
-  //             setForwardSpeeds(BASE_SPEED - GAP_BIAS, BASE_SPEED + GAP_BIAS);
-  //             delay(100);
-  //           }
-  //           correctionGap = 1;
-  //         }
-  //         //第一个gap直走
-  //         setForwardSpeeds(BASE_SPEED, BASE_SPEED);
-  //         delay(900);
-  //       } else if (!gapCounted && (now - gapStart) >= GAP_DETECT_MS) {
-  //         gapsSeen++;
-  //         gapCounted = true;
-  //       }
-  //     } else {
-  //       inGap = false;
-  //       gapCounted = false;
-  //     }
-  //     // myServo.write(180);
-  //     // 仍在 gap 上，保持直行
-  //     // setForwardSpeeds(BASE_SPEED, BASE_SPEED);
-  //     return;
-  //   } else {
-  //     // gapStartMs = 0;
-  //     // gapStable = false;
-
-  //     // 从 gap 回到线，计数一次
-  //     gapsBridged++;
-  //     correctionGap = 0;
-  //     if (gapsBridged >= 2) {
-  //       bridgeGaps = false; // 完成两次 gap 跨越，恢复正常巡线
-  //     }
-  //     // 看到线就继续后面的正常巡线逻辑
-  //   }
-  //   // if (gapStable) {
-  //   //   setForwardSpeeds(BASE_SPEED, BASE_SPEED);
-  //   //   gap = true;
-  //   // } else {
-  //   //   gap = false;
-  //   // }
-  //   // if (((valL == 0 && valR == 1) || (valL == 1 && valR == 0)) && gap == true){
-  //   //   gapsBridged++;
-  //   //   if (gapsBridged >= 2) {
-  //   //     bridgeGaps = false; // 完成两次 gap 跨越，恢复正常巡线
-  //   //   }
-  //   //   gap = false;
-  //   // }
-  // }
-
-  // // V 弯检测：gap>=2 后，遇到单侧压线算一次 V 转
-  // if (gapsSeen >= 2 && vTurnsSeen < 2) {
-  //   if ((valL ^ valR) == 1) { // 单侧为 1
-  //     if (!vActive) {
-  //       vActive = true;
-  //       vStart = now;
-  //     }
-  //   } else {
-  //     if (vActive && (now - vStart) <= V_WINDOW_MS) {
-  //       vTurnsSeen++;
-  //     }
-  //     vActive = false;
-  //   }
-  // } else {
-  //   vActive = false;
-  // }
-
-  // 如果已离开起点且再次踩到大黑块，则认为到达终点
-  if (originCleared && padsSeen >= 2) {
-    stop();
-    finished = true;
-    return;
-  }
+  PERF_SCOPE(PERF_LINE_FOLLOW);
+  // gap、pad、V 转统计由 loop() 里的 patternUpdate 统一完成
+  unsigned long now = millis();
 
   // 起点为白底（黑框内），先直走，直到首次压到黑线/黑底才进入正常巡线
-  if (!originCleared) {
-    if (valL == 1 || valR == 1) {
-      originCleared = true; // 看到黑后开始正常巡线
+  if (!robot.originCleared) {
+    if (robot.valL == 1 || robot.valR == 1) {
+      robot.originCleared = true; // 看到黑后开始正常巡线
     } else {
-      setForwardSpeeds(BASE_SPEED, BASE_SPEED);
+      setForwardSpeeds(cruiseSpeed, cruiseSpeed);
       return;
     }
   }
 
-  //Serial.print("IR L = "); //Serial.print(valL);
-  //Serial.print("  IR R = "); //Serial.println(valR);
+  // 丢线计时：双白开始、重新压线结束；超过预算还没找到就换另一边找。gap 里的双白交给跨 gap
+  if (robot.valL == 1 || robot.valR == 1) budgetStop(BUDGET_SEARCH, now);
+  else if (robot.bridgeGaps) budgetCancel(BUDGET_SEARCH);
+  else if (!budgetRunning(BUDGET_SEARCH)) budgetStart(BUDGET_SEARCH, now);
+  else if (budgetExpired(BUDGET_SEARCH, now)) {
+    robot.lastDir = robot.lastDir <= 0 ? 1 : -1;
+    budgetStart(BUDGET_SEARCH, now);
+  }
 
+#ifdef LINE_ANALOG
+  // 模拟巡线头：连续的线位置直接作 PD 误差，线在两路之间也照常修正，只有丢线才搜线
+  if (!lineAdcLost()) {
+    int steer = linePdUpdatePosition(lineAdcPosition(), now, cruiseSpeed, MIN_SPEED);
+    setForwardSpeeds(cruiseSpeed + steer, cruiseSpeed - steer);
+    if (lineAdcSide()) robot.lastDir = lineAdcSide();
+    return;
+  }
+#else
+  // PD 转向：误差由左右状态及其持续时间估计，steer < 0 表示线在左
+  int steer = linePdUpdate(robot.valL, robot.valR, robot.lastDir, now, cruiseSpeed, MIN_SPEED);
 
   // 线在左：左稍慢，右稍快，保持前进
-  if (valL == 1 && valR == 0) {
-    const int DIFF = 25; // 可调 30~50
-    setForwardSpeeds(constrain(BASE_SPEED - DIFF, MIN_SPEED, 255),
-                     constrain(BASE_SPEED + DIFF, MIN_SPEED, 255));
-    lastDir = -1;
+  if (robot.valL == 1 && robot.valR == 0) {
+    setForwardSpeeds(cruiseSpeed + steer, cruiseSpeed - steer);
+    robot.lastDir = -1;
     return;
   }
 
   // 线在右：右稍慢，左稍快
-  if (valL == 0 && valR == 1) {
-    const int DIFF = 35;
-    setForwardSpeeds(constrain(BASE_SPEED + DIFF, MIN_SPEED, 255),
-                     constrain(BASE_SPEED - DIFF, MIN_SPEED, 255));
-    lastDir = 1;
+  if (robot.valL == 0 && robot.valR == 1) {
+    setForwardSpeeds(cruiseSpeed + steer, cruiseSpeed - steer);
+    robot.lastDir = 1;
     return;
   }
+#endif
 
-  // 丢线搜索可稍微减小转向幅度
-  const int SEARCH_TURN = 50; // 原 70，可再微调
-  if (!bridgeGaps) {
-  if (lastDir <= 0) {
+  if (!robot.bridgeGaps) {
+  if (robot.lastDir <= 0) {
     // 上次在左或未知：左轮停右轮转，继续向左找
-    setForwardSpeeds(0, MIN_SPEED + SEARCH_TURN);
-    delay(10); // 短暂停留，给转向一点实际执行时间
+    motionStart(SEARCH_LEFT, 1);
   } else {
     // 上次在右：右轮停左轮转，向右找
-    setForwardSpeeds(MIN_SPEED + SEARCH_TURN, 0);
-    delay(10); // 短暂停留，给转向一点实际执行时间
+    motionStart(SEARCH_RIGHT, 1);
   }
   }
 }
 
-void Gaps() {
-  now = millis();
+// 跨 gap：沿离线前的线（最后压线的点 + 巡线时的线方向）直行到重新压线，
+// 航位推算保持航向并把车拉回线的延长线上，不再按 lastDir 打固定时长的微调
+const MotionStep GAP_BRIDGE[] PROGMEM = {
+  {ACT_GO, COND_NOT_BOTH_WHITE, BASE_SPEED, 0, SERVO_KEEP, 0, 0},
+  {ACT_DRIVE, COND_NONE, 0, 0, SERVO_KEEP, 0, 0},
+};
+
+// 跨 gap 超时的逃生：多半是把丢线当成了 gap，或者 gap 后航向偏了。停车，沿原航向倒回去，
+// 压到线（离线的地方）就停，回到巡线；最多倒一个预算的时间，走过多远就退多远。
+// 还是没压到线就不再当 gap，交给丢线搜索（gapLost）
+const MotionStep GAP_ESCAPE[] PROGMEM = {
+  {ACT_BRAKE, COND_NONE, 0, 0, SERVO_KEEP, STEP_PAUSE_MS, 0},
+  {ACT_GO, COND_ANY_BLACK, -BASE_SPEED, 0, SERVO_KEEP, BUDGET_GAP_MS, 0},
+  {ACT_DRIVE, COND_NONE, 0, 0, SERVO_KEEP, 0, 0},
+};
+
+void gapBridged() {
+  budgetStop(BUDGET_GAP, millis());
+  if (robot.gapsBridged < 7) robot.gapsBridged++;
+  courseEvent(CEV_GAP_BRIDGED, millis());
+  governorReset(courseSegment().speed, millis()); // 跨完 gap 从段速度重新加速
+}
 
-    valL = digitalRead(irPinL) == LOW ? 0 : 1;
-    valR = digitalRead(irPinR) == LOW ? 0 : 1;
-    now = millis();
+void Gaps() {
+    PERF_SCOPE(PERF_GAPS);
     digitalWrite(debugLEDGreen, LOW);
     digitalWrite(debugLEDRed, HIGH);
 
-    if (gapsSeen >= 2) {
-      bridgeGaps = false;
-      stop();
-    }
-    else if (valL == 0 && valR == 0) { // 白色
-      if (gapStartMs == 0) gapStartMs = now;
-      if (!gapStable && (now - gapStartMs >= 200)) {
-        gapStable = true;
-        gapsSeen++;
-      }
-      if (gapStable) {
-        digitalWrite(debugLEDGreen, HIGH);
-        digitalWrite(debugLEDYellow, HIGH);
-        if (correctionGap == 0) {
-          digitalWrite(debugLEDGreen, LOW);
-          digitalWrite(debugLEDYellow, LOW);
-          digitalWrite(debugLEDRed, LOW);
-          if (lastDir == 1) {
-            // 往右微调：左轮快一点
-            setForwardSpeeds(135, 80);
-            delay(75);
-          } else if (lastDir == -1) {
-            // 往左微调：右轮快一点
-            setForwardSpeeds(80, 135);
-            delay(75);
-          }
-          correctionGap = 1;
-        }
-        digitalWrite(debugLEDGreen, HIGH);
-        digitalWrite(debugLEDYellow, HIGH);
-        digitalWrite(debugLEDRed, HIGH);
-
-        // setForwardSpeeds(BASE_SPEED, BASE_SPEED);
-        // if (gapsSeen == 1) delay(350);
-        // else delay(250);
-        valL = digitalRead(irPinL) == LOW ? 0 : 1;
-        valR = digitalRead(irPinR) == LOW ? 0 : 1;
-        while (valL == 0 && valR == 0) {
-          setForwardSpeeds(BASE_SPEED, BASE_SPEED);
-          valL = digitalRead(irPinL) == LOW ? 0 : 1;
-          valR = digitalRead(irPinR) == LOW ? 0 : 1;
-        }
-        stop();
-      }
-    } else {
-      gapStartMs = 0;
-    }
-
-    if (gapsSeen!=0 && (valL == 1 || valR == 1)) {
-      gapStable = false;
+    // 双白持续 GAP_DETECT_MS 即确认为 gap（RULE_GAP 触发），跨越交给动作调度，期间三灯全亮
+    if (patternEvents & (1 << RULE_GAP)) {
+      digitalWrite(debugLEDGreen, HIGH);
+      digitalWrite(debugLEDYellow, HIGH);
+      motionStart(GAP_BRIDGE, sizeof(GAP_BRIDGE) / sizeof(GAP_BRIDGE[0]), gapBridged);
+      motionTrack(odomLineX(), odomLineY(), odomLineHeading());
+      budgetStart(BUDGET_GAP, millis());
+      return;
     }
     digitalWrite(debugLEDRed, LOW);
     digitalWrite(debugLEDGreen, HIGH);
 }
 
-void vTurn() {
-  // V 形急弯强化：双黑时整体降速直行
-  if (valL == 1 && valR == 1) {
-    int slow = (int)(BASE_SPEED * 0.7f); // 原来 0.6，可稍快一点
-    setForwardSpeeds(constrain(slow, MIN_SPEED, 255), constrain(slow, MIN_SPEED, 255));
-    lastDir = 0;
-    return;
-  }
-
+// 闭环绕障：先扫描选侧，原地转到侧面看见障碍，再按比例控制贴墙绕行。
+// 下面按“障碍在左、从右边绕”写，扫描结果为另一侧时由动作调度整体镜像。
+// 转向的上限是相对到达障碍前的线方向的角度（航位推算，见 odometry.h），不随电池电压变。
+const int AVOID_SPEED = 100;
+const int AVOID_PIVOT = 120;  // 原地转向找障碍侧面
+const int AVOID_PIVOT_MAX_DEG = 80; // 转到线方向右侧这么多度还没看到障碍，也开始贴墙
+const int AVOID_REJOIN_TURN = MIN_SPEED + TURN_STRONG + 20;
+
+const MotionStep AVOID_SEQ[] PROGMEM = {
+  {ACT_DRIVE, COND_NONE, 0, 0, SERVO_KEEP, 0, 0},
+  {ACT_SCAN, COND_NONE, 0, 0, SERVO_KEEP, 0, 0},
+  // 右转，超声朝左前，直到侧面测到障碍
+  {ACT_TURN, COND_WALL_SEEN, AVOID_PIVOT, -AVOID_PIVOT_MAX_DEG, SERVO_CENTER + BYPASS_FOLLOW_ANGLE, 0, 0},
+  // 贴墙绕行：先离开黑线，再绕到重新压线
+  {ACT_WALL_FOLLOW, COND_BOTH_WHITE, AVOID_SPEED + 30, 0, SERVO_KEEP, 600, 0},
+  {ACT_WALL_FOLLOW, COND_ANY_BLACK, AVOID_SPEED + 30, 0, SERVO_KEEP, 0, 0},
+  {ACT_DRIVE, COND_NONE, 0, 0, SERVO_KEEP, 0, 0},
+  // 黑 白：直行越过线再停
+  {ACT_SKIP, COND_NOT_LEFT_ONLY, 0, 0, SERVO_KEEP, 0, 4},
+  {ACT_DRIVE, COND_NOT_LEFT_ONLY, BASE_SPEED, BASE_SPEED, SERVO_KEEP, 0, 0},
+  {ACT_HOLD, COND_NONE, 0, 0, SERVO_KEEP, 300, 0},
+  {ACT_DRIVE, COND_NONE, 0, 0, SERVO_KEEP, 0, 0},
+  {ACT_SKIP, COND_ALWAYS, 0, 0, SERVO_KEEP, 0, 1},
+  // 其余情况：右转直到只有一侧压线
+  {ACT_DRIVE, COND_ONE_SIDE, AVOID_REJOIN_TURN, 0, SERVO_KEEP, 0, 0},
+  {ACT_HOLD, COND_NONE, 0, 0, SERVO_KEEP, 150, 0},
+  {ACT_DRIVE, COND_NONE, 0, 0, SERVO_CENTER, STEP_PAUSE_MS, 0},
+};
+
+void avoidDone() {
+  budgetStop(BUDGET_BYPASS, millis());
+  if (robot.obstaclesSeen < 7) robot.obstaclesSeen++;
+  // 从右边绕回来时车头朝左越过黑线，线在车的右侧；镜像时相反
+  robot.lastDir = bypassPlan().mirror ? -1 : 1;
+  avoidCooldownUntil = millis() + AVOID_COOLDOWN_MS;
+  rangeFilterReset();
+  robot.mode = NORMAL;
+  courseEvent(CEV_BYPASS_DONE, millis());
+  const BypassPlan &plan = bypassPlan();
+  lapEvent(LAP_BYPASS, millis(), (plan.mirror ? 0x80 : 0) | (plan.targetCm & 0x7F));
+  governorReset(courseSegment().speed, millis());
 }
 
 void avoidObstacle() {
-  // 新策略：偏左绕障
-  stop();
-  delay(2 * STEP_PAUSE_MS);
-
-  //右转
-  setForwardSpeeds(190, 0);
-  delay(250);
-  stop();
-  delay(STEP_PAUSE_MS);
-
-  //直走
-  setForwardSpeeds(BASE_SPEED, BASE_SPEED);
-  delay(100);
-  stop();
-  delay(STEP_PAUSE_MS);
-
-  // 将超声转到左 45 度，原地右转直到视野中无障碍或超时，且至少转一小段
-  myServo.write(SERVO_LEFT20);
-  delay(80);
-
-  int AVOID_SPEED = 100;
-  bool foundLine = false;
-  while (!foundLine) {
-    valL = digitalRead(irPinL) == LOW ? 0 : 1;
-    valR = digitalRead(irPinR) == LOW ? 0 : 1;
-    if (valL == 1 || valR == 1) {
-      foundLine = false;
-      break;
-    }
-
-    long d = getDistance();
-    long d_OBST = 28;
-    if (d < d_OBST) {
-      setForwardSpeeds(AVOID_SPEED + 30, 0);
-    } else if (d > d_OBST) {
-      setForwardSpeeds(0, AVOID_SPEED + 30);
-    } else {
-      setForwardSpeeds(AVOID_SPEED + 30, AVOID_SPEED + 30);
-    }
-  }
-  stop();
-
-  valL = digitalRead(irPinL) == LOW ? 0 : 1;
-  valR = digitalRead(irPinR) == LOW ? 0 : 1;
-
-  if (valL == 1 && valR == 0) { //黑 白
-    // setForwardSpeeds(MIN_SPEED + TURN_STRONG + 20, 0);
-    // delay(350);
-    // stop();
-    // valL = digitalRead(irPinL) == LOW ? 0 : 1;
-    // valR = digitalRead(irPinR) == LOW ? 0 : 1;
-    // while ((valL == 0 && valR == 0) || (valL == 1 && valR == 1)) {
-    //   digitalWrite(debugLEDGreen,HIGH);
-    //   setForwardSpeeds(MIN_SPEED + TURN_STRONG + 40, 0);
-    //   valL = digitalRead(irPinL) == LOW ? 0 : 1;
-    //   valR = digitalRead(irPinR) == LOW ? 0 : 1;
-    // }
-
-
-
-    // setForwardSpeeds(135, 75);
-    // delay (750);
-    // stop();
+  motionStart(AVOID_SEQ, sizeof(AVOID_SEQ) / sizeof(AVOID_SEQ[0]), avoidDone);
+  motionReference(odomLineHeading());
+  budgetCancel(BUDGET_SEARCH);
+  budgetStart(BUDGET_BYPASS, millis());
+}
 
+// 跨 gap 逃生压到了线才算跨过
+void gapEscaped() {
+  if (robot.valL == 1 || robot.valR == 1) gapBridged();
+  else gapLost = true;
+}
 
-    while (valL == 1 && valR == 0) {
-      setForwardSpeeds(BASE_SPEED, BASE_SPEED);
-      valL = digitalRead(irPinL) == LOW ? 0 : 1;
-      valR = digitalRead(irPinR) == LOW ? 0 : 1;
-    }
-    delay(300);
-    stop();
+// 软件期限监视：代替阻塞循环的动作超过预算（budget.h）就放弃，换成该路径的逃生动作
+void budgetWatch(unsigned long nowMs) {
+  // 沿线方向走了预算时间还没压线：倒回离线的地方（倒车不沿直线修正，只保持航向）
+  if (motionSequence() == GAP_BRIDGE && budgetExpired(BUDGET_GAP, nowMs)) {
+    motionStart(GAP_ESCAPE, sizeof(GAP_ESCAPE) / sizeof(GAP_ESCAPE[0]), gapEscaped);
+    motionReference(odomLineHeading());
   }
-  else if (valL == 1 && valR == 0) { //白 黑
-    //   setForwardSpeeds(BASE_SPEED, BASE_SPEED);
-    //   delay(200);
-    //   stop();
-    //   goto label;
-    setForwardSpeeds(MIN_SPEED + TURN_STRONG + 20, 0);
-    delay(900);
+  // 绕障超时（没看到障碍侧面、绕不回线）：放弃剩下的步骤，按绕行侧回到巡线找线
+  if (robot.mode == AVOID && budgetExpired(BUDGET_BYPASS, nowMs)) {
+    motionCancel();
     stop();
-    valL = digitalRead(irPinL) == LOW ? 0 : 1;
-    valR = digitalRead(irPinR) == LOW ? 0 : 1;
-    while ((valL == 0 && valR == 0) || (valL == 1 && valR == 1)) {
-      digitalWrite(debugLEDGreen,HIGH);
-      setForwardSpeeds(MIN_SPEED + TURN_STRONG + 20, 0);
-      valL = digitalRead(irPinL) == LOW ? 0 : 1;
-      valR = digitalRead(irPinR) == LOW ? 0 : 1;
-    }
-  }
-  else {
-    valL = digitalRead(irPinL) == LOW ? 0 : 1;
-    valR = digitalRead(irPinR) == LOW ? 0 : 1;
-    while ((valL == 0 && valR == 0) || (valL == 1 && valR == 1)) {
-      digitalWrite(debugLEDGreen,HIGH);
-      setForwardSpeeds(MIN_SPEED + TURN_STRONG + 20, 0);
-      valL = digitalRead(irPinL) == LOW ? 0 : 1;
-      valR = digitalRead(irPinR) == LOW ? 0 : 1;
-    }
-  }
-
-  // if (valL == 1 && valR == 0) { // 1 0
-  //   setForwardSpeeds(MIN_SPEED + TURN_STRONG + 20, 0);
-  //   delay(200);
-  //   stop();
-  //   valL = digitalRead(irPinL) == LOW ? 0 : 1;
-  //   valR = digitalRead(irPinR) == LOW ? 0 : 1;
-  //   while ((valL == 0 && valR == 0) || (valL == 1 && valR == 1)) {
-  //     digitalWrite(debugLEDGreen,HIGH);
-  //     // analogWrite(LEFT_PWM, constrain(MIN_SPEED + TURN_STRONG, 0, 255));
-  //     // analogWrite(RIGHT_PWM, constrain(MIN_SPEED + TURN_STRONG, 0, 255));
-  //     // digitalWrite(LEFT_DIR, HIGH);
-  //     // digitalWrite(RIGHT_DIR, LOW);
-  //     setForwardSpeeds(MIN_SPEED + TURN_STRONG + 40, 0);
-  //     valL = digitalRead(irPinL) == LOW ? 0 : 1;
-  //     valR = digitalRead(irPinR) == LOW ? 0 : 1;
-  //   }
-  // } else if (valL == 0 && valR == 1) {  // 0 1
-  //   setForwardSpeeds(MIN_SPEED + TURN_STRONG + 20, 0);
-  //   delay(200);
-  //   stop();
-  //   valL = digitalRead(irPinL) == LOW ? 0 : 1;
-  //   valR = digitalRead(irPinR) == LOW ? 0 : 1;
-  //   while ((valL == 0 && valR == 0) || (valL == 1 && valR == 1)) {
-  //     digitalWrite(debugLEDGreen,HIGH);
-  //     // analogWrite(LEFT_PWM, constrain(MIN_SPEED + TURN_STRONG, 0, 255));
-  //     // analogWrite(RIGHT_PWM, constrain(MIN_SPEED + TURN_STRONG, 0, 255));
-  //     // digitalWrite(LEFT_DIR, HIGH);
-  //     // digitalWrite(RIGHT_DIR, LOW);
-  //     setForwardSpeeds(MIN_SPEED + TURN_STRONG + 40, 0);
-  //     valL = digitalRead(irPinL) == LOW ? 0 : 1;
-  //     valR = digitalRead(irPinR) == LOW ? 0 : 1;
-  //   }
-  // } else if (valL == 1 && valR == 1) {  // 1 1
-  //   valL = digitalRead(irPinL) == LOW ? 0 : 1;
-  //   valR = digitalRead(irPinR) == LOW ? 0 : 1;
-  //   while ((valL == 0 && valR == 0) || (valL == 1 && valR == 1)) {
-  //     digitalWrite(debugLEDGreen,HIGH);
-  //     setForwardSpeeds(MIN_SPEED + TURN_STRONG + 40, 0);
-  //     valL = digitalRead(irPinL) == LOW ? 0 : 1;
-  //     valR = digitalRead(irPinR) == LOW ? 0 : 1;
-  //   }
-  // } else {  // 0 0
-  //   valL = digitalRead(irPinL) == LOW ? 0 : 1;
-  //   valR = digitalRead(irPinR) == LOW ? 0 : 1;
-  //   while ((valL == 0 && valR == 0) || (valL == 1 && valR == 1)) {
-  //     digitalWrite(debugLEDGreen,HIGH);
-  //     setForwardSpeeds(MIN_SPEED + TURN_STRONG + 40, 0);
-  //     valL = digitalRead(irPinL) == LOW ? 0 : 1;
-  //     valR = digitalRead(irPinR) == LOW ? 0 : 1;
-  //   }
-  // }
-
-  
-  delay(150);
-  stop();
-  digitalWrite(debugLEDGreen, LOW);
-  delay(STEP_PAUSE_MS);
-
-  // if (valL == 0 || valR == 0) {
-  //   //第二次避障有可能转不过来，需要调整
-  //   if (obstaclesSeen == 1) {
-  //     // setForwardSpeeds(MIN_SPEED + TURN_STRONG, 0);
-  //     // delay(550);
-  //     // analogWrite(LEFT_PWM, constrain(MIN_SPEED + TURN_STRONG, 0, 255));
-  //     // analogWrite(RIGHT_PWM, constrain(MIN_SPEED + TURN_STRONG, 0, 255));
-  //     // digitalWrite(LEFT_DIR, HIGH);
-  //     // digitalWrite(RIGHT_DIR, LOW);
-
-  //     setForwardSpeeds(MIN_SPEED + TURN_STRONG, 0);
-
-  //     digitalWrite(debugLEDGreen,HIGH);
-
-  //     delay(550);
-
-  //     digitalWrite(debugLEDGreen, LOW);
-  //   }
-  //   else {
-  //     // setForwardSpeeds(AVOID_SPEED, AVOID_SPEED);
-  //     // delay(50);
-  //     setForwardSpeeds(MIN_SPEED + TURN_STRONG, 0);
-  //     delay(350);
-  //   }
-  //   stop();
-  //   delay(STEP_PAUSE_MS);
-  // }
-  
-  myServo.write(SERVO_CENTER);
-  delay(STEP_PAUSE_MS);
-
-  obstaclesSeen++;
-
-  // 第二个障碍结束，延迟 5 秒后才允许开启跨 gap 直行模式
-  if (obstaclesSeen == 2) {
-    bridgeGaps = false;
-    bridgeGapsEnableAt = millis() + 2500;
-    gapsBridged = 0;
+    avoidDone();
   }
 }
 
+#ifdef ODOM_CALIBRATE
+// 航位推算标定（见 README、tools/odom_fit.py）：车放在一段直线上、车头沿线，正前方 1.5 m 左右立一面墙
+// （tracks/odom_cal.trk）。先单轮原地正转、反转各一次，巡线头过线的周期给出各轮增益 / 轮距；
+// 再前进几段、后退一段，超声测距给出增益、起转 PWM 和惯性。不巡线，遥测照常发出，抓下来交给 odom_fit.py
+const int CAL_PIVOT = 150;
+const unsigned long CAL_PIVOT_MS = 6500;
+const unsigned long CAL_REST_MS = 1000;
+
+const MotionStep ODOM_CAL_SEQ[] PROGMEM = {
+  {ACT_DRIVE, COND_NONE, 0, 0, SERVO_CENTER, CAL_REST_MS, 0},
+  {ACT_DRIVE, COND_NONE, 0, CAL_PIVOT, SERVO_KEEP, CAL_PIVOT_MS, 0},
+  {ACT_DRIVE, COND_NONE, 0, 0, SERVO_KEEP, CAL_REST_MS, 0},
+  {ACT_DRIVE, COND_NONE, 0, -CAL_PIVOT, SERVO_KEEP, CAL_PIVOT_MS, 0},
+  {ACT_DRIVE, COND_NONE, 0, 0, SERVO_KEEP, CAL_REST_MS, 0},
+  {ACT_DRIVE, COND_NONE, CAL_PIVOT, 0, SERVO_KEEP, CAL_PIVOT_MS, 0},
+  {ACT_DRIVE, COND_NONE, 0, 0, SERVO_KEEP, CAL_REST_MS, 0},
+  {ACT_DRIVE, COND_NONE, -CAL_PIVOT, 0, SERVO_KEEP, CAL_PIVOT_MS, 0},
+  {ACT_DRIVE, COND_NONE, 0, 0, SERVO_KEEP, CAL_REST_MS, 0},
+  // 直行：三档速度往墙走，一共约 80 cm，再退回来
+  {ACT_DRIVE, COND_NONE, 100, 100, SERVO_KEEP, 1200, 0},
+  {ACT_DRIVE, COND_NONE, 0, 0, SERVO_KEEP, CAL_REST_MS, 0},
+  {ACT_DRIVE, COND_NONE, 160, 160, SERVO_KEEP, 700, 0},
+  {ACT_DRIVE, COND_NONE, 0, 0, SERVO_KEEP, CAL_REST_MS, 0},
+  {ACT_DRIVE, COND_NONE, 220, 220, SERVO_KEEP, 500, 0},
+  {ACT_DRIVE, COND_NONE, 0, 0, SERVO_KEEP, CAL_REST_MS, 0},
+  {ACT_DRIVE, COND_NONE, -140, -140, SERVO_KEEP, 2000, 0},
+  {ACT_DRIVE, COND_NONE, 0, 0, SERVO_KEEP, 0, 0},
+};
+#endif
+
 void setup() {
-  pinMode(LEFT_DIR, OUTPUT);
-  pinMode(RIGHT_DIR, OUTPUT);
+  budgetBegin(); // 最先开看门狗，上一次是看门狗复位时接着记本轮
+  motorBegin();
 
   pinMode(irPinL, INPUT);
   pinMode(irPinR, INPUT);
+#ifdef LINE_ANALOG
+  lineAdcBegin(irPinL, irPinR);
+#else
+  lineEdgeBegin(irPinL, irPinR);
+#endif
 
-  pinMode(trigPin, OUTPUT);
-  pinMode(echoPin, INPUT);
+  rangingBegin(trigPin, echoPin);
+  rangeFilterReset();
 
   myServo.attach(servoPin);
-  myServo.write(SERVO_CENTER); // 舵机回正
+  scannerBegin(millis()); // 舵机回正，之后只由扫描器转动
 
   pinMode(debugLEDGreen, OUTPUT);
   pinMode(debugLEDYellow, OUTPUT);
   pinMode(debugLEDRed, OUTPUT);
 
-  Serial.begin(9600);
+  odomReset();
+  courseBegin(COURSE, COURSE_LEN, COURSE_START, millis());
+  governorReset(courseSegment().speed, millis());
+  lapBegin(millis());
+  patternBegin(TRACK_PATTERNS, sizeof(TRACK_PATTERNS) / sizeof(TRACK_PATTERNS[0]), 0);
+#ifdef ODOM_CALIBRATE
+  motionStart(ODOM_CAL_SEQ, sizeof(ODOM_CAL_SEQ) / sizeof(ODOM_CAL_SEQ[0]));
+#endif
+
+  telemetryBegin();
+  traceSent = false;
+  gapLost = false;
+  TRACE_BEGIN();
+  controlBegin(sampleLine); // 最后再开节拍中断，之前的初始化不会被打断
+}
+
+void sendTelemetry() {
+  TelemetrySample s;
+  s.tMs = (uint16_t)millis();
+  s.valL = robot.valL;
+  s.valR = robot.valR;
+  s.mode = robot.mode;
+  s.lastDir = robot.lastDir;
+  s.pwmL = pwmCmdL;
+  s.pwmR = pwmCmdR;
+  s.gapsSeen = patternCount(CNT_GAPS);
+  s.obstaclesSeen = robot.obstaclesSeen;
+  s.gapsBridged = robot.gapsBridged;
+  s.distanceCm = rangingDistance();
+  telemetrySend(s);
+}
+
+// 串口命令：'t' 发出轨迹记录，'b' 打印延迟预算，'l' 重新学习一圈，其余交给耗时统计（'p' 打印、'r' 清零）
+void pollSerial() {
+  while (Serial.available() > 0) {
+    int c = Serial.read();
+    if (c == 't') TRACE_FLUSH();
+    else if (c == 'b') budgetDump();
+    else if (c == 'l') lapRelearn(millis());
+    else PERF_COMMAND(c);
+  }
 }
 
+void controlStep();
+
 void loop() {
-  if (finished) {
+  PERF_LOOP_MARK();
+  budgetFeed();
+  pollSerial(); // 打印统计要等串口发完，不计入后台预算
+
+  // 后台工作每轮都做：测距、扫描器、遥测、EEPROM 写入，动作执行期间也不例外
+  budgetEnter(BUDGET_BACKGROUND);
+  unsigned long bgStart = micros();
+  rangingUpdate();
+  if (rangingSeq() != lastRangeSeq) {
+    lastRangeSeq = rangingSeq();
+    TRACE_RANGE(rangingDistance());
+  }
+  scannerUpdate();
+  // 轨迹记录按行写进串口发送缓冲，发送期间不发遥测帧，免得插进文本里
+  TRACE_SERVICE();
+  if (!TRACE_FLUSHING() && !backgroundLate && telemetryDue()) sendTelemetry();
+  lapService();
+  budgetService(millis());
+  backgroundLate = budgetRecord(BUDGET_BACKGROUND, micros() - bgStart);
+
+  // 控制步每个控制节拍只跑一次，跑完由电机输出级按斜率写出本节拍的 PWM
+  if (!controlDue()) return;
+  PERF_SCOPE(PERF_CONTROL);
+  budgetEnter(BUDGET_CONTROL);
+  unsigned long ctlStart = micros();
+  controlStep();
+  TRACE_MOTOR(pwmCmdL, pwmCmdR);
+  motorUpdate();
+  odomUpdate(motorOutputL(), motorOutputR());
+  budgetRecord(BUDGET_CONTROL, micros() - ctlStart);
+}
+
+void controlStep() {
+  readLine();
+  TRACE_LINE(lineSnapshot(robot.valL, robot.valR));
+#ifdef ODOM_CALIBRATE
+  motionTick(); // 标定动作做完就停在原地，只发遥测
+  return;
+#endif
+
+  // 赛程决定本轮的巡线速度、是否跨 gap、是否检测终点黑块
+  unsigned long nowMs = millis();
+  courseTick(nowMs);
+  const CourseSegment &seg = courseSegment();
+  // 比赛模式下已知 gap 快到了就提前进入跨 gap 直行，不等段内延时
+  robot.bridgeGaps = courseBridging(nowMs) || (seg.kind == SEG_BRIDGE_GAPS && lapExpect(1 << LAP_GAP, nowMs));
+  if (robot.valL == 1 || robot.valR == 1) gapLost = false;
+  if (gapLost) robot.bridgeGaps = false;
+
+  // gap 只在跨 gap 阶段计，V 弯和终点黑块只在各自的赛程段计
+  patternEnable(RULE_GAP, robot.bridgeGaps);
+  patternEnable(RULE_PAD, seg.kind == SEG_STOP_ON_PAD);
+  patternEnable(RULE_VTURN, seg.kind == SEG_FOLLOW_UNTIL_VTURN);
+  patternEvents = patternUpdate(lineSnapshot(robot.valL, robot.valR), nowMs);
+
+  if (patternEvents & (1 << RULE_GAP)) lapEvent(LAP_GAP, nowMs);
+  if (patternEvents & (1 << RULE_VTURN)) {
+    robot.lastDir = -1; // 冲出 V 弯顶点：线折向左边，不管离线前压的是哪一侧，都向左找
+    courseEvent(CEV_VTURN, nowMs);
+  }
+  if (patternEvents & (1 << RULE_PAD)) {
+    lapEvent(LAP_PAD, nowMs);
+    courseEvent(CEV_PAD, nowMs);
+    if (courseDone()) robot.finished = true; // 赛程最后一段是黑块停车
+  }
+
+  if (robot.finished) {
     digitalWrite(debugLEDGreen, LOW);
     digitalWrite(debugLEDYellow, LOW);
 
+    motionCancel();
     stop();
+    if (!traceSent) {
+      traceSent = true;
+      TRACE_FLUSH();
+    }
     return;
   }
 
-  if (mode == NORMAL) {
+  budgetWatch(nowMs);
+
+  // 动作进行中只推进一步，本轮不再做巡线判断；动作在本轮结束时赛程可能已前进，下一轮再按新段处理
+  if (motionBusy()) {
+    PERF_SCOPE(robot.mode == AVOID ? PERF_AVOID : PERF_MOTION);
+    motionTick();
+    return;
+  }
+
+  if (robot.mode == NORMAL) {
     digitalWrite(debugLEDGreen, HIGH);
     digitalWrite(debugLEDYellow, LOW);
 
-    unsigned long nowMs = millis();
-    if (!bridgeGaps && bridgeGapsEnableAt != 0 && obstaclesSeen >= 2 && nowMs >= bridgeGapsEnableAt) {
-      bridgeGaps = true;
-      bridgeGapsEnableAt = 0;
-      gapsBridged = 0;
+    if (seg.kind == SEG_BYPASS_LEFT) {
+      robot.mode = AVOID;
+      digitalWrite(debugLEDGreen, LOW);
+      digitalWrite(debugLEDYellow, HIGH);
+      avoidObstacle();
+      return;
     }
 
-    if (bridgeGaps) Gaps();
-
+    if (robot.bridgeGaps) Gaps();
+    if (motionBusy()) return;
+
+    // 比赛模式下已知障碍快到了就先降回段速度；弯前限速仿真里只会变慢（没有打滑模型），
+    // 实车如果入弯冲出线再用 -DLAP_CURVE_SPEED=160 之类打开
+#ifdef LAP_CURVE_SPEED
+    if (lapExpect((1 << LAP_CURVE_L) | (1 << LAP_CURVE_R), nowMs)) governorBrake(nowMs, LAP_CURVE_SPEED);
+#endif
+    if (lapExpect(1 << LAP_OBSTACLE, nowMs)) governorBrake(nowMs);
+    cruiseSpeed = governorUpdate(robot.valL, robot.valR, robot.lastDir, nowMs, seg.speed);
+    if (int8_t curve = governorCurveStart()) lapEvent(curve < 0 ? LAP_CURVE_L : LAP_CURVE_R, nowMs);
+    odomTrackLine(robot.valL, robot.valR);
     lineFollow();
 
-    unsigned long now = millis();
-    if (now - lastPingMs >= PING_INTERVAL) {
-      lastPingMs = now;
-
-      // 避障冷却期内不触发新的避障
-      if (now >= avoidCooldownUntil) {
-        myServo.write(SERVO_CENTER);
-        long front = getDistance();
-        if (front < OBST) {
-          mode = AVOID;
-        }
+    // 测距在后台持续进行，正前方的新样本进跟踪滤波（中值、变化率门限、置信度），单个假回波不触发
+    bool watching = seg.kind == SEG_FOLLOW_UNTIL_OBSTACLE && nowMs >= avoidCooldownUntil;
+    if (scannerSeq() != lastScanSeq) {
+      lastScanSeq = scannerSeq();
+      const ScanSample &front = scannerLatest();
+      if (front.angle == 0) {
+        rangeFilterPush(front.cm, front.ms, motorSpeedCmS());
+        if (watching && rangeFilterTrack().cm < OBST_SLOW) governorBrake(nowMs); // 障碍在前，先降回段速度
       }
     }
-  }
 
-  if (mode == AVOID) {
-    digitalWrite(debugLEDGreen, LOW);
-    digitalWrite(debugLEDYellow, HIGH);
-    avoidObstacle();
-    avoidCooldownUntil = millis() + AVOID_COOLDOWN_MS;
-    mode = NORMAL;
+    // 只有赛程当前段在等障碍时才测；避障冷却期内不触发新的避障。
+    // 确认的障碍按车速外推到现在，再过 OBST_STOP_MS 就进 OBST_STANDOFF 时触发：车快提前、车慢靠近再绕
+    if (watching && scannerAim() == 0 && rangeFilterTimeTo(OBST_STANDOFF, nowMs, motorSpeedCmS()) <= OBST_STOP_MS) {
+      motionCancel();
+      courseEvent(CEV_OBSTACLE, nowMs); // 进入 SEG_BYPASS_LEFT，下一轮开始绕障
+      lapEvent(LAP_OBSTACLE, nowMs);
+      // 学过的障碍直接用记下的绕行侧和距离，不扫描，舵机直接转到贴墙角度
+      uint8_t plan;
+      if (lapBypassPlan(plan)) bypassPreset(plan & 0x80, plan & 0x7F);
+    }
   }
-}
\ No newline at end of file
+}
@@ -0,0 +1,202 @@
+#include "hal.h"
+
+#include "bypass.h"
+#include "motion.h"
+#include "odometry.h"
+#include "robot.h"
+#include "scanner.h"
+
+namespace {
+
+const MotionStep *seq = nullptr;
+uint8_t seqLen = 0;
+uint8_t idx = 0;
+bool entered = false;
+bool mirrored = false;   // ACT_SCAN 决定：障碍在右侧时后续步骤左右互换
+unsigned long stepStart = 0;
+MotionDone onDone = nullptr;
+
+uint32_t reference = 0;  // ACT_TURN/ACT_GO 的基准航向
+bool tracking = false;   // 给了基准直线
+int32_t trackX = 0, trackY = 0;
+uint32_t stepTravel = 0; // 进入本步骤时的路程
+int8_t turnSign = 0;     // ACT_TURN 的转向，1 左转
+
+// 偏离直线 1 cm（Q16 的 1）对应的修正角：2^32 / 2π / 前视距离 / 2^16
+const int32_t TRACK_PER_Q16 = (int32_t)(4294967296.0 / 6.283185307 / 65536.0 / MOTION_TRACK_LOOKAHEAD_CM + 0.5);
+const int32_t TRACK_MAX_Q16 = (int32_t)MOTION_TRACK_MAX_CM * ODOM_ONE_CM;
+
+uint8_t mirrorCond(uint8_t cond) {
+  if (!mirrored) return cond;
+  switch (cond) {
+    case COND_NOT_LEFT_ONLY:  return COND_NOT_RIGHT_ONLY;
+    case COND_NOT_RIGHT_ONLY: return COND_NOT_LEFT_ONLY;
+    case COND_LAST_NOT_LEFT:  return COND_LAST_NOT_RIGHT;
+    case COND_LAST_NOT_RIGHT: return COND_LAST_NOT_LEFT;
+    default:                  return cond;
+  }
+}
+
+bool condMet(uint8_t cond) {
+  uint8_t valL = robot.valL, valR = robot.valR;
+  int8_t lastDir = robot.lastDir;
+  switch (mirrorCond(cond)) {
+    case COND_ALWAYS:         return true;
+    case COND_ANY_BLACK:      return valL == 1 || valR == 1;
+    case COND_ONE_SIDE:       return valL != valR;
+    case COND_NOT_LEFT_ONLY:  return !(valL == 1 && valR == 0);
+    case COND_NOT_RIGHT_ONLY: return !(valL == 0 && valR == 1);
+    case COND_BOTH_WHITE:     return valL == 0 && valR == 0;
+    case COND_NOT_BOTH_WHITE: return !(valL == 0 && valR == 0);
+    case COND_LAST_NOT_LEFT:  return lastDir != -1;
+    case COND_LAST_NOT_RIGHT: return lastDir != 1;
+    case COND_WALL_SEEN:      return bypassWallSeen();
+    default:                  return false;
+  }
+}
+
+void drive(int left, int right) {
+  if (mirrored) setWheelSpeeds(right, left);
+  else setWheelSpeeds(left, right);
+}
+
+void wallFollow(const MotionStep &st) {
+  // 以障碍在左为准：离得远往左（左轮慢），离得近往右
+  int steer = bypassSteer(getDistance());
+  drive(st.left - steer, st.left + steer);
+}
+
+// 本步骤的目标航向
+uint32_t stepHeading(const MotionStep &st) {
+  int32_t offset = odomDeg(st.right);
+  uint32_t target = reference + (mirrored ? -offset : offset);
+  if (st.act == ACT_GO && tracking) {
+    int32_t cross = odomCrossTrack(trackX, trackY, reference);
+    cross = constrain(cross, -TRACK_MAX_Q16, TRACK_MAX_Q16);
+    target -= cross * TRACK_PER_Q16; // 偏左往右拐
+  }
+  return target;
+}
+
+// 到目标还差多少（左转为正），扣掉断电后按惯性还会转的
+int32_t turnLeft(const MotionStep &st) {
+  return odomTurnTo(stepHeading(st)) - odomCoastTurn();
+}
+
+void goStep(const MotionStep &st) {
+  // 二进制角换成度：>> 16 后一圈 65536，再 × 360 >> 16
+  int32_t steer = ((turnLeft(st) >> 16) * MOTION_HOLD_KP * 360) >> 16;
+  steer = constrain(steer, -MOTION_HOLD_STEER_MAX, MOTION_HOLD_STEER_MAX);
+  // 航向是绝对的，不再经过 drive() 的镜像
+  setWheelSpeeds(st.left - steer, st.left + steer);
+}
+
+bool reached(const MotionStep &st) {
+  if (st.act == ACT_TURN) {
+    int32_t rest = turnLeft(st);
+    return turnSign > 0 ? rest <= 0 : rest >= 0;
+  }
+  if (st.arg == 0) return false;
+  int32_t coast = odomCoastCm();
+  uint32_t moved = odomTravel() - stepTravel + (uint32_t)(coast < 0 ? -coast : coast);
+  return moved >= (uint32_t)st.arg * ODOM_ONE_CM;
+}
+
+void finish() {
+  MotionDone done = onDone;
+  seq = nullptr;
+  onDone = nullptr;
+  if (done) done();
+}
+
+} // namespace
+
+void motionStart(const MotionStep *steps, uint8_t count, MotionDone done) {
+  seq = steps;
+  seqLen = count;
+  idx = 0;
+  entered = false;
+  mirrored = false;
+  onDone = done;
+  reference = odomHeading();
+  tracking = false;
+}
+
+bool motionTick() {
+  // 零时长步骤和跳转在同一轮内连续处理，最多走完整个序列
+  for (uint8_t guard = 0; seq && guard <= seqLen; guard++) {
+    if (idx >= seqLen) {
+      finish();
+      break;
+    }
+
+    MotionStep st; // 步骤表在 PROGMEM，取当前这一步到栈上
+    memcpy_P(&st, &seq[idx], sizeof(st));
+    unsigned long now = millis();
+
+    if (st.act == ACT_SKIP) {
+      idx += condMet(st.cond) ? 1 + st.arg : 1;
+      continue;
+    }
+
+    if (!entered) {
+      entered = true;
+      stepStart = now;
+      stepTravel = odomTravel();
+      if (st.servo != SERVO_KEEP) scannerPoint(mirrored ? 90 - st.servo : st.servo - 90, now);
+      if (st.act == ACT_SCAN) bypassScanBegin(st.arg != 0, now);
+      // 相当于 while (!cond) 的循环：条件一开始就成立则不动作
+      if (st.cond != COND_NONE && condMet(st.cond)) {
+        entered = false;
+        idx++;
+        continue;
+      }
+      if (st.act == ACT_DRIVE) drive(st.left, st.right);
+      else if (st.act == ACT_BRAKE) stop();
+      else if (st.act == ACT_TURN) {
+        turnSign = odomTurnTo(stepHeading(st)) >= 0 ? 1 : -1;
+        setWheelSpeeds(-turnSign * st.left, turnSign * st.left);
+      }
+    }
+
+    bool done;
+    if (st.act == ACT_SCAN) {
+      done = bypassScanTick();
+      if (done) mirrored = bypassPlan().mirror;
+    } else if (st.act == ACT_TURN || st.act == ACT_GO) {
+      done = reached(st) || (st.cond != COND_NONE && condMet(st.cond)) || (st.ms != 0 && now - stepStart >= st.ms);
+    } else if (st.cond == COND_NONE) done = now - stepStart >= st.ms;
+    else done = condMet(st.cond) || (st.ms != 0 && now - stepStart >= st.ms);
+    if (!done) {
+      if (st.act == ACT_WALL_FOLLOW) wallFollow(st);
+      else if (st.act == ACT_GO) goStep(st);
+      break;
+    }
+
+    entered = false;
+    idx++;
+  }
+  return seq != nullptr;
+}
+
+bool motionBusy() { return seq != nullptr; }
+
+const MotionStep *motionSequence() { return seq; }
+
+void motionCancel() {
+  seq = nullptr;
+  onDone = nullptr;
+  entered = false;
+}
+
+void motionReference(uint32_t heading) {
+  reference = heading;
+  tracking = false;
+}
+
+void motionTrack(int32_t x, int32_t y, uint32_t heading) {
+  reference = heading;
+  tracking = true;
+  trackX = x;
+  trackY = y;
+}
@@ -0,0 +1,139 @@
+#include "hal.h"
+
+#include "control.h"
+#include "fastio.h"
+#include "motor.h"
+
+namespace {
+
+typedef FastPwm<MOTOR_L_PWM> LeftPwm;
+typedef FastPwm<MOTOR_R_PWM> RightPwm;
+typedef FastPin<MOTOR_L_DIR> LeftDir;
+typedef FastPin<MOTOR_R_DIR> RightDir;
+
+// 每个节拍的最大变化量，至少 1
+const int16_t SLEW_UP_STEP = MOTOR_SLEW_UP * CONTROL_PERIOD_US / 1000 > 0 ? MOTOR_SLEW_UP * CONTROL_PERIOD_US / 1000 : 1;
+const int16_t SLEW_DOWN_STEP = MOTOR_SLEW_DOWN * CONTROL_PERIOD_US / 1000 > 0 ? MOTOR_SLEW_DOWN * CONTROL_PERIOD_US / 1000 : 1;
+const uint32_t BRAKE_TICKS_FULL = (uint32_t)MOTOR_BRAKE_MS * 1000 / CONTROL_PERIOD_US;
+static_assert(BRAKE_TICKS_FULL < 255, "MOTOR_BRAKE_MS 太长");
+
+struct Wheel {
+  int16_t target;
+  int16_t level;        // 斜率限制后的输出（不含死区补偿）
+  int16_t out;          // 实际写出的输出
+  uint8_t brakeTicks;   // 剩余的反向脉冲节拍
+  int8_t brakeSign;
+  bool launching;       // 从静止起步，加速到目标之前按斜率走
+};
+
+Wheel wheels[2];
+
+int16_t slew(Wheel &w, bool atRest) {
+  int16_t level = w.level, target = w.target;
+  // 换向时先以减速斜率回到 0
+  if ((level > 0 && target < 0) || (level < 0 && target > 0)) target = 0;
+  // 死区以下电机不转，起步这一拍直接到死区边沿；整车从静止起步（另一侧也停着）时再按斜率加速到目标，
+  // 车在走、只是这一侧停过一下（丢线搜索）时轮子不容易打滑，下一拍就跟随
+  if (level == 0 && target != 0) {
+    w.launching = atRest;
+    return constrain(target, -MOTOR_DEADBAND, MOTOR_DEADBAND);
+  }
+  int16_t diff = target - level;
+  bool speedingUp = (level >= 0 && diff > 0) || (level <= 0 && diff < 0);
+  bool running = (level >= MOTOR_DEADBAND && target >= MOTOR_DEADBAND) || (level <= -MOTOR_DEADBAND && target <= -MOTOR_DEADBAND);
+  // 已经在转、同向的变化（巡线差速）直接跟随，不给转向加滞后；起步加速中除外
+  if (!speedingUp || !running) w.launching = false;
+  if (running && !w.launching) return target;
+  int16_t step = speedingUp ? SLEW_UP_STEP : SLEW_DOWN_STEP;
+  if (diff > step) return level + step;
+  if (diff < -step) return level - step;
+  w.launching = false;
+  return target;
+}
+
+int16_t update(Wheel &w, bool atRest) {
+  if (w.brakeTicks) {
+    w.brakeTicks--;
+    return w.out = w.brakeTicks ? -w.brakeSign * MOTOR_BRAKE_PWM : 0;
+  }
+  w.level = slew(w, atRest);
+  int16_t mag = abs(w.level);
+  // 死区：目标不为 0 时抬到能转的最小值；正在减到 0 时直接断开
+  if (mag > 0 && mag < MOTOR_DEADBAND) mag = w.target != 0 ? MOTOR_DEADBAND : 0;
+  return w.out = w.level < 0 ? -mag : mag;
+}
+
+void brake(Wheel &w) {
+  w.target = 0;
+  if (w.brakeTicks || w.out == 0) return;
+  uint8_t ticks = (uint8_t)(BRAKE_TICKS_FULL * abs(w.out) / 255);
+  w.level = 0;
+  if (ticks == 0) return;
+  w.brakeSign = w.out > 0 ? 1 : -1;
+  w.brakeTicks = ticks + 1; // 最后一拍归零
+}
+
+void configureTimer0() {
+#if defined(ARDUINO) && MOTOR_PWM_HZ != 976
+  // init() 已设好 fast PWM /64；改分频后溢出中断也关掉，millis 改由 Timer2 提供
+  TIMSK0 &= (uint8_t)~_BV(TOIE0);
+#if MOTOR_PWM_HZ == 31250
+  TCCR0A = (TCCR0A & (uint8_t)~_BV(WGM01)) | _BV(WGM00);
+  TCCR0B = (TCCR0B & 0xF8) | _BV(CS00);
+#elif MOTOR_PWM_HZ == 62500
+  TCCR0B = (TCCR0B & 0xF8) | _BV(CS00);
+#else
+  TCCR0B = (TCCR0B & 0xF8) | _BV(CS01);
+#endif
+#endif
+}
+
+} // namespace
+
+void motorBegin() {
+  wheels[0] = Wheel();
+  wheels[1] = Wheel();
+  LeftPwm::write(0);
+  RightPwm::write(0);
+  FastPin<MOTOR_L_PWM>::output();
+  FastPin<MOTOR_R_PWM>::output();
+  LeftDir::output();
+  RightDir::output();
+  configureTimer0();
+}
+
+void motorSet(int16_t left, int16_t right) {
+  wheels[0].target = constrain(left, -255, 255);
+  wheels[1].target = constrain(right, -255, 255);
+  wheels[0].brakeTicks = 0;
+  wheels[1].brakeTicks = 0;
+}
+
+void motorBrake() {
+  brake(wheels[0]);
+  brake(wheels[1]);
+}
+
+void motorUpdate() {
+  bool atRest = wheels[0].level == 0 && wheels[1].level == 0;
+  int16_t l = update(wheels[0], atRest);
+  int16_t r = update(wheels[1], atRest);
+  LeftPwm::write((uint8_t)abs(l));
+  RightPwm::write((uint8_t)abs(r));
+  LeftDir::write(l >= 0);
+  RightDir::write(r >= 0);
+}
+
+int16_t motorOutputL() { return wheels[0].out; }
+
+int16_t motorOutputR() { return wheels[1].out; }
+
+int16_t motorSpeedCmS() {
+  int16_t speed = 0;
+  for (uint8_t i = 0; i < 2; i++) {
+    int16_t mag = abs(wheels[i].out) - MOTOR_STALL_PWM;
+    if (mag <= 0) continue;
+    speed += wheels[i].out < 0 ? -mag : mag;
+  }
+  return (int16_t)(((int32_t)speed * MOTOR_CMS_PER_PWM_Q8) >> 9); // 两轮平均，>>8 再 /2
+}
@@ -0,0 +1,161 @@
+#include "hal.h"
+
+#include "control.h"
+#include "odometry.h"
+
+namespace {
+
+// 四分之一周期 sin，Q14，65 个点（含 90 度）
+const int16_t QUARTER_SIN[65] PROGMEM = {
+  0, 402, 804, 1205, 1606, 2006, 2404, 2801, 3196, 3590, 3981, 4370, 4756, 5139, 5520, 5897,
+  6270, 6639, 7005, 7366, 7723, 8076, 8423, 8765, 9102, 9434, 9760, 10080, 10394, 10702, 11003, 11297,
+  11585, 11866, 12140, 12406, 12665, 12916, 13160, 13395, 13623, 13842, 14053, 14256, 14449, 14635, 14811, 14978,
+  15137, 15286, 15426, 15557, 15679, 15791, 15893, 15986, 16069, 16143, 16207, 16261, 16305, 16340, 16364, 16379,
+  16384,
+};
+
+// 一阶惯性每节拍靠近的比例，Q12：P / (tau + P/2)，与 1 - exp(-P/tau) 相差不到 0.01%
+const uint32_t TAU_US = (uint32_t)ODOM_TAU_MS * 1000;
+const int32_t ALPHA_Q12 = (int32_t)((4096UL * CONTROL_PERIOD_US + (TAU_US + CONTROL_PERIOD_US / 2) / 2) /
+                                    (TAU_US + CONTROL_PERIOD_US / 2));
+const int32_t TAU_TICKS = (int32_t)((TAU_US + CONTROL_PERIOD_US / 2) / CONTROL_PERIOD_US);
+// 轮速 Q12 cm/s 乘一个节拍的时长，换成 Q16 cm：v × 16 × P / 10^6，乘数再放大 2^16
+const int32_t STEP_Q16 = (int32_t)(CONTROL_PERIOD_US * 1.048576 + 0.5);
+// 两轮速度差每 1/256 cm/s 一个节拍转过的二进制角，Q4：2^32 / 2π × P / 10^6 / 轮距 / 256
+const int32_t TURN_Q4 = (int32_t)(4294967296.0 / 6.283185307 * CONTROL_PERIOD_US / 1e6 /
+                                  (ODOM_WHEELBASE_MM / 10.0) / 16.0 + 0.5);
+const int32_t SENSOR_Q16 = (int32_t)ODOM_SENSOR_MM * ODOM_ONE_CM / 10;
+const int32_t HALF_SPACING_Q8 = (int32_t)ODOM_SENSOR_SPACING_MM * 256 / 20; // 半个巡线头间距，cm Q8
+const int32_t CROSS_CLAMP = 250L * ODOM_ONE_CM; // 算横向偏差时的坐标差上限，免得乘法溢出
+
+static_assert(ALPHA_Q12 > 0 && ALPHA_Q12 < 4096, "ODOM_TAU_MS 与节拍不匹配");
+
+int32_t speedL = 0, speedR = 0;  // cm/s Q12
+int32_t targetL = 0, targetR = 0; // 当前输出对应的目标轮速
+int32_t x = 0, y = 0;
+uint32_t heading = 0;
+uint32_t travel = 0;
+int32_t stepQ16 = 0;     // 本节拍前进的路程，后退为负
+int32_t turnStep = 0;    // 本节拍转过的二进制角
+
+uint32_t lastTick = 0;   // 上一次推算到的控制节拍
+
+uint32_t lineHeading = 0;
+int32_t lineX = 0, lineY = 0;
+uint32_t lineTravel = 0; // 线方向已经滤到的路程
+
+int32_t wheelTarget(int16_t out, int32_t gainQ12) {
+  int16_t mag = out < 0 ? -out : out;
+  if (mag <= ODOM_STALL_PWM) return 0;
+  int32_t v = (int32_t)(mag - ODOM_STALL_PWM) * gainQ12;
+  return out < 0 ? -v : v;
+}
+
+// 带舍入的算术右移（负数也对称）
+int32_t shiftRound(int32_t v, uint8_t n) {
+  return v >= 0 ? (v + (1L << (n - 1))) >> n : -((-v + (1L << (n - 1))) >> n);
+}
+
+// 巡线头在车头方向上的偏移，cm Q16
+int32_t aheadX() { return (SENSOR_Q16 >> 8) * odomCos(heading) / 64; }
+int32_t aheadY() { return (SENSOR_Q16 >> 8) * odomSin(heading) / 64; }
+
+// 一阶惯性往 target 靠一个节拍；差得很小时直接到位，停车后不会留下一点残余速度
+void lag(int32_t &v, int32_t target) {
+  int32_t step = shiftRound((target - v) * ALPHA_Q12, 12);
+  v = step ? v + step : target;
+}
+
+// 按当前轮速推进一个节拍
+void advance() {
+  // 先转一半再走，相当于按本节拍中间的朝向积分
+  turnStep = shiftRound(shiftRound(speedR - speedL, 4) * TURN_Q4, 4);
+  uint32_t mid = heading + (turnStep >> 1);
+  stepQ16 = shiftRound(((speedL + speedR) >> 1) * STEP_Q16, 16);
+  x += (stepQ16 * odomCos(mid)) >> 14;
+  y += (stepQ16 * odomSin(mid)) >> 14;
+  heading += turnStep;
+  travel += stepQ16 < 0 ? -stepQ16 : stepQ16;
+}
+
+int32_t clampCm(int32_t v) {
+  return v > CROSS_CLAMP ? CROSS_CLAMP : v < -CROSS_CLAMP ? -CROSS_CLAMP : v;
+}
+
+} // namespace
+
+int16_t odomSin(uint32_t angle) {
+  uint8_t quadrant = angle >> 30;
+  uint32_t a = angle & 0x3FFFFFFFUL;
+  if (quadrant & 1) a = 0x40000000UL - a; // 第二、四象限镜像
+  uint8_t i = a >> 24;                     // 0~64
+  uint8_t frac = a >> 16;
+  int16_t s0 = (int16_t)pgm_read_word(&QUARTER_SIN[i]);
+  int16_t s = s0;
+  if (i < 64) s += (int16_t)(((int32_t)((int16_t)pgm_read_word(&QUARTER_SIN[i + 1]) - s0) * frac + 128) >> 8);
+  return quadrant & 2 ? -s : s;
+}
+
+int16_t odomCos(uint32_t angle) { return odomSin(angle + 0x40000000UL); }
+
+void odomReset() {
+  speedL = speedR = 0;
+  targetL = targetR = 0;
+  x = y = 0;
+  heading = 0;
+  travel = 0;
+  stepQ16 = turnStep = 0;
+  lastTick = controlTicks();
+  lineHeading = 0;
+  lineX = lineY = 0;
+  lineTravel = 0;
+}
+
+void odomUpdate(int16_t outL, int16_t outR) {
+  // 上次写出的输出一直保持到现在：按经过的节拍数推进，控制步超时丢掉的节拍也补上（最多 ODOM_MAX_CATCHUP 拍）
+  uint32_t now = controlTicks();
+  uint32_t n = now - lastTick;
+  lastTick = now;
+  if (n > ODOM_MAX_CATCHUP) n = ODOM_MAX_CATCHUP;
+  while (n--) {
+    lag(speedL, targetL);
+    lag(speedR, targetR);
+    advance();
+  }
+  targetL = wheelTarget(outL, ODOM_GAIN_L_Q12);
+  targetR = wheelTarget(outR, ODOM_GAIN_R_Q12);
+}
+
+int32_t odomX() { return x; }
+int32_t odomY() { return y; }
+uint32_t odomHeading() { return heading; }
+uint32_t odomTravel() { return travel; }
+
+int16_t odomSpeedCmS() { return (int16_t)(((speedL + speedR) >> 1) >> 12); }
+
+int32_t odomCoastTurn() { return turnStep * TAU_TICKS; }
+int32_t odomCoastCm() { return stepQ16 * TAU_TICKS; }
+
+int32_t odomCrossTrack(int32_t x0, int32_t y0, uint32_t dir) {
+  // 巡线头所在的点相对直线的横向偏差：(p - p0) × 方向
+  int32_t dx = clampCm(x + aheadX() - x0) >> 8;
+  int32_t dy = clampCm(y + aheadY() - y0) >> 8;
+  return ((dy * odomCos(dir)) >> 6) - ((dx * odomSin(dir)) >> 6);
+}
+
+void odomTrackLine(uint8_t valL, uint8_t valR) {
+  if (!valL && !valR) return;
+  // 按走过的路程（1/4 cm 一份）靠近车头朝向，停车时不动，快慢车速下滤波的距离相同
+  uint32_t quarters = (travel - lineTravel) >> 14;
+  lineTravel += quarters << 14;
+  if (quarters > 255) quarters = 255; // 离线很久以后，滤够了就行
+  while (quarters--) lineHeading += (int32_t)(heading - lineHeading) >> ODOM_LINE_SHIFT;
+  // 压线点：巡线头中点，只有一侧压线时线在那一侧的巡线头下面
+  int32_t side = valL == valR ? 0 : valL ? HALF_SPACING_Q8 : -HALF_SPACING_Q8;
+  lineX = x + aheadX() - side * odomSin(heading) / 64;
+  lineY = y + aheadY() + side * odomCos(heading) / 64;
+}
+
+uint32_t odomLineHeading() { return lineHeading; }
+int32_t odomLineX() { return lineX; }
+int32_t odomLineY() { return lineY; }
@@ -0,0 +1,73 @@
+#include "hal.h"
+#include "patterns.h"
+
+namespace {
+
+const uint8_t ST_ACTIVE = 1 << 0; // 正处于匹配状态
+const uint8_t ST_FIRED = 1 << 1;  // 本段匹配已经触发过（PAT_HOLD 去抖）
+
+const PatternRule *table = nullptr;
+uint8_t ruleCount = 0;
+uint8_t enabled = 0;
+
+uint8_t flags[PATTERN_MAX_RULES];
+uint16_t since[PATTERN_MAX_RULES]; // 进入匹配状态的时刻（ms 低 16 位，保持时间不会超过 65s）
+uint8_t counters[PATTERN_MAX_COUNTERS];
+
+void fire(uint8_t i, uint8_t &events) {
+  events |= 1 << i;
+  uint8_t c = pgm_read_byte(&table[i].counter);
+  if (c < PATTERN_MAX_COUNTERS && counters[c] < 255) counters[c]++;
+}
+
+} // namespace
+
+void patternBegin(const PatternRule *rules, uint8_t count, uint8_t enableMask) {
+  table = rules;
+  ruleCount = count > PATTERN_MAX_RULES ? PATTERN_MAX_RULES : count;
+  enabled = enableMask;
+  for (uint8_t i = 0; i < PATTERN_MAX_RULES; i++) flags[i] = 0;
+  for (uint8_t i = 0; i < PATTERN_MAX_COUNTERS; i++) counters[i] = 0;
+}
+
+uint8_t patternUpdate(uint8_t snapshot, unsigned long nowMs) {
+  uint8_t events = 0;
+  uint16_t now16 = (uint16_t)nowMs;
+  uint8_t snapBit = 1 << (snapshot & 3);
+
+  for (uint8_t i = 0; i < ruleCount; i++) {
+    if (!(enabled & (1 << i))) continue;
+    PatternRule r;
+    memcpy_P(&r, &table[i], sizeof(r));
+    uint8_t &f = flags[i];
+    uint16_t held = now16 - since[i];
+
+    if (r.states & snapBit) {
+      if (!(f & ST_ACTIVE)) {
+        f = ST_ACTIVE;
+        since[i] = now16;
+      } else if (r.kind == PAT_HOLD && !(f & ST_FIRED) && held >= r.minMs) {
+        f |= ST_FIRED;
+        fire(i, events);
+      }
+    } else {
+      if ((f & ST_ACTIVE) && r.kind == PAT_PULSE && held >= r.minMs && held <= r.maxMs) fire(i, events);
+      f = 0;
+    }
+  }
+  return events;
+}
+
+void patternEnable(uint8_t rule, bool on) {
+  if (rule >= PATTERN_MAX_RULES) return;
+  if (on) {
+    enabled |= 1 << rule;
+  } else {
+    enabled &= ~(1 << rule);
+    flags[rule] = 0;
+  }
+}
+
+bool patternEnabled(uint8_t rule) { return rule < PATTERN_MAX_RULES && (enabled & (1 << rule)); }
+
+uint8_t patternCount(uint8_t counter) { return counter < PATTERN_MAX_COUNTERS ? counters[counter] : 0; }
@@ -0,0 +1,118 @@
+#include "control.h"
+#include "perf.h"
+
+#ifdef PERF_ENABLE
+
+namespace {
+
+struct PerfStat {
+  uint32_t count;
+  uint16_t minTicks;
+  uint16_t maxTicks;
+  uint32_t sumTicks;
+  uint16_t buckets[PERF_BUCKETS];
+};
+
+PerfStat stats[PERF_COUNT];
+uint16_t lastLoopTicks = 0;
+bool loopMarked = false;
+
+// 名字放 PROGMEM，同 budget.cpp
+const char NAMES[PERF_COUNT][12] PROGMEM = {"loop", "lineFollow", "Gaps", "getDistance", "avoid", "motion", "control"};
+
+void printName(uint8_t id) {
+  for (const char *c = NAMES[id]; pgm_read_byte(c); c++) Serial.print((char)pgm_read_byte(c));
+}
+
+uint8_t bucketOf(uint16_t ticks) {
+  uint8_t b = 0;
+  while (ticks && b < PERF_BUCKETS - 1) {
+    ticks >>= 1;
+    b++;
+  }
+  return b;
+}
+
+// 直方图上累计到 pct% 的桶的上界（us），不超过实测最大值
+uint32_t percentileUs(const PerfStat &s, uint8_t pct) {
+  uint32_t total = 0;
+  for (uint8_t i = 0; i < PERF_BUCKETS; i++) total += s.buckets[i];
+  uint32_t need = (total * pct + 99) / 100;
+  uint32_t acc = 0;
+  uint8_t i = 0;
+  for (; i < PERF_BUCKETS - 1; i++) {
+    acc += s.buckets[i];
+    if (acc >= need) break;
+  }
+  uint32_t bound = i == PERF_BUCKETS - 1 ? s.maxTicks : ((uint32_t)1 << i) - 1;
+  if (bound > s.maxTicks) bound = s.maxTicks;
+  return bound * PERF_TICK_US;
+}
+
+} // namespace
+
+void perfRecord(uint8_t id, uint16_t ticks) {
+  PerfStat &s = stats[id];
+  if (s.count == 0 || ticks < s.minTicks) s.minTicks = ticks;
+  if (ticks > s.maxTicks) s.maxTicks = ticks;
+  s.sumTicks += ticks;
+  s.count++;
+
+  // 某个桶将要溢出时整体减半，分布形状不变
+  uint8_t b = bucketOf(ticks);
+  if (s.buckets[b] == 0xFFFF) {
+    for (uint8_t i = 0; i < PERF_BUCKETS; i++) s.buckets[i] >>= 1;
+  }
+  s.buckets[b]++;
+}
+
+void perfLoopMark() {
+  uint16_t t = perfTicks();
+  if (loopMarked) perfRecord(PERF_LOOP, t - lastLoopTicks);
+  lastLoopTicks = t;
+  loopMarked = true;
+}
+
+void perfCommand(int c) {
+  if (c == 'p') perfDump();
+  else if (c == 'r') perfReset();
+}
+
+void perfDump() {
+  Serial.println(F("# perf: name count min_us avg_us p50_us p90_us p99_us max_us"));
+  for (uint8_t i = 0; i < PERF_COUNT; i++) {
+    const PerfStat &s = stats[i];
+    printName(i);
+    Serial.print(' ');
+    Serial.print((unsigned long)s.count);
+    if (s.count == 0) {
+      Serial.println();
+      continue;
+    }
+    Serial.print(' ');
+    Serial.print((unsigned long)s.minTicks * PERF_TICK_US);
+    Serial.print(' ');
+    Serial.print(s.sumTicks / s.count * PERF_TICK_US);
+    Serial.print(' ');
+    Serial.print(percentileUs(s, 50));
+    Serial.print(' ');
+    Serial.print(percentileUs(s, 90));
+    Serial.print(' ');
+    Serial.print(percentileUs(s, 99));
+    Serial.print(' ');
+    Serial.println((unsigned long)s.maxTicks * PERF_TICK_US);
+  }
+  Serial.print(F("# control: period_us ticks overruns "));
+  Serial.print((unsigned long)CONTROL_PERIOD_US);
+  Serial.print(' ');
+  Serial.print((unsigned long)controlTicks());
+  Serial.print(' ');
+  Serial.println((unsigned long)controlOverruns());
+}
+
+void perfReset() {
+  memset(stats, 0, sizeof(stats));
+  loopMarked = false;
+}
+
+#endif
@@ -0,0 +1,67 @@
+#include "hal.h"
+#include "pinchange.h"
+
+namespace {
+
+struct Slot {
+  uint8_t mask;
+  PinChangeHandler handler;
+};
+
+Slot slots[PCINT_MAX_HANDLERS];
+uint8_t slotCount = 0;
+uint8_t watched = 0;          // 所有登记的位
+volatile uint8_t lastPins = 0;
+
+#ifdef ARDUINO
+inline uint8_t readPins() { return PINC; }
+#else
+// 主机上没有端口寄存器，按登记的引脚逐个读出拼成 PINC 的样子
+uint8_t readPins() {
+  uint8_t pins = 0;
+  for (uint8_t b = 0; b < 6; b++) {
+    if ((watched & (1 << b)) && digitalRead(A0 + b) == HIGH) pins |= 1 << b;
+  }
+  return pins;
+}
+#endif
+
+void dispatch() {
+  uint8_t pins = readPins();
+  uint8_t changed = (pins ^ lastPins) & watched;
+  lastPins = pins;
+  if (!changed) return;
+  for (uint8_t i = 0; i < slotCount; i++) {
+    if (changed & slots[i].mask) slots[i].handler(pins, changed & slots[i].mask);
+  }
+}
+
+} // namespace
+
+#ifdef ARDUINO
+ISR(PCINT1_vect) { dispatch(); }
+#endif
+
+bool pinChangeAttach(uint8_t mask, PinChangeHandler handler) {
+  uint8_t i = 0;
+  while (i < slotCount && slots[i].handler != handler) i++;
+  if (i == PCINT_MAX_HANDLERS) return false;
+  HAL_ATOMIC {
+    slots[i].mask = mask;
+    slots[i].handler = handler;
+    if (i == slotCount) slotCount++;
+    watched = 0;
+    for (uint8_t j = 0; j < slotCount; j++) watched |= slots[j].mask;
+    lastPins = readPins();
+  }
+#ifdef ARDUINO
+  PCMSK1 |= mask;
+  PCIFR = _BV(PCIF1);
+  PCICR |= _BV(PCIE1);
+#else
+  for (uint8_t b = 0; b < 6; b++) {
+    if (mask & (1 << b)) attachPinChange(A0 + b, dispatch);
+  }
+#endif
+  return true;
+}
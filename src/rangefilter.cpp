@@ -0,0 +1,72 @@
+#include "hal.h"
+
+#include "rangefilter.h"
+#include "ranging.h"
+
+namespace {
+
+int16_t window[3];
+RangeTrack track;
+
+int16_t median3(int16_t a, int16_t b, int16_t c) {
+  if (a > b) { int16_t t = a; a = b; b = t; }
+  if (b > c) b = c;
+  return a > b ? a : b;
+}
+
+void restart(int16_t cm, unsigned long ms) {
+  track.lastCm = cm;
+  track.lastMs = ms;
+  track.confidence = 1;
+}
+
+} // namespace
+
+void rangeFilterReset() {
+  // 窗口先填成“很远”，开头一个孤立近值的中值也是远
+  window[0] = window[1] = window[2] = RANGE_FAR_CM;
+  track = RangeTrack();
+  track.cm = RANGE_FAR_CM;
+}
+
+void rangeFilterPush(int16_t cm, unsigned long ms, int16_t speedCmS) {
+  window[0] = window[1];
+  window[1] = window[2];
+  window[2] = cm;
+  track.cm = median3(window[0], window[1], window[2]);
+
+  if (track.confidence && ms - track.lastMs > RF_STALE_MS) track.confidence = 0;
+  if (cm >= RF_MAX_CM) {
+    // 丢一次回波只扣置信度，跟踪还在
+    if (track.confidence) track.confidence--;
+    return;
+  }
+  if (track.confidence == 0) {
+    restart(cm, ms);
+    return;
+  }
+
+  long travel = speedCmS > 0 ? (long)speedCmS * (long)(ms - track.lastMs) / 1000 : 0;
+  long miss = (long)cm - (track.lastCm - travel);
+  if (abs(miss) <= RF_GATE_CM + travel / 2) {
+    if (track.confidence < RF_CONF_MAX) track.confidence++;
+    track.lastCm = cm;
+    track.lastMs = ms;
+  } else if (--track.confidence == 0) {
+    restart(cm, ms); // 连续不一致，以新样本重新开始
+  }
+}
+
+const RangeTrack &rangeFilterTrack() { return track; }
+
+bool rangeFilterConfirmed() { return track.confidence >= RF_CONFIRM; }
+
+uint16_t rangeFilterTimeTo(int16_t cm, unsigned long nowMs, int16_t speedCmS) {
+  if (!rangeFilterConfirmed()) return 0xFFFF;
+  long speed = speedCmS > 0 ? speedCmS : 0;
+  long left = (long)track.lastCm - speed * (long)(nowMs - track.lastMs) / 1000 - cm;
+  if (left <= 0) return 0;
+  if (speed == 0) return 0xFFFF;
+  long ms = left * 1000 / speed;
+  return ms < 0xFFFF ? (uint16_t)ms : 0xFFFE;
+}
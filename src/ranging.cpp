@@ -0,0 +1,110 @@
+#include "hal.h"
+#include "pinchange.h"
+#include "ranging.h"
+
+namespace {
+
+enum EchoState : uint8_t { ECHO_IDLE, ECHO_WAIT_RISE, ECHO_WAIT_FALL, ECHO_DONE };
+
+uint8_t trigPinNo = 0;
+uint8_t echoMask = 0;
+
+volatile EchoState echoState = ECHO_IDLE;
+volatile unsigned long riseUs = 0;
+volatile unsigned long fallUs = 0;
+
+unsigned long trigUs = 0;
+unsigned long trigMs = 0;
+unsigned long holdUntilMs = 0;
+RangingHook onTrigger = nullptr;
+
+long lastCm = RANGE_FAR_CM;
+unsigned long lastStampMs = 0;
+uint8_t seq = 0;
+
+void publish(long cm, unsigned long ms) {
+  lastCm = cm;
+  lastStampMs = ms;
+  seq++;
+}
+
+void trigger() {
+  digitalWrite(trigPinNo, LOW);
+  delayMicroseconds(2);
+  digitalWrite(trigPinNo, HIGH);
+  delayMicroseconds(10);
+  digitalWrite(trigPinNo, LOW);
+
+  trigUs = micros();
+  trigMs = millis();
+  echoState = ECHO_WAIT_RISE;
+  if (onTrigger) onTrigger();
+}
+
+// 引脚变化中断里调用（见 pinchange.h）
+void echoEdge(uint8_t pins, uint8_t changed) {
+  (void)changed;
+  bool high = (pins & echoMask) != 0;
+  EchoState s = echoState;
+  if (high && s == ECHO_WAIT_RISE) {
+    riseUs = micros();
+    echoState = ECHO_WAIT_FALL;
+  } else if (!high && s == ECHO_WAIT_FALL) {
+    fallUs = micros();
+    echoState = ECHO_DONE;
+  }
+}
+
+} // namespace
+
+void rangingBegin(uint8_t trig, uint8_t echo) {
+  trigPinNo = trig;
+  echoMask = pinChangeBit(echo);
+
+  pinMode(trig, OUTPUT);
+  pinMode(echo, INPUT);
+  digitalWrite(trig, LOW);
+
+  pinChangeAttach(echoMask, echoEdge);
+}
+
+void rangingUpdate() {
+  EchoState s;
+  unsigned long rise, fall;
+  HAL_ATOMIC {
+    s = echoState;
+    rise = riseUs;
+    fall = fallUs;
+  }
+
+  unsigned long nowMs = millis();
+
+  if (s == ECHO_DONE) {
+    unsigned long duration = fall - rise;
+    if (duration > RANGE_TIMEOUT_US) publish(RANGE_FAR_CM, trigMs);
+    else publish((long)echoUsToCm(duration), trigMs);
+    echoState = ECHO_IDLE;
+    return;
+  }
+
+  if (s != ECHO_IDLE) {
+    // 回波迟迟不来或一直不落：按超时处理，状态机复位
+    if (micros() - trigUs > RANGE_TIMEOUT_US + 2000) {
+      echoState = ECHO_IDLE;
+      publish(RANGE_FAR_CM, trigMs);
+    }
+    return;
+  }
+
+  if (nowMs - trigMs >= RANGE_INTERVAL_MS && (long)(nowMs - holdUntilMs) >= 0) trigger();
+}
+
+void rangingHoldUntil(unsigned long ms) { holdUntilMs = ms; }
+
+void rangingOnTrigger(RangingHook hook) { onTrigger = hook; }
+
+long rangingDistance() { return lastCm; }
+
+unsigned long rangingStamp() { return lastStampMs; }
+
+uint8_t rangingSeq() { return seq; }
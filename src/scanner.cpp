@@ -0,0 +1,136 @@
+#include "ranging.h"
+#include "robot.h"
+#include "scanner.h"
+
+namespace {
+
+int8_t aim = 0;
+unsigned long settleAt = 0;
+
+const int8_t *sched = nullptr;
+uint8_t schedLen = 0;
+uint8_t schedIdx = 0;
+bool schedRepeat = false;
+bool sweeping = false;
+
+// 已触发、结果还没记下的那一次测距
+bool pending = false;
+bool pendingLast = false; // 单次扫描的最后一个角度
+int8_t pendingAngle = 0;
+uint8_t seenSeq = 0;
+
+ScanSample polar[SCAN_MAP_SIZE];
+uint8_t head = 0;   // 下一个写入位置
+uint8_t count = 0;
+uint8_t seq = 0;
+
+void moveTo(int8_t angle, unsigned long nowMs) {
+  int delta = abs(angle - aim);
+  aim = angle;
+  settleAt = nowMs + SCAN_SETTLE_MS + (unsigned long)delta * SCAN_MS_PER_DEG;
+  myServo.write(90 + angle);
+  rangingHoldUntil(settleAt);
+}
+
+void collect() {
+  if (rangingSeq() == seenSeq) return;
+  seenSeq = rangingSeq();
+  if (!pending) return;
+  pending = false;
+
+  ScanSample &s = polar[head];
+  s.angle = pendingAngle;
+  s.cm = (int16_t)rangingDistance();
+  s.ms = rangingStamp();
+  head = (head + 1) % SCAN_MAP_SIZE;
+  if (count < SCAN_MAP_SIZE) count++;
+  seq++;
+
+  if (pendingLast) {
+    pendingLast = false;
+    sweeping = false;
+  }
+}
+
+// 触发脉冲刚发出：记下这一次的角度，扫描中就立刻转向下一个角度
+void onTrigger() {
+  collect();
+  pending = true;
+  pendingAngle = aim;
+  if (!sched) return;
+
+  if (++schedIdx >= schedLen) {
+    if (!schedRepeat) {
+      pendingLast = true;
+      sched = nullptr;
+      return;
+    }
+    schedIdx = 0;
+  }
+  moveTo((int8_t)pgm_read_byte(&sched[schedIdx]), millis());
+}
+
+} // namespace
+
+void scannerBegin(unsigned long nowMs) {
+  seenSeq = rangingSeq();
+  rangingOnTrigger(onTrigger);
+  aim = 0;
+  moveTo(0, nowMs);
+}
+
+void scannerPoint(int8_t angle, unsigned long nowMs) {
+  sched = nullptr;
+  sweeping = false;
+  pendingLast = false;
+  if (angle != aim) moveTo(angle, nowMs);
+}
+
+void scannerSweep(const int8_t *angles, uint8_t count, bool repeat, unsigned long nowMs) {
+  sched = angles;
+  schedLen = count;
+  schedIdx = 0;
+  schedRepeat = repeat;
+  sweeping = true;
+  pendingLast = false;
+  moveTo((int8_t)pgm_read_byte(&angles[0]), nowMs);
+}
+
+bool scannerSweeping() { return sweeping; }
+
+void scannerUpdate() { collect(); }
+
+uint8_t scannerSeq() { return seq; }
+
+const ScanSample &scannerLatest() {
+  return polar[(head + SCAN_MAP_SIZE - 1) % SCAN_MAP_SIZE];
+}
+
+int8_t scannerAim() { return aim; }
+
+bool scannerFresh() {
+  if (count == 0) return false;
+  const ScanSample &s = scannerLatest();
+  return s.angle == aim && (long)(s.ms - settleAt) >= 0;
+}
+
+long scannerRangeAt(int8_t angle, unsigned long sinceMs) {
+  for (uint8_t i = 1; i <= count; i++) {
+    const ScanSample &s = polar[(head + SCAN_MAP_SIZE - i) % SCAN_MAP_SIZE];
+    if (s.angle == angle && (long)(s.ms - sinceMs) >= 0) return s.cm;
+  }
+  return -1;
+}
+
+long scannerNearest(int8_t from, int8_t to, unsigned long sinceMs, int8_t *angleOut) {
+  long best = RANGE_FAR_CM;
+  for (uint8_t i = 1; i <= count; i++) {
+    const ScanSample &s = polar[(head + SCAN_MAP_SIZE - i) % SCAN_MAP_SIZE];
+    if (s.angle < from || s.angle > to || (long)(s.ms - sinceMs) < 0) continue;
+    if (s.cm < best) {
+      best = s.cm;
+      if (angleOut) *angleOut = s.angle;
+    }
+  }
+  return best;
+}
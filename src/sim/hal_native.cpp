@@ -0,0 +1,279 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <deque>
+
+#include "hal.h"
+
+namespace {
+
+halsim::Backend *backend = nullptr;
+unsigned long long clockUs = 0;
+
+uint8_t modes[HAL_NUM_PINS];
+uint8_t outputs[HAL_NUM_PINS];
+uint8_t inputs[HAL_NUM_PINS];
+int pwms[HAL_NUM_PINS];
+void (*pinChange[HAL_NUM_PINS])();
+
+int servoPos = 90;
+
+const unsigned long EEPROM_WRITE_US = 3300;
+uint8_t eeprom[E2END + 1];
+unsigned long long eepromBusyUntil = 0;
+bool eepromInit = false;  // 上电时 EEPROM 为全 0xFF
+
+void eepromPowerOn() {
+  if (eepromInit) return;
+  memset(eeprom, 0xFF, sizeof(eeprom));
+  eepromInit = true;
+}
+
+void (*timerHandler)() = nullptr;
+unsigned long timerPeriodUs = 0;
+unsigned long long timerNextUs = 0;
+
+void (*serialSink)(const uint8_t *, size_t) = nullptr;
+std::deque<uint8_t> serialIn;
+
+void advanceTo(unsigned long long toUs) {
+  // 途经的定时器中断逐个在准点投递
+  while (timerHandler && timerNextUs <= toUs) {
+    unsigned long long at = timerNextUs;
+    timerNextUs += timerPeriodUs;
+    if (at > clockUs) {
+      if (backend) backend->advance(at);
+      clockUs = at;
+    }
+    timerHandler();
+  }
+  if (toUs <= clockUs) return;
+  if (backend) backend->advance(toUs);
+  clockUs = toUs;
+}
+
+size_t emit(const char *s, size_t len) {
+  if (serialSink) serialSink((const uint8_t *)s, len);
+  return len;
+}
+
+} // namespace
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  if (pin < HAL_NUM_PINS) modes[pin] = mode;
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+  if (pin >= HAL_NUM_PINS) return;
+  outputs[pin] = val ? HIGH : LOW;
+  pwms[pin] = val ? 255 : 0;
+  if (backend) backend->pinWritten(pin, outputs[pin], false);
+}
+
+int digitalRead(uint8_t pin) {
+  if (pin >= HAL_NUM_PINS) return LOW;
+  if (modes[pin] == OUTPUT) return outputs[pin];
+  if (backend) {
+    int level = backend->pinLevel(pin);
+    if (level >= 0) return level ? HIGH : LOW;
+  }
+  return inputs[pin];
+}
+
+void analogWrite(uint8_t pin, int val) {
+  if (pin >= HAL_NUM_PINS) return;
+  modes[pin] = OUTPUT;
+  pwms[pin] = constrain(val, 0, 255);
+  outputs[pin] = pwms[pin] >= 128 ? HIGH : LOW;
+  if (backend) backend->pinWritten(pin, pwms[pin], true);
+}
+
+int analogRead(uint8_t pin) {
+  if (backend && pin < HAL_NUM_PINS) {
+    int level = backend->analogLevel(pin);
+    if (level >= 0) return level;
+  }
+  return digitalRead(pin) ? 1023 : 0;
+}
+
+unsigned long millis() { return (unsigned long)(clockUs / 1000ULL); }
+
+unsigned long micros() { return (unsigned long)clockUs; }
+
+void delay(unsigned long ms) { advanceTo(clockUs + ms * 1000ULL); }
+
+void delayMicroseconds(unsigned int us) { advanceTo(clockUs + us); }
+
+unsigned long pulseIn(uint8_t pin, uint8_t state, unsigned long timeout) {
+  // 按 10us 步长推进虚拟时间等待脉冲，与板上语义一致：超时返回 0
+  const unsigned long STEP = 10;
+  unsigned long long start = clockUs;
+  while (digitalRead(pin) == state) {
+    if (clockUs - start >= timeout) return 0;
+    advanceTo(clockUs + STEP);
+  }
+  while (digitalRead(pin) != state) {
+    if (clockUs - start >= timeout) return 0;
+    advanceTo(clockUs + STEP);
+  }
+  unsigned long long rise = clockUs;
+  while (digitalRead(pin) == state) {
+    if (clockUs - start >= timeout) return 0;
+    advanceTo(clockUs + STEP);
+  }
+  return (unsigned long)(clockUs - rise);
+}
+
+void attachPinChange(uint8_t pin, void (*handler)()) {
+  if (pin < HAL_NUM_PINS) pinChange[pin] = handler;
+}
+
+void attachTimer(unsigned long periodUs, void (*handler)()) {
+  timerHandler = periodUs ? handler : nullptr;
+  timerPeriodUs = periodUs;
+  timerNextUs = clockUs + periodUs;
+}
+
+uint8_t eeprom_read_byte(const uint8_t *addr) {
+  eepromPowerOn();
+  return eeprom[(uintptr_t)addr & E2END];
+}
+
+void eeprom_update_byte(uint8_t *addr, uint8_t value) {
+  eepromPowerOn();
+  advanceTo(eepromBusyUntil);
+  uint8_t &cell = eeprom[(uintptr_t)addr & E2END];
+  if (cell == value) return;
+  cell = value;
+  eepromBusyUntil = clockUs + EEPROM_WRITE_US;
+}
+
+bool eeprom_is_ready() { return clockUs >= eepromBusyUntil; }
+
+uint8_t Servo::attach(int pin) {
+  pin_ = (int8_t)pin;
+  return 1;
+}
+
+void Servo::detach() { pin_ = -1; }
+
+void Servo::write(int angle) {
+  servoPos = constrain(angle, 0, 180);
+  if (backend && pin_ >= 0) backend->pinWritten((uint8_t)pin_, servoPos, true);
+}
+
+int Servo::read() { return servoPos; }
+
+bool Servo::attached() { return pin_ >= 0; }
+
+HardwareSerial Serial;
+
+void HardwareSerial::begin(unsigned long baud) { (void)baud; }
+
+int HardwareSerial::available() { return (int)serialIn.size(); }
+
+int HardwareSerial::read() {
+  if (serialIn.empty()) return -1;
+  int c = serialIn.front();
+  serialIn.pop_front();
+  return c;
+}
+
+int HardwareSerial::availableForWrite() { return 63; }
+
+size_t HardwareSerial::write(uint8_t b) { return emit((const char *)&b, 1); }
+
+size_t HardwareSerial::write(const uint8_t *buf, size_t len) { return emit((const char *)buf, len); }
+
+size_t HardwareSerial::print(const char *s) { return emit(s, strlen(s)); }
+
+size_t HardwareSerial::print(char c) { return emit(&c, 1); }
+
+size_t HardwareSerial::print(long v) {
+  char buf[24];
+  int n = snprintf(buf, sizeof(buf), "%ld", v);
+  return emit(buf, (size_t)n);
+}
+
+size_t HardwareSerial::print(unsigned long v) {
+  char buf[24];
+  int n = snprintf(buf, sizeof(buf), "%lu", v);
+  return emit(buf, (size_t)n);
+}
+
+size_t HardwareSerial::println() { return emit("\r\n", 2); }
+
+size_t HardwareSerial::println(const char *s) { return print(s) + println(); }
+
+size_t HardwareSerial::println(long v) { return print(v) + println(); }
+
+size_t HardwareSerial::println(unsigned long v) { return print(v) + println(); }
+
+namespace halsim {
+
+void setBackend(Backend *b) { backend = b; }
+
+unsigned long long now() { return clockUs; }
+
+void setNow(unsigned long long us) {
+  if (us > clockUs) clockUs = us;
+}
+
+void spend(unsigned long us) { advanceTo(clockUs + us); }
+
+void setInput(uint8_t pin, int level) {
+  if (pin >= HAL_NUM_PINS) return;
+  uint8_t v = level ? HIGH : LOW;
+  if (inputs[pin] == v) return;
+  inputs[pin] = v;
+  if (pinChange[pin]) pinChange[pin]();
+}
+
+int output(uint8_t pin) { return pin < HAL_NUM_PINS ? outputs[pin] : LOW; }
+
+int pwm(uint8_t pin) { return pin < HAL_NUM_PINS ? pwms[pin] : 0; }
+
+int servoAngle() { return servoPos; }
+
+void setSerialSink(void (*sink)(const uint8_t *, size_t)) { serialSink = sink; }
+
+void feedSerial(const char *data, size_t len) {
+  for (size_t i = 0; i < len; i++) serialIn.push_back((uint8_t)data[i]);
+}
+
+bool loadEeprom(const char *path) {
+  FILE *f = fopen(path, "rb");
+  if (!f) return false;
+  eepromPowerOn();
+  size_t n = fread(eeprom, 1, sizeof(eeprom), f);
+  fclose(f);
+  return n == sizeof(eeprom);
+}
+
+bool saveEeprom(const char *path) {
+  FILE *f = fopen(path, "wb");
+  if (!f) return false;
+  size_t n = fwrite(eeprom, 1, sizeof(eeprom), f);
+  fclose(f);
+  return n == sizeof(eeprom);
+}
+
+void reset() {
+  backend = nullptr;
+  clockUs = 0;
+  memset(modes, 0, sizeof(modes));
+  memset(outputs, 0, sizeof(outputs));
+  memset(inputs, 0, sizeof(inputs));
+  memset(pwms, 0, sizeof(pwms));
+  memset(pinChange, 0, sizeof(pinChange));
+  timerHandler = nullptr;
+  timerPeriodUs = 0;
+  servoPos = 90;
+  serialSink = nullptr;
+  serialIn.clear();
+  eepromInit = false;
+  eepromPowerOn();
+  eepromBusyUntil = 0;
+}
+
+} // namespace halsim
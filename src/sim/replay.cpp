@@ -0,0 +1,226 @@
+#include "replay.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <fstream>
+#include <sstream>
+
+#include "ranging.h"
+
+namespace {
+
+const unsigned long ECHO_DELAY_US = 450; // 与 world.cpp 的超声模型一致
+const unsigned long ECHO_NONE_US = 38000;
+
+int hexValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  return -1;
+}
+
+// 距离 cm 对应的回波宽度：取该 cm 区间的中点，echoUsToCm 换回来正好是 cm
+unsigned long echoWidthUs(int16_t cm) {
+  if (cm >= RANGE_FAR_CM) return ECHO_NONE_US;
+  unsigned long us = ((unsigned long)cm * 1000 + 8) / 17 + 29;
+  while (echoUsToCm(us) > (uint32_t)cm) us--;
+  while (echoUsToCm(us) < (uint32_t)cm) us++;
+  return us;
+}
+
+// 回放侧在 tick 时的电机指令（量化后），没有覆盖到返回 false
+bool motorAt(const std::vector<TraceEvent> &ev, const TraceHeader &h, uint32_t tick, int16_t &l, int16_t &r) {
+  if (tick < h.baseTick) return false;
+  bool known = h.baseMotorL != INT8_MIN;
+  l = h.baseMotorL;
+  r = h.baseMotorR;
+  for (const TraceEvent &e : ev) {
+    if (e.tick > tick) break;
+    if (e.r.kind != TR_MOTOR) continue;
+    l = e.r.a;
+    r = e.r.b;
+    known = true;
+  }
+  return known;
+}
+
+} // namespace
+
+bool loadTraceLog(const char *path, TraceLog &log, std::string &err) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    err = std::string("cannot open ") + path;
+    return false;
+  }
+  std::stringstream ss;
+  ss << in.rdbuf();
+  std::string text = ss.str();
+
+  // 串口抓包里混着遥测二进制帧，只认行首的 #trace / #t / #end
+  size_t start = std::string::npos;
+  for (size_t p = text.find("#trace "); p != std::string::npos; p = text.find("#trace ", p + 1)) {
+    if (text.find("\n#end", p) != std::string::npos) start = p;
+  }
+  if (start == std::string::npos) {
+    err = std::string(path) + ": no complete #trace ... #end block";
+    return false;
+  }
+
+  std::istringstream lines(text.substr(start));
+  std::string line;
+  std::getline(lines, line);
+  long f[9];
+  if (sscanf(line.c_str(), "#trace %ld %ld %ld %ld %ld %ld %ld %ld %ld", &f[0], &f[1], &f[2], &f[3], &f[4], &f[5],
+             &f[6], &f[7], &f[8]) != 9 || f[0] != TRACE_VERSION) {
+    err = "bad #trace header: " + line;
+    return false;
+  }
+  log.periodUs = (uint32_t)f[1];
+  log.header.baseTick = (uint32_t)f[2];
+  log.header.baseLine = f[3] < 0 ? 0xFF : (uint8_t)f[3];
+  log.header.baseMotorL = (int8_t)f[4];
+  log.header.baseMotorR = (int8_t)f[5];
+  log.header.baseRangeCm = (int16_t)f[6];
+  log.header.dropped = (uint16_t)f[7];
+  log.header.used = (uint16_t)f[8];
+
+  std::vector<uint8_t> bytes;
+  while (std::getline(lines, line)) {
+    if (!line.empty() && line.back() == '\r') line.pop_back();
+    if (line == "#end") break;
+    if (line.compare(0, 3, "#t ") != 0) continue;
+    for (size_t i = 3; i + 1 < line.size(); i += 2) {
+      int hi = hexValue(line[i]), lo = hexValue(line[i + 1]);
+      if (hi < 0 || lo < 0) break;
+      bytes.push_back((uint8_t)(hi << 4 | lo));
+    }
+  }
+  if (bytes.size() != log.header.used) {
+    err = "trace length mismatch: header " + std::to_string(log.header.used) + ", got " + std::to_string(bytes.size());
+    return false;
+  }
+  if (!decodeTrace(log.header, [&](uint16_t i) { return bytes[i]; }, log.events)) {
+    err = "corrupt trace record";
+    return false;
+  }
+  return true;
+}
+
+Replay::Replay(const TraceLog &log, const SimWiring &wiring)
+    : log_(log), pins_(wiring), line_(log.header.baseLine == 0xFF ? 0 : log.header.baseLine) {}
+
+uint32_t Replay::tick() const {
+  if (!started_) return 0;
+  return (uint32_t)((halsim::now() - t0Us_ + log_.periodUs / 2) / log_.periodUs);
+}
+
+bool Replay::done(uint32_t tailTicks) const {
+  uint32_t last = log_.events.empty() ? log_.header.baseTick : log_.events.back().tick;
+  return started_ && tick() >= last + tailTicks;
+}
+
+int Replay::pinLevel(uint8_t pin) {
+  if (pin != pins_.irL && pin != pins_.irR) return -1;
+  // 第一次读巡线头在 setup() 里（登记边沿中断、controlBegin() 的初始采样，之间不耗时），定为第 0 拍
+  if (!started_) {
+    started_ = true;
+    t0Us_ = halsim::now();
+  }
+  syncLine(halsim::now());
+  uint8_t bit = pin == pins_.irL ? 1 : 2;
+  return (line_ & bit) ? HIGH : LOW;
+}
+
+void Replay::pinWritten(uint8_t pin, int value, bool analog) {
+  (void)analog;
+  if (pin != pins_.trig) return;
+  bool high = value != LOW;
+  if (trigHigh_ && !high && !echoPending_ && !echoHigh_) {
+    const std::vector<TraceEvent> &ev = log_.events;
+    while (rangeNext_ < ev.size() && ev[rangeNext_].r.kind != TR_RANGE) rangeNext_++;
+    // 记录用完以后不再回波，固件按超时处理
+    if (rangeNext_ < ev.size()) {
+      echoRiseUs_ = halsim::now() + ECHO_DELAY_US;
+      echoFallUs_ = echoRiseUs_ + echoWidthUs(ev[rangeNext_++].r.a);
+      echoPending_ = true;
+    }
+  }
+  trigHigh_ = high;
+}
+
+bool Replay::nextLineSwitch(unsigned long long &us) {
+  const std::vector<TraceEvent> &ev = log_.events;
+  while (lineNext_ < ev.size() && ev[lineNext_].r.kind != TR_LINE) lineNext_++;
+  if (lineNext_ >= ev.size()) return false;
+  us = t0Us_ + (unsigned long long)ev[lineNext_].tick * log_.periodUs;
+  if (us > t0Us_) us--;
+  return true;
+}
+
+void Replay::syncLine(unsigned long long nowUs) {
+  unsigned long long at;
+  while (nextLineSwitch(at) && at <= nowUs) line_ = log_.events[lineNext_++].r.line;
+}
+
+void Replay::advance(unsigned long long toUs) {
+  // 巡线头状态在该拍采样前 1us 切换，同时触发引脚变化中断
+  if (started_) {
+    unsigned long long at;
+    while (nextLineSwitch(at) && at <= toUs) {
+      halsim::setNow(at);
+      line_ = log_.events[lineNext_++].r.line;
+      halsim::setInput(pins_.irL, line_ & 1 ? HIGH : LOW);
+      halsim::setInput(pins_.irR, line_ & 2 ? HIGH : LOW);
+    }
+  }
+  if (echoPending_ && echoRiseUs_ <= toUs) {
+    halsim::setNow(echoRiseUs_);
+    echoPending_ = false;
+    echoHigh_ = true;
+    halsim::setInput(pins_.echo, HIGH);
+  }
+  if (echoHigh_ && echoFallUs_ <= toUs) {
+    halsim::setNow(echoFallUs_);
+    echoHigh_ = false;
+    halsim::setInput(pins_.echo, LOW);
+  }
+}
+
+ReplayReport Replay::compare(FILE *events) const {
+  ReplayReport rep;
+  std::vector<TraceEvent> mine;
+  TraceHeader mh = {};
+#ifdef TRACE_ENABLE
+  mh = traceHeader();
+  decodeTrace(mh, traceByte, mine);
+#endif
+  if (events) fprintf(events, "t_ms,kind,a,b,replay_l,replay_r\n");
+  for (const TraceEvent &e : log_.events) {
+    if (e.r.kind == TR_LINE) rep.lineEvents++;
+    else if (e.r.kind == TR_RANGE) rep.rangeEvents++;
+    else rep.motorEvents++;
+
+    int16_t l = 0, r = 0;
+    bool known = motorAt(mine, mh, e.tick, l, r);
+    if (e.r.kind == TR_MOTOR && known) {
+      rep.motorChecked++;
+      if (l != e.r.a || r != e.r.b) {
+        rep.motorMismatch++;
+        if (rep.firstMismatchTick < 0) rep.firstMismatchTick = e.tick;
+      }
+    }
+    if (events) {
+      static const char *const KIND[] = {"line", "", "", "", "range", "motor"};
+      int a = e.r.kind == TR_LINE ? e.r.line : e.r.a;
+      int b = e.r.kind == TR_MOTOR ? e.r.b * TRACE_MOTOR_DIV : 0;
+      if (e.r.kind == TR_MOTOR) a *= TRACE_MOTOR_DIV;
+      fprintf(events, "%lu,%s,%d,%d,", (unsigned long)((unsigned long long)e.tick * log_.periodUs / 1000),
+              KIND[e.r.kind], a, b);
+      if (known) fprintf(events, "%d,%d\n", l * TRACE_MOTOR_DIV, r * TRACE_MOTOR_DIV);
+      else fprintf(events, ",\n");
+    }
+  }
+  return rep;
+}
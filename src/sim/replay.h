@@ -0,0 +1,98 @@
+#pragma once
+
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+#include "hal.h"
+#include "trace.h"
+#include "world.h"
+
+// 轨迹回放：读入固件发出的轨迹记录（串口原始抓包里最后一段 #trace ... #end），
+// 按记录的节拍把巡线头状态重新放到引脚上，超声波触发按记录顺序回答当时测到的距离，
+// 同一份控制代码照常运行（时间是虚拟的），之后逐条对比记录里和回放时的电机指令。
+//
+// 对齐方式：固件在 setup() 里第一次读巡线头，这一刻记为第 0 拍，之后每 CONTROL_PERIOD_US
+// 一拍，与板上 Timer2 的节拍一一对应。记下的快照已并入两拍之间的边沿（见 lineedge.h），回放时
+// 在该拍采样前 1us 切换电平并触发引脚变化中断，刚好落在上一个控制步之后。测距按顺序对应，不看时间。
+// 记录有丢弃（dropped > 0）时缓冲没能从上电记起，最旧一条之前按头部状态回放，赛程、学习等
+// 前面积累的状态对不上，对比结果只作参考。
+
+struct TraceEvent {
+  uint32_t tick;   // 上电以来的控制节拍
+  TraceRecord r;
+};
+
+struct TraceLog {
+  uint32_t periodUs = 0;
+  TraceHeader header = {};
+  std::vector<TraceEvent> events;
+};
+
+// 从文件里找最后一段完整的轨迹记录并解码
+bool loadTraceLog(const char *path, TraceLog &log, std::string &err);
+
+// 把 header + 字节流解码成带绝对节拍的事件，遇到坏记录返回 false
+template <typename ByteAt>
+bool decodeTrace(const TraceHeader &h, ByteAt at, std::vector<TraceEvent> &out) {
+  uint32_t tick = h.baseTick;
+  int16_t range = h.baseRangeCm;
+  uint16_t pos = 0;
+  while (pos < h.used) {
+    TraceEvent e;
+    uint8_t n = traceDecode([&](uint16_t i) { return at(pos + i); }, h.used - pos, e.r);
+    if (n == 0) return false;
+    tick += e.r.dt;
+    e.tick = tick;
+    // 重复的距离展开成普通测距记录，之后只看 TR_LINE / TR_RANGE / TR_MOTOR
+    if (e.r.kind == TR_RANGE_SAME) {
+      e.r.kind = TR_RANGE;
+      e.r.a = range;
+    }
+    if (e.r.kind == TR_RANGE) range = e.r.a;
+    out.push_back(e);
+    pos += n;
+  }
+  return true;
+}
+
+struct ReplayReport {
+  unsigned lineEvents = 0, rangeEvents = 0, motorEvents = 0;
+  unsigned motorChecked = 0;   // 回放侧有记录覆盖的电机指令条数
+  unsigned motorMismatch = 0;
+  long firstMismatchTick = -1;
+};
+
+class Replay : public halsim::Backend {
+public:
+  explicit Replay(const TraceLog &log, const SimWiring &wiring = SimWiring());
+
+  void advance(unsigned long long toUs) override;
+  void pinWritten(uint8_t pin, int value, bool analog) override;
+  int pinLevel(uint8_t pin) override;
+
+  // 已回放到最后一条记录之后 tailTicks 拍
+  bool done(uint32_t tailTicks) const;
+  uint32_t tick() const; // 当前虚拟时间对应的节拍
+
+  // 回放结束后与固件本次记下的电机指令对比；events 非空时写每条记录与回放侧状态的 CSV
+  ReplayReport compare(FILE *events) const;
+
+private:
+  bool nextLineSwitch(unsigned long long &us); // 下一条巡线记录生效的时刻，没有了返回 false
+  void syncLine(unsigned long long nowUs);
+
+  const TraceLog &log_;
+  SimWiring pins_;
+
+  bool started_ = false;
+  unsigned long long t0Us_ = 0;
+  size_t lineNext_ = 0;
+  uint8_t line_;
+  size_t rangeNext_ = 0;
+
+  bool trigHigh_ = false;
+  unsigned long long echoRiseUs_ = 0, echoFallUs_ = 0;
+  bool echoPending_ = false, echoHigh_ = false;
+};
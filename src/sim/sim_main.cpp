@@ -0,0 +1,200 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+
+#include "hal.h"
+#include "control.h"
+#include "odometry.h"
+#include "replay.h"
+#include "track.h"
+#include "world.h"
+
+// 固件入口
+void setup();
+void loop();
+
+namespace {
+
+void usage() {
+  fprintf(stderr,
+          "usage: program <track.trk> [--loop-us N] [--trace FILE] [--serial] [--send CHARS] [--eeprom FILE]\n"
+          "               [--split CM]\n"
+          "       program --replay CAPTURE [--loop-us N] [--events FILE] [--serial] [--send CHARS] [--eeprom FILE]\n"
+          "  --loop-us N   每轮 loop() 额外计入的执行时间（默认 200us）\n"
+          "  --trace FILE  每 10ms 输出一行位姿、电机 PWM 和固件的航位推算（CSV）\n"
+          "  --serial      把固件的 Serial 输出转到 stderr\n"
+          "  --send CHARS  结束后向固件串口发送 CHARS 再跑一轮 loop()（如 p 打印耗时统计）\n"
+          "  --eeprom FILE 启动时从 FILE 读入 EEPROM（不存在则全 0xFF），结束时写回\n"
+          "  --split CM    记录首次到达沿赛道弧长 CM 处的时刻（split_s，没到为 -1）及此前的离线时间\n"
+          "  --replay CAPTURE  把串口抓包里的轨迹记录（#trace ... #end）按原节拍喂给固件，对比电机指令\n"
+          "  --events FILE 回放时每条记录一行 CSV，附回放侧同一拍的电机指令\n");
+}
+
+void serialToStderr(const uint8_t *buf, size_t len) { fwrite(buf, 1, len, stderr); }
+
+// 记录的最后一条之后再跑这么多拍，让最后的动作走完
+const uint32_t REPLAY_TAIL_TICKS = 500;
+
+// 过终点之后再跑的时间
+const unsigned long long SETTLE_US = 1000000;
+
+int replayMain(int argc, char **argv) {
+  unsigned long loopUs = 200;
+  const char *sendAtEnd = nullptr;
+  const char *eepromPath = nullptr;
+  const char *eventsPath = nullptr;
+  for (int i = 3; i < argc; i++) {
+    if (!strcmp(argv[i], "--loop-us") && i + 1 < argc) loopUs = strtoul(argv[++i], nullptr, 10);
+    else if (!strcmp(argv[i], "--serial")) halsim::setSerialSink(serialToStderr);
+    else if (!strcmp(argv[i], "--send") && i + 1 < argc) sendAtEnd = argv[++i];
+    else if (!strcmp(argv[i], "--eeprom") && i + 1 < argc) eepromPath = argv[++i];
+    else if (!strcmp(argv[i], "--events") && i + 1 < argc) eventsPath = argv[++i];
+    else {
+      usage();
+      return 2;
+    }
+  }
+
+  TraceLog log;
+  std::string err;
+  if (!loadTraceLog(argv[2], log, err)) {
+    fprintf(stderr, "%s\n", err.c_str());
+    return 2;
+  }
+  if (log.periodUs != CONTROL_PERIOD_US) {
+    fprintf(stderr, "trace period %luus, this build %luus (CONTROL_HZ)\n", (unsigned long)log.periodUs,
+            (unsigned long)CONTROL_PERIOD_US);
+    return 2;
+  }
+#ifndef TRACE_ENABLE
+  fprintf(stderr, "warning: built without TRACE_ENABLE, motor commands are not compared\n");
+#endif
+
+  Replay replay(log);
+  halsim::setBackend(&replay);
+  if (eepromPath) halsim::loadEeprom(eepromPath);
+  setup();
+  // 记录本身不含时长上限，按最后一条的节拍再留 10 倍余量防止死循环
+  unsigned long long limitUs = (unsigned long long)(log.events.empty() ? 0 : log.events.back().tick) * 10 *
+                                   log.periodUs + 10000000ULL;
+  while (!replay.done(REPLAY_TAIL_TICKS) && halsim::now() < limitUs) {
+    loop();
+    halsim::spend(loopUs);
+  }
+  if (sendAtEnd) {
+    halsim::feedSerial(sendAtEnd, strlen(sendAtEnd));
+    loop();
+  }
+
+  FILE *events = eventsPath ? fopen(eventsPath, "w") : nullptr;
+  ReplayReport r = replay.compare(events);
+  if (events) fclose(events);
+
+  printf("complete=%d\n", log.header.dropped == 0 ? 1 : 0);
+  printf("dropped=%u\n", (unsigned)log.header.dropped);
+  printf("span_ms=%.1f\n", log.events.empty() ? 0.0 :
+         (log.events.back().tick - log.header.baseTick) * (double)log.periodUs / 1000.0);
+  printf("line_events=%u\n", r.lineEvents);
+  printf("range_events=%u\n", r.rangeEvents);
+  printf("motor_events=%u\n", r.motorEvents);
+  printf("motor_checked=%u\n", r.motorChecked);
+  printf("motor_mismatch=%u\n", r.motorMismatch);
+  printf("first_mismatch_ms=%.1f\n", r.firstMismatchTick < 0 ? -1.0 : r.firstMismatchTick * (double)log.periodUs / 1000.0);
+  return r.motorMismatch == 0 ? 0 : 1;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    usage();
+    return 2;
+  }
+  if (!strcmp(argv[1], "--replay")) {
+    if (argc < 3) {
+      usage();
+      return 2;
+    }
+    return replayMain(argc, argv);
+  }
+
+  unsigned long loopUs = 200;
+  const char *tracePath = nullptr;
+  const char *sendAtEnd = nullptr;
+  const char *eepromPath = nullptr;
+  double splitCm = 0;
+  for (int i = 2; i < argc; i++) {
+    if (!strcmp(argv[i], "--loop-us") && i + 1 < argc) loopUs = strtoul(argv[++i], nullptr, 10);
+    else if (!strcmp(argv[i], "--trace") && i + 1 < argc) tracePath = argv[++i];
+    else if (!strcmp(argv[i], "--serial")) halsim::setSerialSink(serialToStderr);
+    else if (!strcmp(argv[i], "--send") && i + 1 < argc) sendAtEnd = argv[++i];
+    else if (!strcmp(argv[i], "--eeprom") && i + 1 < argc) eepromPath = argv[++i];
+    else if (!strcmp(argv[i], "--split") && i + 1 < argc) splitCm = atof(argv[++i]);
+    else {
+      usage();
+      return 2;
+    }
+  }
+
+  Track track;
+  std::string err;
+  if (!track.load(argv[1], err)) {
+    fprintf(stderr, "%s\n", err.c_str());
+    return 2;
+  }
+
+  FILE *trace = tracePath ? fopen(tracePath, "w") : nullptr;
+  if (trace) fprintf(trace, "t_ms,x,y,heading_deg,pwm_l,pwm_r,dir_l,dir_r,servo,odom_x,odom_y,odom_heading_deg\n");
+
+  World world(track);
+  world.splitCm = splitCm;
+  SimWiring wiring;
+  halsim::setBackend(&world);
+
+  if (eepromPath) halsim::loadEeprom(eepromPath);
+  setup();
+  unsigned long long limitUs = (unsigned long long)(track.limitS * 1e6);
+  unsigned long long nextTrace = 0;
+  while (!world.done() && halsim::now() < limitUs) {
+    loop();
+    halsim::spend(loopUs);
+    if (trace && halsim::now() >= nextTrace) {
+      nextTrace = halsim::now() + 10000;
+      fprintf(trace, "%llu,%.2f,%.2f,%.1f,%d,%d,%d,%d,%d,%.2f,%.2f,%.1f\n", halsim::now() / 1000, world.x(), world.y(),
+              world.heading() * 180.0 / M_PI, halsim::pwm(wiring.leftPwm), halsim::pwm(wiring.rightPwm),
+              halsim::output(wiring.leftDir), halsim::output(wiring.rightDir), halsim::servoAngle(),
+              odomX() / 65536.0, odomY() / 65536.0, (int32_t)odomHeading() * (180.0 / 2147483648.0));
+    }
+  }
+  if (trace) fclose(trace);
+
+  // 成绩按过终点时算；之后再跑一会儿，固件压住黑块停车后才写学习圈的完成标志、发轨迹记录
+  SimReport r = world.report();
+  for (unsigned long long end = halsim::now() + SETTLE_US; r.finished && halsim::now() < end;) {
+    loop();
+    halsim::spend(loopUs);
+  }
+
+  if (sendAtEnd) {
+    halsim::feedSerial(sendAtEnd, strlen(sendAtEnd));
+    loop();
+  }
+
+  if (eepromPath) halsim::saveEeprom(eepromPath);
+
+  printf("finished=%d\n", r.finished ? 1 : 0);
+  printf("lap_s=%.3f\n", r.lapS);
+  printf("offline_s=%.3f\n", r.offLineS);
+  printf("collisions=%d\n", r.collisions);
+  printf("collision_s=%.3f\n", r.collisionS);
+  printf("distance_cm=%.1f\n", r.distanceCm);
+  printf("progress_cm=%.1f\n", r.progressCm);
+  if (splitCm > 0) {
+    printf("split_s=%.3f\n", r.splitS);
+    printf("split_offline_s=%.3f\n", r.splitOffLineS);
+  }
+  return r.finished ? 0 : 1;
+}
@@ -0,0 +1,132 @@
+#include "track.h"
+
+#include <math.h>
+
+#include <fstream>
+#include <sstream>
+
+namespace {
+
+bool readNums(std::istringstream &in, double *out, int n) {
+  for (int i = 0; i < n; i++) {
+    if (!(in >> out[i])) return false;
+  }
+  return true;
+}
+
+} // namespace
+
+bool Track::load(const std::string &file, std::string &err) {
+  std::ifstream f(file);
+  if (!f) {
+    err = "cannot open " + file;
+    return false;
+  }
+
+  std::string raw;
+  int lineNo = 0;
+  while (std::getline(f, raw)) {
+    lineNo++;
+    size_t hash = raw.find('#');
+    if (hash != std::string::npos) raw.erase(hash);
+
+    std::istringstream in(raw);
+    std::string key;
+    if (!(in >> key)) continue;
+
+    double v[4];
+    bool ok = true;
+    if (key == "path") {
+      double x, y;
+      while (in >> x >> y) path.push_back({x, y});
+    } else if (key == "line_width") {
+      ok = readNums(in, &lineWidth, 1);
+    } else if (key == "gap") {
+      ok = readNums(in, v, 2);
+      if (ok) gaps.push_back({v[0], v[1]});
+    } else if (key == "pad") {
+      ok = readNums(in, v, 4);
+      if (ok) pads.push_back({fmin(v[0], v[2]), fmin(v[1], v[3]), fmax(v[0], v[2]), fmax(v[1], v[3])});
+    } else if (key == "obstacle") {
+      ok = readNums(in, v, 3);
+      if (ok) obstacles.push_back({v[0], v[1], v[2]});
+    } else if (key == "start") {
+      ok = readNums(in, v, 3);
+      if (ok) {
+        start = {v[0], v[1]};
+        startHeading = v[2];
+      }
+    } else if (key == "finish") {
+      ok = readNums(in, v, 3);
+      if (ok) finish = {v[0], v[1], v[2]};
+    } else if (key == "limit") {
+      ok = readNums(in, &limitS, 1);
+    } else if (key == "robot") {
+      std::string name;
+      double val;
+      while (ok && in >> name >> val) {
+        if (name == "wheelbase") robot.wheelBase = val;
+        else if (name == "gain") robot.gain = val;
+        else if (name == "deadband") robot.deadband = val;
+        else if (name == "tau") robot.tauMs = val;
+        else if (name == "ir_forward") robot.irForward = val;
+        else if (name == "ir_spacing") robot.irSpacing = val;
+        else if (name == "ir_spot") robot.irSpot = val;
+        else if (name == "radius") robot.radius = val;
+        else if (name == "sonar_forward") robot.sonarForward = val;
+        else if (name == "servo_speed") robot.servoDegPerMs = val;
+        else ok = false;
+      }
+    } else {
+      ok = false;
+    }
+
+    if (!ok) {
+      err = file + ":" + std::to_string(lineNo) + ": bad line";
+      return false;
+    }
+  }
+
+  if (path.size() < 2) {
+    err = file + ": path needs at least 2 points";
+    return false;
+  }
+
+  pathS.assign(path.size(), 0.0);
+  for (size_t i = 1; i < path.size(); i++) {
+    pathS[i] = pathS[i - 1] + hypot(path[i].x - path[i - 1].x, path[i].y - path[i - 1].y);
+  }
+  return true;
+}
+
+double Track::distanceToPath(Vec2 p, double *sOut) const {
+  double best = 1e18, bestS = 0;
+  for (size_t i = 1; i < path.size(); i++) {
+    Vec2 a = path[i - 1], b = path[i];
+    double dx = b.x - a.x, dy = b.y - a.y;
+    double len2 = dx * dx + dy * dy;
+    double t = len2 > 0 ? ((p.x - a.x) * dx + (p.y - a.y) * dy) / len2 : 0;
+    t = fmax(0.0, fmin(1.0, t));
+    double cx = a.x + t * dx, cy = a.y + t * dy;
+    double d = hypot(p.x - cx, p.y - cy);
+    if (d < best) {
+      best = d;
+      bestS = pathS[i - 1] + t * sqrt(len2);
+    }
+  }
+  if (sOut) *sOut = bestS;
+  return best;
+}
+
+bool Track::isBlack(Vec2 p) const {
+  for (const Rect &r : pads) {
+    if (p.x >= r.x0 && p.x <= r.x1 && p.y >= r.y0 && p.y <= r.y1) return true;
+  }
+
+  double s;
+  if (distanceToPath(p, &s) > lineWidth / 2) return false;
+  for (const GapSpan &g : gaps) {
+    if (s >= g.s0 && s <= g.s1) return false;
+  }
+  return true;
+}
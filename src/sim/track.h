@@ -0,0 +1,56 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// 赛道描述（单位 cm / 度），从文本文件读入，格式见 tracks/README.md
+
+struct Vec2 {
+  double x, y;
+};
+
+struct Rect {
+  double x0, y0, x1, y1;
+};
+
+struct Circle {
+  double x, y, r;
+};
+
+struct GapSpan {
+  double s0, s1; // 沿黑线的弧长区间，区间内不涂黑
+};
+
+struct RobotParams {
+  double wheelBase = 14.0;   // 轮距
+  double gain = 0.35;        // 每 PWM 单位对应的轮速（cm/s）
+  double deadband = 40.0;    // 低于此 PWM 电机不转
+  double tauMs = 80.0;       // 电机一阶惯性时间常数
+  double irForward = 9.0;    // 巡线头到轮轴的前向距离
+  double irSpacing = 3.0;    // 左右巡线头间距
+  double irSpot = 0.6;       // 模拟巡线头的视场（高斯权重的标准差）
+  double radius = 9.0;       // 车身外接圆半径，用于碰撞
+  double sonarForward = 10.0;
+  double servoDegPerMs = 0.35; // 舵机转速（SG90 约 0.1s/60°）
+};
+
+struct Track {
+  std::vector<Vec2> path;
+  std::vector<double> pathS; // 每个顶点的累计弧长
+  double lineWidth = 1.8;
+  std::vector<GapSpan> gaps;
+  std::vector<Rect> pads;
+  std::vector<Circle> obstacles;
+  Vec2 start{0, 0};
+  double startHeading = 0;
+  Circle finish{0, 0, 0};
+  double limitS = 180;
+  RobotParams robot;
+
+  bool load(const std::string &file, std::string &err);
+
+  // 点到黑线中心线的距离，并给出投影处的弧长
+  double distanceToPath(Vec2 p, double *sOut = nullptr) const;
+  // 该点是否为黑色（黑线且不在 gap 中，或在黑块内）
+  bool isBlack(Vec2 p) const;
+};
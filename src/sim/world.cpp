@@ -0,0 +1,181 @@
+#include "world.h"
+
+#include <math.h>
+
+namespace {
+
+const double DEG = M_PI / 180.0;
+const double PHYS_STEP_US = 500;      // 物理积分步长
+const double SONAR_MAX_CM = 400;
+const double SONAR_HALF_BEAM = 7.5;   // 超声波束半角（度）
+const unsigned long ECHO_DELAY_US = 450;    // trig 结束到 echo 拉高的固有延时
+const unsigned long ECHO_NONE_US = 38000;   // 无回波时模块的 echo 高电平时长
+
+// 射线与圆相交的最近距离，没有交点返回 -1
+double rayCircle(Vec2 o, double ang, const Circle &c) {
+  double dx = cos(ang), dy = sin(ang);
+  double fx = o.x - c.x, fy = o.y - c.y;
+  double b = fx * dx + fy * dy;
+  double cc = fx * fx + fy * fy - c.r * c.r;
+  double disc = b * b - cc;
+  if (disc < 0) return -1;
+  double t = -b - sqrt(disc);
+  if (t < 0) t = -b + sqrt(disc);
+  return t >= 0 ? t : -1;
+}
+
+} // namespace
+
+World::World(const Track &track, const SimWiring &wiring)
+    : track_(track), pins_(wiring), x_(track.start.x), y_(track.start.y), th_(track.startHeading * DEG) {}
+
+Vec2 World::sensorPos(double lateral) const {
+  double f = track_.robot.irForward;
+  return {x_ + f * cos(th_) - lateral * sin(th_), y_ + f * sin(th_) + lateral * cos(th_)};
+}
+
+int World::pinLevel(uint8_t pin) {
+  // 黑线读 HIGH（固件里取反后为 1）
+  if (pin == pins_.irL) return track_.isBlack(sensorPos(track_.robot.irSpacing / 2)) ? HIGH : LOW;
+  if (pin == pins_.irR) return track_.isBlack(sensorPos(-track_.robot.irSpacing / 2)) ? HIGH : LOW;
+  return -1;
+}
+
+// 模拟巡线头：视场内黑色所占的比例，按高斯权重在 ±2σ 的方格上取样
+double World::blackCoverage(double lateral) const {
+  const int N = 4;
+  double sigma = track_.robot.irSpot;
+  double sum = 0, black = 0;
+  for (int i = -N; i <= N; i++) {
+    for (int j = -N; j <= N; j++) {
+      double u = i * sigma / 2, v = j * sigma / 2;
+      double w = exp(-(u * u + v * v) / (2 * sigma * sigma));
+      Vec2 p = sensorPos(lateral + v);
+      p.x += u * cos(th_);
+      p.y += u * sin(th_);
+      sum += w;
+      if (track_.isBlack(p)) black += w;
+    }
+  }
+  return black / sum;
+}
+
+int World::analogLevel(uint8_t pin) {
+  // 白底约 60、黑线约 900，固件上电标定时取得实际范围
+  const double WHITE = 60, BLACK = 900;
+  if (pin == pins_.irL) return (int)(WHITE + (BLACK - WHITE) * blackCoverage(track_.robot.irSpacing / 2));
+  if (pin == pins_.irR) return (int)(WHITE + (BLACK - WHITE) * blackCoverage(-track_.robot.irSpacing / 2));
+  return -1;
+}
+
+void World::pinWritten(uint8_t pin, int value, bool analog) {
+  (void)analog;
+  if (pin != pins_.trig) return;
+
+  bool high = value != LOW;
+  if (trigHigh_ && !high && !echoPending_ && !echoHigh_) {
+    double d = sonarRange();
+    unsigned long width = d < 0 ? ECHO_NONE_US : (unsigned long)(d * 2.0 / 0.0343);
+    echoRiseUs_ = halsim::now() + ECHO_DELAY_US;
+    echoFallUs_ = echoRiseUs_ + width;
+    echoPending_ = true;
+  }
+  trigHigh_ = high;
+}
+
+double World::sonarRange() const {
+  const RobotParams &rp = track_.robot;
+  Vec2 o{x_ + rp.sonarForward * cos(th_), y_ + rp.sonarForward * sin(th_)};
+  // 舵机 90 度朝正前，大于 90 偏左
+  double center = th_ + (servo_ - 90) * DEG;
+
+  double best = -1;
+  for (double off = -SONAR_HALF_BEAM; off <= SONAR_HALF_BEAM; off += 2.5) {
+    for (const Circle &c : track_.obstacles) {
+      double t = rayCircle(o, center + off * DEG, c);
+      if (t >= 0 && t <= SONAR_MAX_CM && (best < 0 || t < best)) best = t;
+    }
+  }
+  return best;
+}
+
+double World::wheelTarget(uint8_t pwmPin, uint8_t dirPin) const {
+  double p = halsim::pwm(pwmPin);
+  if (p <= track_.robot.deadband) return 0;
+  double v = (p - track_.robot.deadband) * track_.robot.gain;
+  return halsim::output(dirPin) == LOW ? -v : v;
+}
+
+void World::step(double dtS) {
+  const RobotParams &rp = track_.robot;
+
+  double k = 1.0 - exp(-dtS * 1000.0 / rp.tauMs);
+  vL_ += (wheelTarget(pins_.leftPwm, pins_.leftDir) - vL_) * k;
+  vR_ += (wheelTarget(pins_.rightPwm, pins_.rightDir) - vR_) * k;
+
+  double v = (vL_ + vR_) / 2;
+  double w = (vR_ - vL_) / rp.wheelBase;
+  x_ += v * cos(th_) * dtS;
+  y_ += v * sin(th_) * dtS;
+  th_ += w * dtS;
+  report_.distanceCm += fabs(v) * dtS;
+
+  // 舵机按固定角速度追向指令角度
+  double target = halsim::servoAngle();
+  double maxStep = rp.servoDegPerMs * dtS * 1000.0;
+  servo_ += fmax(-maxStep, fmin(maxStep, target - servo_));
+
+  double s;
+  Vec2 mid = sensorPos(0);
+  if (track_.distanceToPath(mid, &s) > offLineCm) report_.offLineS += dtS;
+  else if (s > report_.progressCm) report_.progressCm = s;
+  if (splitCm > 0 && report_.splitS < 0 && report_.progressCm >= splitCm) {
+    report_.splitS = simUs_ / 1e6;
+    report_.splitOffLineS = report_.offLineS;
+  }
+
+  bool touch = false;
+  for (const Circle &c : track_.obstacles) {
+    if (hypot(x_ - c.x, y_ - c.y) < c.r + rp.radius) touch = true;
+  }
+  if (touch && !touching_) report_.collisions++;
+  if (touch) report_.collisionS += dtS;
+  touching_ = touch;
+
+  // 终点按车头中点算：固件是巡线头压到终点黑块才停车，此时轮轴还在黑块前面
+  if (!report_.finished && track_.finish.r > 0 &&
+      hypot(mid.x - track_.finish.x, mid.y - track_.finish.y) < track_.finish.r) {
+    report_.finished = true;
+    report_.lapS = simUs_ / 1e6;
+  }
+}
+
+void World::advance(unsigned long long toUs) {
+  while (simUs_ < toUs) {
+    unsigned long long next = simUs_ + (unsigned long long)PHYS_STEP_US;
+    if (next > toUs) next = toUs;
+
+    // 回波边沿落在本步之内时，先推进到边沿时刻再触发引脚变化
+    if (echoPending_ && echoRiseUs_ <= next) next = echoRiseUs_ > simUs_ ? echoRiseUs_ : simUs_;
+    else if (echoHigh_ && echoFallUs_ <= next) next = echoFallUs_ > simUs_ ? echoFallUs_ : simUs_;
+
+    step((next - simUs_) / 1e6);
+    simUs_ = next;
+    halsim::setNow(simUs_);
+
+    // 巡线头电平按物理步更新，变化时触发引脚变化中断（固件的边沿队列）
+    halsim::setInput(pins_.irL, pinLevel(pins_.irL));
+    halsim::setInput(pins_.irR, pinLevel(pins_.irR));
+
+    if (echoPending_ && simUs_ >= echoRiseUs_) {
+      echoPending_ = false;
+      echoHigh_ = true;
+      halsim::setInput(pins_.echo, HIGH);
+    }
+    if (echoHigh_ && simUs_ >= echoFallUs_) {
+      echoHigh_ = false;
+      halsim::setInput(pins_.echo, LOW);
+    }
+  }
+  if (!report_.finished) report_.lapS = simUs_ / 1e6;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "hal.h"
+#include "track.h"
+
+// 二维差速小车运动学仿真：读取固件写出的 PWM/方向/舵机，
+// 推进车体位姿，生成巡线头电平与超声回波，统计圈速、离线时间与碰撞。
+
+struct SimWiring {
+  // 与 main.cpp 的接线一致
+  uint8_t leftPwm = 5, leftDir = 7;
+  uint8_t rightPwm = 6, rightDir = 4;
+  uint8_t irL = A0, irR = A1;
+  uint8_t trig = A4, echo = A3;
+  uint8_t servo = A5;
+};
+
+struct SimReport {
+  bool finished = false;     // 到达终点区域
+  double lapS = 0;           // 到达终点用时（未完成时为仿真总时长）
+  double offLineS = 0;       // 车头偏离黑线中心超过阈值的累计时间
+  int collisions = 0;        // 车身与障碍接触次数
+  double collisionS = 0;     // 接触累计时间
+  double distanceCm = 0;     // 车体走过的路程
+  double progressCm = 0;     // 沿赛道的最远弧长
+  double splitS = -1;        // 首次到达 World::splitCm 的时刻，没到为 -1
+  double splitOffLineS = 0;  // 到该时刻为止的离线时间
+};
+
+class World : public halsim::Backend {
+public:
+  World(const Track &track, const SimWiring &wiring = SimWiring());
+
+  void advance(unsigned long long toUs) override;
+  void pinWritten(uint8_t pin, int value, bool analog) override;
+  int pinLevel(uint8_t pin) override;
+  int analogLevel(uint8_t pin) override;
+
+  bool done() const { return report_.finished; }
+  const SimReport &report() const { return report_; }
+
+  double x() const { return x_; }
+  double y() const { return y_; }
+  double heading() const { return th_; }
+
+  // 离线判定：巡线头中点离中心线超过该距离（cm）
+  double offLineCm = 4.0;
+  // 分段计时点：沿赛道弧长（cm），0 表示不计
+  double splitCm = 0;
+
+private:
+  void step(double dtS);
+  double wheelTarget(uint8_t pwmPin, uint8_t dirPin) const;
+  double sonarRange() const;
+  double blackCoverage(double lateral) const;
+  Vec2 sensorPos(double lateral) const;
+
+  const Track &track_;
+  SimWiring pins_;
+  SimReport report_;
+
+  unsigned long long simUs_ = 0;
+  double x_, y_, th_;
+  double vL_ = 0, vR_ = 0;
+  double servo_ = 90;
+  bool touching_ = false;
+
+  // 超声：trig 下降沿后安排回波上升/下降沿
+  bool trigHigh_ = false;
+  unsigned long long echoRiseUs_ = 0, echoFallUs_ = 0;
+  bool echoPending_ = false, echoHigh_ = false;
+};
@@ -0,0 +1,74 @@
+#include "hal.h"
+#include "telemetry.h"
+
+namespace {
+
+const uint8_t SYNC0 = 0xA5;
+const uint8_t SYNC1 = 0x5A;
+const uint8_t PAYLOAD_LEN = 12;
+const uint8_t FRAME_LEN = PAYLOAD_LEN + 4;
+
+unsigned long lastFrameMs = 0;
+uint16_t drops = 0;       // 累计丢帧
+uint8_t dropsPending = 0; // 上一帧之后新丢的帧，随下一帧带出
+
+uint8_t crc8(const uint8_t *p, uint8_t n) {
+  uint8_t crc = 0;
+  while (n--) {
+    crc ^= *p++;
+    for (uint8_t i = 0; i < 8; i++) crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+  }
+  return crc;
+}
+
+uint8_t clampPwm(int16_t v) {
+  if (v < 0) v = -v;
+  return v > 255 ? 255 : (uint8_t)v;
+}
+
+} // namespace
+
+void telemetryBegin() {
+  Serial.begin(TELEMETRY_BAUD);
+}
+
+bool telemetryDue() {
+  unsigned long now = millis();
+  if (now - lastFrameMs < TELEMETRY_PERIOD_MS) return false;
+  lastFrameMs = now;
+  return true;
+}
+
+void telemetrySend(const TelemetrySample &s) {
+  if (Serial.availableForWrite() < FRAME_LEN) {
+    drops++;
+    if (dropsPending < 255) dropsPending++;
+    return;
+  }
+
+  uint8_t f[FRAME_LEN];
+  f[0] = SYNC0;
+  f[1] = SYNC1;
+  f[2] = PAYLOAD_LEN;
+  uint8_t *p = f + 3;
+  p[0] = (uint8_t)s.tMs;
+  p[1] = (uint8_t)(s.tMs >> 8);
+  // bit0 valL、bit1 valR、bit2 mode、bit3~4 lastDir+1、bit5 左轮反转、bit6 右轮反转
+  p[2] = (s.valL & 1) | (s.valR & 1) << 1 | (s.mode & 1) << 2 | ((s.lastDir + 1) & 3) << 3 |
+         (s.pwmL < 0) << 5 | (s.pwmR < 0) << 6;
+  p[3] = clampPwm(s.pwmL);
+  p[4] = clampPwm(s.pwmR);
+  p[5] = s.gapsSeen;
+  p[6] = s.obstaclesSeen;
+  p[7] = s.gapsBridged;
+  p[8] = (uint8_t)s.distanceCm;
+  p[9] = (uint8_t)(s.distanceCm >> 8);
+  p[10] = dropsPending;
+  p[11] = TELEMETRY_VERSION;
+  f[FRAME_LEN - 1] = crc8(f + 2, PAYLOAD_LEN + 1);
+
+  Serial.write(f, FRAME_LEN);
+  dropsPending = 0;
+}
+
+uint16_t telemetryDrops() { return drops; }
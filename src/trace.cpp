@@ -0,0 +1,223 @@
+#include "hal.h"
+
+#include "control.h"
+#include "trace.h"
+
+#ifdef TRACE_ENABLE
+
+namespace {
+
+uint8_t buf[TRACE_BYTES];
+uint16_t tail = 0;           // 最旧一条的起点
+TraceHeader header = {0, 0xFF, 0, 0, -1, 0, 0};
+uint32_t lastTick = 0;       // 最新一条记录的节拍
+
+uint8_t curLine = 0xFF;      // 最近记下的状态，0xFF / INT8_MIN 为还没记过
+int8_t curMotorL = INT8_MIN, curMotorR = INT8_MIN;
+int16_t curRange = -1;
+
+enum FlushStage : uint8_t { FLUSH_IDLE, FLUSH_HEADER, FLUSH_DATA, FLUSH_END };
+FlushStage stage = FLUSH_IDLE;
+uint16_t flushPos = 0;
+
+uint8_t at(uint16_t i) {
+  i += tail;
+  return buf[i >= TRACE_BYTES ? i - TRACE_BYTES : i];
+}
+
+void clear() {
+  tail = 0;
+  header.used = 0;
+  header.dropped = 0;
+  header.baseTick = lastTick = controlTicks();
+  header.baseLine = curLine;
+  header.baseMotorL = curMotorL;
+  header.baseMotorR = curMotorR;
+  header.baseRangeCm = curRange;
+}
+
+// 丢掉最旧一条，把它的时间和状态并进头部
+void dropOldest() {
+  TraceRecord r;
+  uint8_t n = traceDecode(at, header.used, r);
+  if (n == 0) { // 不会发生；保险起见整段丢掉
+    header.used = 0;
+    return;
+  }
+  header.baseTick += r.dt;
+  if (r.kind == TR_LINE) header.baseLine = r.line;
+  else if (r.kind == TR_RANGE) header.baseRangeCm = r.a;
+  else if (r.kind == TR_MOTOR) {
+    header.baseMotorL = (int8_t)r.a;
+    header.baseMotorR = (int8_t)r.b;
+  }
+  tail += n;
+  if (tail >= TRACE_BYTES) tail -= TRACE_BYTES;
+  header.used -= n;
+  if (header.dropped < 0xFFFF) header.dropped++;
+}
+
+void append(uint8_t kind, const uint8_t *payload, uint8_t len) {
+  if (stage != FLUSH_IDLE) return;
+  uint32_t now = controlTicks();
+  uint32_t dt = now - lastTick;
+  lastTick = now;
+
+  uint8_t rec[TRACE_MAX_RECORD];
+  uint8_t n = 1;
+  rec[0] = (uint8_t)(kind << 5) | (dt & 0x0F);
+  dt >>= 4;
+  if (dt) {
+    rec[0] |= 0x10;
+    while (true) {
+      uint8_t c = dt & 0x7F;
+      dt >>= 7;
+      rec[n++] = dt ? c | 0x80 : c;
+      if (!dt) break;
+    }
+  }
+  for (uint8_t i = 0; i < len; i++) rec[n++] = payload[i];
+
+  while (TRACE_BYTES - header.used < n) dropOldest();
+  uint16_t pos = tail + header.used;
+  for (uint8_t i = 0; i < n; i++) {
+    if (pos >= TRACE_BYTES) pos -= TRACE_BYTES;
+    buf[pos++] = rec[i];
+  }
+  header.used += n;
+}
+
+int8_t quantize(int16_t pwm) {
+  return (int8_t)(pwm / TRACE_MOTOR_DIV);
+}
+
+char *putNum(char *p, long v) {
+  if (v < 0) {
+    *p++ = '-';
+    v = -v;
+  }
+  char tmp[10];
+  uint8_t n = 0;
+  do {
+    tmp[n++] = (char)('0' + v % 10);
+    v /= 10;
+  } while (v);
+  while (n) *p++ = tmp[--n];
+  return p;
+}
+
+char hexDigit(uint8_t v) { return (char)(v < 10 ? '0' + v : 'A' + v - 10); }
+
+// 组下一行，返回长度；没有了返回 0
+uint8_t nextLine(char *line) {
+  char *p = line;
+  if (stage == FLUSH_HEADER) {
+    memcpy(p, "#trace ", 7);
+    p += 7;
+    const long fields[] = {TRACE_VERSION, (long)CONTROL_PERIOD_US, (long)header.baseTick,
+                           header.baseLine == 0xFF ? -1 : header.baseLine, header.baseMotorL, header.baseMotorR,
+                           header.baseRangeCm, (long)header.dropped, (long)header.used};
+    for (uint8_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+      if (i) *p++ = ' ';
+      p = putNum(p, fields[i]);
+    }
+  } else if (stage == FLUSH_DATA) {
+    *p++ = '#';
+    *p++ = 't';
+    *p++ = ' ';
+    for (uint8_t i = 0; i < TRACE_HEX_BYTES && flushPos < header.used; i++, flushPos++) {
+      uint8_t b = at(flushPos);
+      *p++ = hexDigit(b >> 4);
+      *p++ = hexDigit(b & 0x0F);
+    }
+  } else if (stage == FLUSH_END) {
+    memcpy(p, "#end", 4);
+    p += 4;
+  } else {
+    return 0;
+  }
+  *p++ = '\n';
+  return (uint8_t)(p - line);
+}
+
+char pending[64];
+uint8_t pendingLen = 0;
+
+} // namespace
+
+void traceBegin() {
+  stage = FLUSH_IDLE;
+  pendingLen = 0;
+  curLine = 0xFF;
+  curMotorL = curMotorR = INT8_MIN;
+  curRange = -1;
+  clear();
+}
+
+void traceLine(uint8_t snapshot) {
+  if (snapshot == curLine || stage != FLUSH_IDLE) return;
+  curLine = snapshot;
+  append(TR_LINE | (snapshot & 3), nullptr, 0);
+}
+
+void traceRange(int16_t cm) {
+  if (stage != FLUSH_IDLE) return;
+  if (cm == curRange) {
+    append(TR_RANGE_SAME, nullptr, 0);
+    return;
+  }
+  curRange = cm;
+  uint8_t p[3];
+  uint8_t n = 0;
+  uint16_t v = cm < 0 ? 0 : (uint16_t)cm;
+  do {
+    uint8_t c = v & 0x7F;
+    v >>= 7;
+    p[n++] = v ? c | 0x80 : c;
+  } while (v);
+  append(TR_RANGE, p, n);
+}
+
+void traceMotor(int16_t left, int16_t right) {
+  int8_t l = quantize(left), r = quantize(right);
+  if ((l == curMotorL && r == curMotorR) || stage != FLUSH_IDLE) return;
+  curMotorL = l;
+  curMotorR = r;
+  uint8_t p[2] = {(uint8_t)l, (uint8_t)r};
+  append(TR_MOTOR, p, 2);
+}
+
+void traceFlush() {
+  if (stage != FLUSH_IDLE) return;
+  stage = FLUSH_HEADER;
+  flushPos = 0;
+  pendingLen = 0;
+}
+
+bool traceFlushing() { return stage != FLUSH_IDLE; }
+
+void traceService() {
+  while (stage != FLUSH_IDLE) {
+    if (pendingLen == 0) pendingLen = nextLine(pending);
+    // 整行一次写进发送缓冲，不会被遥测帧插在中间
+    if (Serial.availableForWrite() < pendingLen) return;
+    Serial.write((const uint8_t *)pending, pendingLen);
+    pendingLen = 0;
+    if (stage == FLUSH_HEADER) stage = header.used ? FLUSH_DATA : FLUSH_END;
+    else if (stage == FLUSH_DATA) stage = flushPos < header.used ? FLUSH_DATA : FLUSH_END;
+    else {
+      // 发完清空，之后的第一条状态变化照常记下
+      stage = FLUSH_IDLE;
+      curLine = 0xFF;
+      curMotorL = curMotorR = INT8_MIN;
+      curRange = -1;
+      clear();
+    }
+  }
+}
+
+const TraceHeader &traceHeader() { return header; }
+
+uint8_t traceByte(uint16_t i) { return at(i); }
+
+#endif
@@ -0,0 +1,120 @@
+#pragma once
+
+// [env:native] 测试共用：把 src/ 的固件链接到 hal_native 上，用虚拟时间驱动 setup()/loop()。
+// 巡线头用 setInput 直接给电平；超声波由 EchoStub 按设定距离回波，走固件真实的中断测距路径。
+
+#include <unity.h>
+
+#include "hal.h"
+#include "course.h"
+#include "motion.h"
+#include "robot.h"
+
+// main.cpp 里的入口和状态
+void setup();
+void loop();
+void lineFollow();
+void Gaps();
+extern int16_t cruiseSpeed;
+extern int16_t pwmCmdL, pwmCmdR;
+extern uint8_t patternEvents;
+extern unsigned long avoidCooldownUntil;
+
+namespace harness {
+
+// 与 main.cpp 的接线一致
+const uint8_t IR_L = A0;
+const uint8_t IR_R = A1;
+const uint8_t TRIG = A4;
+const uint8_t ECHO = A3;
+const uint8_t PWM_L = 5;
+const uint8_t PWM_R = 6;
+
+const unsigned long LOOP_US = 500; // 每轮 loop() 计入的执行时间
+
+// 超声波替身：trig 下降沿后 ECHO_DELAY_US 回波拉高，按 cm * 58us 拉低；cm < 0 表示没有回波
+class EchoStub : public halsim::Backend {
+public:
+  long cm = -1;
+
+  void pinWritten(uint8_t pin, int value, bool analog) override {
+    if (pin != TRIG || analog) return;
+    if (value == HIGH) trigHigh_ = true;
+    else if (trigHigh_) {
+      trigHigh_ = false;
+      if (cm < 0) return;
+      riseUs_ = halsim::now() + ECHO_DELAY_US;
+      fallUs_ = riseUs_ + (unsigned long long)cm * 58;
+      pending_ = true;
+    }
+  }
+
+  void advance(unsigned long long toUs) override {
+    if (!pending_) return;
+    if (!high_ && riseUs_ <= toUs) {
+      halsim::setNow(riseUs_);
+      high_ = true;
+      halsim::setInput(ECHO, HIGH);
+    }
+    if (high_ && fallUs_ <= toUs) {
+      halsim::setNow(fallUs_);
+      high_ = false;
+      pending_ = false;
+      halsim::setInput(ECHO, LOW);
+    }
+  }
+
+private:
+  static const unsigned long ECHO_DELAY_US = 400;
+  bool trigHigh_ = false;
+  bool high_ = false;
+  bool pending_ = false;
+  unsigned long long riseUs_ = 0;
+  unsigned long long fallUs_ = 0;
+};
+
+inline EchoStub &echo() {
+  static EchoStub stub;
+  return stub;
+}
+
+// 黑为 1
+inline void setLine(int l, int r) {
+  halsim::setInput(IR_L, l ? HIGH : LOW);
+  halsim::setInput(IR_R, r ? HIGH : LOW);
+}
+
+// 复位硬件替身和 main.cpp 的状态后上电，线在左黑右白、没有障碍
+inline void boot() {
+  halsim::reset();
+  echo() = EchoStub();
+  halsim::setBackend(&echo());
+  motionCancel();
+  robot = RobotState();
+  patternEvents = 0;
+  avoidCooldownUntil = 0; // 虚拟时钟回到 0，上一个测试留下的冷却时刻要清掉
+  setLine(1, 0);
+  setup();
+}
+
+inline void runMs(unsigned long ms) {
+  unsigned long long end = halsim::now() + ms * 1000ULL;
+  while (halsim::now() < end) {
+    loop();
+    halsim::spend(LOOP_US);
+  }
+}
+
+// 跑到 done() 为真或超时，返回是否等到
+template <typename Pred>
+bool runUntil(Pred done, unsigned long timeoutMs) {
+  unsigned long long end = halsim::now() + timeoutMs * 1000ULL;
+  while (halsim::now() < end) {
+    loop();
+    halsim::spend(LOOP_US);
+    if (done()) return true;
+  }
+  return false;
+}
+
+} // namespace harness
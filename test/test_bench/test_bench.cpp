@@ -0,0 +1,132 @@
+// 各控制路径每轮在主机上的耗时。主机比 ATmega328P 快两个数量级，绝对值只作相对比较：
+// 每条路径有一个宽松的上限，代码改动让某条路径慢了一个量级时测试失败，不用等上板。
+// 上限可在 build_flags 里覆盖，例如 -DBENCH_LOOP_MAX_NS=50000。
+
+#include <chrono>
+#include <stdio.h>
+
+#include "../harness.h"
+#include "course_isrc2025.h"
+#include "governor.h"
+#include "linepd.h"
+#include "patterns.h"
+
+#ifndef BENCH_TICKS
+#define BENCH_TICKS 20000
+#endif
+#ifndef BENCH_PATH_MAX_NS
+#define BENCH_PATH_MAX_NS 2000   // 单个模块的每轮更新
+#endif
+#ifndef BENCH_LOOP_MAX_NS
+#define BENCH_LOOP_MAX_NS 20000  // 整轮 loop()
+#endif
+
+using namespace harness;
+typedef std::chrono::steady_clock Clock;
+
+namespace {
+
+long overheadNs = 0;
+
+// 每轮前用 prepare 推进虚拟时间、换输入（不计时），只对 tick 计时，返回每轮平均 ns
+template <typename Prepare, typename Tick>
+long measure(Prepare prepare, Tick tick) {
+  long long total = 0;
+  for (long i = 0; i < BENCH_TICKS; i++) {
+    prepare(i);
+    Clock::time_point t0 = Clock::now();
+    tick();
+    total += std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t0).count();
+  }
+  long ns = (long)(total / BENCH_TICKS) - overheadNs;
+  return ns > 0 ? ns : 0;
+}
+
+void report(const char *name, long ns, long maxNs) {
+  char msg[96];
+  snprintf(msg, sizeof(msg), "%-18s %6ld ns/tick (limit %ld)", name, ns, maxNs);
+  TEST_MESSAGE(msg);
+  TEST_ASSERT_LESS_OR_EQUAL_MESSAGE(maxNs, ns, name);
+}
+
+// 直道上的左右交替压线，每 40 轮换一次边
+void zigzag(long i) {
+  halsim::spend(LOOP_US);
+  int left = (i / 40) & 1;
+  setLine(left, !left);
+}
+
+} // namespace
+
+void setUp() {
+  boot();
+  runMs(50);
+  overheadNs = 0;
+  overheadNs = measure([](long) {}, [] {});
+}
+
+void tearDown() {}
+
+void test_bench_line_pd() {
+  long ns = measure(zigzag, [] { linePdUpdate(robot.valL, robot.valR, robot.lastDir, millis(), 110, 60); });
+  report("linePdUpdate", ns, BENCH_PATH_MAX_NS);
+}
+
+void test_bench_governor() {
+  long ns = measure(zigzag, [] { governorUpdate(robot.valL, robot.valR, robot.lastDir, millis(), 110); });
+  report("governorUpdate", ns, BENCH_PATH_MAX_NS);
+}
+
+void test_bench_patterns() {
+  patternEnable(0, true);
+  patternEnable(1, true);
+  patternEnable(2, true);
+  long ns = measure(zigzag, [] { patternUpdate(lineSnapshot(robot.valL, robot.valR), millis()); });
+  report("patternUpdate", ns, BENCH_PATH_MAX_NS);
+}
+
+void test_bench_line_follow() {
+  robot.originCleared = 1;
+  long ns = measure(
+      [](long i) {
+        zigzag(i);
+        robot.valL = (i / 40) & 1;
+        robot.valR = !robot.valL;
+      },
+      [] { lineFollow(); });
+  report("lineFollow", ns, BENCH_PATH_MAX_NS);
+}
+
+void test_bench_loop_cruise() {
+  echo().cm = 150;
+  long ns = measure(zigzag, [] { loop(); });
+  report("loop (cruise)", ns, BENCH_LOOP_MAX_NS);
+}
+
+void test_bench_loop_avoid() {
+  courseBegin(COURSE, COURSE_LEN, 0, millis());
+  // 障碍一直在 20cm，绕完就把赛程拨回等障碍的段，大部分轮次都在绕障动作里
+  echo().cm = 20;
+  long ns = measure(
+      [](long i) {
+        halsim::spend(LOOP_US);
+        setLine((i / 200) & 1, 0);
+        if (robot.mode == 0) {
+          avoidCooldownUntil = 0;
+          if (courseIndex() >= 2) courseBegin(COURSE, COURSE_LEN, 0, millis()); // 第一个绕障段已经走完
+        }
+      },
+      [] { loop(); });
+  report("loop (avoid)", ns, BENCH_LOOP_MAX_NS);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_bench_line_pd);
+  RUN_TEST(test_bench_governor);
+  RUN_TEST(test_bench_patterns);
+  RUN_TEST(test_bench_line_follow);
+  RUN_TEST(test_bench_loop_cruise);
+  RUN_TEST(test_bench_loop_avoid);
+  return UNITY_END();
+}
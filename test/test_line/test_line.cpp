@@ -0,0 +1,326 @@
+// lineFollow() 的传感器状态判断、Gaps() 的 gap 计数与跨越，跨越和丢线搜索超时，巡线头边沿队列
+
+#include "../harness.h"
+#include "budget.h"
+#include "control.h"
+#include "course_isrc2025.h"
+#include "lineadc.h"
+#include "lineedge.h"
+#include "linepd.h"
+#include "odometry.h"
+#include "patterns.h"
+
+using namespace harness;
+
+namespace {
+
+const uint8_t SEG_GAPS = 4; // COURSE 里的 SEG_BRIDGE_GAPS 段
+const uint8_t CNT_GAPS = 0; // main.cpp 的 TrackCounter
+
+void state(int l, int r, int8_t lastDir) {
+  robot.valL = l;
+  robot.valR = r;
+  robot.lastDir = lastDir;
+}
+
+void drainEdges() {
+  LineEdge e;
+  while (lineEdgePop(e)) {}
+}
+
+} // namespace
+
+void setUp() {
+  boot();
+  robot.originCleared = 1;
+  cruiseSpeed = 110;
+}
+
+void tearDown() {}
+
+void test_start_box_drives_straight_until_black() {
+  robot.originCleared = 0;
+  state(0, 0, 0);
+  lineFollow();
+  TEST_ASSERT_FALSE(motionBusy());
+  TEST_ASSERT_EQUAL(110, pwmCmdL);
+  TEST_ASSERT_EQUAL(110, pwmCmdR);
+
+  state(1, 0, 0);
+  lineFollow();
+  TEST_ASSERT_TRUE(robot.originCleared);
+}
+
+void test_line_on_left_turns_left() {
+  state(1, 0, 0);
+  lineFollow();
+  TEST_ASSERT_EQUAL(-1, robot.lastDir);
+  TEST_ASSERT_LESS_THAN(pwmCmdR, pwmCmdL);
+  TEST_ASSERT_FALSE(motionBusy());
+}
+
+void test_line_on_right_turns_right() {
+  state(0, 1, 0);
+  lineFollow();
+  TEST_ASSERT_EQUAL(1, robot.lastDir);
+  TEST_ASSERT_GREATER_THAN(pwmCmdR, pwmCmdL);
+}
+
+void test_longer_contact_steers_harder() {
+  state(1, 0, -1);
+  lineFollow();
+  int first = pwmCmdR - pwmCmdL;
+  delay(120);
+  lineFollow();
+  TEST_ASSERT_GREATER_THAN(first, pwmCmdR - pwmCmdL);
+}
+
+void test_longer_contact_steers_harder_with_headroom() {
+  // tuned_params.h 的增益（-DTUNED_PARAMS）在巡线速度 110 时第一下就打满，上一条只对默认增益成立；
+  // 两边各留 100 的余量时，两组增益都应随压线时间加大转向
+  cruiseSpeed = 155;
+  state(1, 0, -1);
+  lineFollow();
+  int first = pwmCmdR - pwmCmdL;
+  TEST_ASSERT_LESS_THAN(200, first);
+  delay(120);
+  lineFollow();
+  TEST_ASSERT_GREATER_THAN(first, pwmCmdR - pwmCmdL);
+}
+
+void test_lost_line_searches_toward_last_side() {
+  state(0, 0, 1);
+  lineFollow();
+  TEST_ASSERT_TRUE(motionBusy());
+  motionTick();
+  TEST_ASSERT_GREATER_THAN(0, pwmCmdL);
+  TEST_ASSERT_EQUAL(0, pwmCmdR);
+
+  boot();
+  robot.originCleared = 1;
+  state(0, 0, -1);
+  lineFollow();
+  motionTick();
+  TEST_ASSERT_EQUAL(0, pwmCmdL);
+  TEST_ASSERT_GREATER_THAN(0, pwmCmdR);
+}
+
+void test_lost_line_while_bridging_keeps_going() {
+  robot.bridgeGaps = 1;
+  state(0, 0, 1);
+  lineFollow();
+  TEST_ASSERT_FALSE(motionBusy());
+}
+
+void test_gap_bridge_holds_line_heading() {
+  // 沿 +x 巡线时压线，之后车头左偏（只转右轮）再丢线
+  odomTrackLine(1, 1);
+  for (int i = 0; i < 100; i++) {
+    halsim::spend(CONTROL_PERIOD_US);
+    controlDue();
+    odomUpdate(0, 150);
+  }
+  TEST_ASSERT_GREATER_THAN(0, (int32_t)odomHeading());
+
+  patternEvents = 1 << 0; // RULE_GAP
+  Gaps();
+  TEST_ASSERT_TRUE(motionBusy());
+  motionTick();
+  TEST_ASSERT_GREATER_THAN(pwmCmdR, pwmCmdL); // 往右拐回线方向
+
+  // 车头与线同向：直行
+  boot();
+  odomTrackLine(1, 1);
+  patternEvents = 1 << 0;
+  Gaps();
+  motionTick();
+  TEST_ASSERT_GREATER_THAN(0, pwmCmdL);
+  TEST_ASSERT_EQUAL(pwmCmdL, pwmCmdR);
+}
+
+void test_no_gap_event_no_motion() {
+  patternEvents = 0;
+  Gaps();
+  TEST_ASSERT_FALSE(motionBusy());
+}
+
+void test_gaps_counted_only_in_bridge_phase() {
+  courseBegin(COURSE, COURSE_LEN, SEG_GAPS, millis());
+
+  // 段开始 2.5s 内丢线是普通找线，不算 gap
+  runMs(500);
+  setLine(0, 0);
+  runMs(400);
+  TEST_ASSERT_EQUAL(0, patternCount(CNT_GAPS));
+  setLine(1, 0);
+  runMs(2000);
+
+  // 短暂双白不到 GAP_DETECT_MS 不算
+  setLine(0, 0);
+  runMs(100);
+  setLine(1, 0);
+  runMs(200);
+  TEST_ASSERT_EQUAL(0, patternCount(CNT_GAPS));
+  TEST_ASSERT_FALSE(motionBusy());
+
+  for (int gap = 1; gap <= 2; gap++) {
+    setLine(0, 0);
+    TEST_ASSERT_TRUE(runUntil([] { return motionBusy(); }, 400));
+    TEST_ASSERT_EQUAL(gap, patternCount(CNT_GAPS));
+    runMs(200);
+    setLine(1, 0); // 重新压线，跨越结束
+    TEST_ASSERT_TRUE(runUntil([] { return !motionBusy(); }, 200));
+    TEST_ASSERT_EQUAL(gap, robot.gapsBridged);
+    runMs(300);
+  }
+  TEST_ASSERT_EQUAL(SEG_GAPS + 1, courseIndex());
+  TEST_ASSERT_EQUAL(SEG_FOLLOW_UNTIL_VTURN, courseSegment().kind);
+}
+
+void test_gap_bridge_timeout_backs_up_then_searches() {
+  courseBegin(COURSE, COURSE_LEN, SEG_GAPS, millis());
+  runMs(2500);
+  setLine(0, 0);
+  TEST_ASSERT_TRUE(runUntil([] { return motionBusy(); }, 400));
+
+  // 预算内一直没压线：放弃跨越，沿原航向倒回去
+  runMs(BUDGET_GAP_MS + 300);
+  TEST_ASSERT_EQUAL(1, budgetOverruns(BUDGET_GAP));
+  TEST_ASSERT_LESS_THAN(0, pwmCmdL);
+  TEST_ASSERT_LESS_THAN(0, pwmCmdR);
+
+  // 倒回去也没有线：不再当 gap，按 lastDir 丢线搜索（左轮停、右轮转）
+  runMs(BUDGET_GAP_MS);
+  TEST_ASSERT_EQUAL(0, pwmCmdL);
+  TEST_ASSERT_GREATER_THAN(0, pwmCmdR);
+  setLine(1, 0);
+  runMs(100);
+  TEST_ASSERT_EQUAL(0, robot.gapsBridged);
+  TEST_ASSERT_GREATER_THAN(0, pwmCmdL);
+}
+
+void test_lost_line_search_switches_side_after_budget() {
+  runMs(200);
+  setLine(0, 0);
+  runMs(BUDGET_SEARCH_MS - 100);
+  TEST_ASSERT_EQUAL(-1, robot.lastDir); // 起步时线在左，一直向左找
+  TEST_ASSERT_EQUAL(0, pwmCmdL);
+
+  runMs(300);
+  TEST_ASSERT_EQUAL(1, budgetOverruns(BUDGET_SEARCH));
+  TEST_ASSERT_EQUAL(1, robot.lastDir);
+  TEST_ASSERT_GREATER_THAN(0, pwmCmdL);
+  TEST_ASSERT_EQUAL(0, pwmCmdR);
+
+  // 找到线停止计时；超时那一次已经记进本轮最长
+  setLine(0, 1);
+  runMs(50);
+  TEST_ASSERT_FALSE(budgetRunning(BUDGET_SEARCH));
+  TEST_ASSERT_GREATER_OR_EQUAL(BUDGET_SEARCH_MS, budgetWorst(BUDGET_SEARCH));
+}
+
+void test_edges_queued_in_order_with_timestamps() {
+  drainEdges();
+  unsigned long t0 = micros();
+  halsim::spend(120);
+  setLine(1, 1);
+  halsim::spend(35);
+  setLine(0, 1);
+
+  LineEdge e;
+  TEST_ASSERT_TRUE(lineEdgePop(e));
+  TEST_ASSERT_EQUAL(t0 + 120, e.us);
+  TEST_ASSERT_EQUAL(0b11, e.state);
+  TEST_ASSERT_TRUE(lineEdgePop(e));
+  TEST_ASSERT_EQUAL(t0 + 155, e.us);
+  TEST_ASSERT_EQUAL(0b10, e.state);
+  TEST_ASSERT_FALSE(lineEdgePop(e));
+}
+
+void test_full_queue_drops_newest() {
+  drainEdges();
+  for (int i = 0; i < LINE_EDGE_QUEUE + 5; i++) setLine(i & 1, 0); // 上电时左黑，每次都是一个边沿
+  TEST_ASSERT_EQUAL(5, lineEdgeDrops());
+
+  LineEdge e;
+  int n = 0;
+  while (lineEdgePop(e)) {
+    TEST_ASSERT_EQUAL(n & 1, e.state); // 留下的是最早的 LINE_EDGE_QUEUE 个
+    n++;
+  }
+  TEST_ASSERT_EQUAL(LINE_EDGE_QUEUE, n);
+}
+
+void test_blip_between_ticks_reaches_control_step() {
+  setLine(0, 0);
+  runMs(50);
+  TEST_ASSERT_EQUAL(0, robot.valL);
+
+  // 两个节拍之间压过一条细线，节拍采样时已回到白底
+  halsim::spend(200);
+  setLine(1, 0);
+  halsim::spend(100);
+  setLine(0, 0);
+  halsim::spend(CONTROL_PERIOD_US);
+  loop();
+  TEST_ASSERT_EQUAL(1, robot.valL);
+  TEST_ASSERT_EQUAL(0, robot.valR);
+
+  halsim::spend(CONTROL_PERIOD_US);
+  loop();
+  TEST_ASSERT_EQUAL(0, robot.valL);
+}
+
+void test_analog_calibration_normalizes() {
+  TEST_ASSERT_EQUAL(0, lineAdcScale(40, 40 + LINE_ADC_MIN_SPAN - 1)); // 没见过足够的黑白差
+  uint16_t scale = lineAdcScale(30, 230);
+  TEST_ASSERT_EQUAL(0, lineAdcNormalize(20, 30, scale));
+  TEST_ASSERT_EQUAL(0, lineAdcNormalize(30, 30, scale));
+  TEST_ASSERT_INT_WITHIN(1, 127, lineAdcNormalize(130, 30, scale));
+  TEST_ASSERT_EQUAL(255, lineAdcNormalize(230, 30, scale));
+  TEST_ASSERT_EQUAL(255, lineAdcNormalize(250, 30, scale));
+  TEST_ASSERT_EQUAL(77, lineAdcNormalize(77, 30, 0)); // 没标定按原始读数
+}
+
+void test_analog_position_is_continuous() {
+  int8_t side = 0;
+  TEST_ASSERT_EQUAL(0, lineAdcPositionOf(40, 40, side)); // 线在两路正中
+  TEST_ASSERT_EQUAL(0, side);
+  int16_t a = lineAdcPositionOf(80, 40, side);
+  int16_t b = lineAdcPositionOf(160, 20, side);
+  TEST_ASSERT_LESS_THAN(0, a);          // 线在左为负
+  TEST_ASSERT_LESS_THAN(a, b);          // 越往左越大
+  TEST_ASSERT_EQUAL(-Q8_ONE, lineAdcPositionOf(255, 0, side));
+  TEST_ASSERT_EQUAL(-1, side);
+  // 两路都看不到线：按最后所在侧记为 -2
+  TEST_ASSERT_EQUAL(-2 * Q8_ONE, lineAdcPositionOf(10, 5, side));
+  TEST_ASSERT_EQUAL(Q8_ONE / 2, lineAdcPositionOf(60, 180, side));
+  TEST_ASSERT_EQUAL(1, side);
+
+  // 误差直接进 PD：线在右，左轮快
+  linePdReset();
+  TEST_ASSERT_GREATER_THAN(0, linePdUpdatePosition(Q8_ONE / 2, millis(), 150, 60));
+  TEST_ASSERT_EQUAL(Q8_ONE / 2, linePdError());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_start_box_drives_straight_until_black);
+  RUN_TEST(test_line_on_left_turns_left);
+  RUN_TEST(test_line_on_right_turns_right);
+  RUN_TEST(test_longer_contact_steers_harder);
+  RUN_TEST(test_longer_contact_steers_harder_with_headroom);
+  RUN_TEST(test_lost_line_searches_toward_last_side);
+  RUN_TEST(test_lost_line_while_bridging_keeps_going);
+  RUN_TEST(test_gap_bridge_holds_line_heading);
+  RUN_TEST(test_no_gap_event_no_motion);
+  RUN_TEST(test_gaps_counted_only_in_bridge_phase);
+  RUN_TEST(test_gap_bridge_timeout_backs_up_then_searches);
+  RUN_TEST(test_lost_line_search_switches_side_after_budget);
+  RUN_TEST(test_edges_queued_in_order_with_timestamps);
+  RUN_TEST(test_full_queue_drops_newest);
+  RUN_TEST(test_blip_between_ticks_reaches_control_step);
+  RUN_TEST(test_analog_calibration_normalizes);
+  RUN_TEST(test_analog_position_is_continuous);
+  return UNITY_END();
+}
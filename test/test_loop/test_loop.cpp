@@ -0,0 +1,256 @@
+// loop() 的模式切换：巡线 -> 测到障碍 -> 绕障 -> 回到巡线，假回波不触发，黑块停车（V 弯顶点不算）；控制节拍与超时计数；绕障超时、延迟预算记录；
+// 圈学习记录的有效性与串口 'l' 重新学习
+
+#include <string>
+
+#include "../harness.h"
+#include "budget.h"
+#include "control.h"
+#include "course_isrc2025.h"
+#include "lap.h"
+#include "ranging.h"
+
+using namespace harness;
+
+namespace {
+
+const uint8_t MODE_NORMAL = 0, MODE_AVOID = 1; // main.cpp 的 Mode
+const uint8_t SEG_PAD = 6;                     // COURSE 里的 SEG_STOP_ON_PAD 段，前一段是 SEG_FOLLOW_UNTIL_VTURN
+
+std::string serialOut;
+
+void capture(const uint8_t *buf, size_t len) { serialOut.append((const char *)buf, len); }
+
+// 障碍在 20cm：测到后绕障，扫描、转向看到侧面后贴墙，先离开黑线再绕回压线
+bool bypassObstacle() {
+  echo().cm = 20;
+  if (!runUntil([] { return robot.mode == MODE_AVOID; }, 300)) return false;
+  runMs(800);
+  setLine(0, 0);
+  runMs(800);
+  setLine(1, 0);
+  runMs(100);
+  setLine(0, 0);
+  runMs(100);
+  setLine(1, 0);
+  return runUntil([] { return robot.mode == MODE_NORMAL; }, 3000);
+}
+
+// 在 EEPROM 里放一份两条事件的圈记录：左弯、黑块
+void writeLapProfile(uint8_t flags) {
+  const uint8_t bytes[] = {'L', 'P', LAP_VERSION, flags, 2, 0, 10 << 3 | LAP_CURVE_L, 10 << 3 | LAP_PAD};
+  for (uint8_t i = 0; i < sizeof(bytes); i++) eeprom_update_byte((uint8_t *)(uintptr_t)(LAP_EEPROM_BASE + i), bytes[i]);
+}
+
+// 从 V 弯段开始巡线，冲出顶点丢线（过 V 弯）进入黑块停车段，再压回线上
+bool turnPastV() {
+  courseBegin(COURSE, COURSE_LEN, SEG_PAD - 1, millis());
+  runMs(300);
+  setLine(0, 0);
+  if (!runUntil([] { return courseIndex() == SEG_PAD; }, 400)) return false;
+  setLine(1, 0);
+  runMs(100);
+  return true;
+}
+
+} // namespace
+
+void setUp() { boot(); }
+
+void tearDown() {}
+
+void test_boot_follows_line_in_normal_mode() {
+  runMs(300);
+  TEST_ASSERT_EQUAL(MODE_NORMAL, robot.mode);
+  TEST_ASSERT_EQUAL(COURSE_START, courseIndex());
+  TEST_ASSERT_EQUAL(SEG_FOLLOW_UNTIL_OBSTACLE, courseSegment().kind);
+  TEST_ASSERT_GREATER_THAN(0, halsim::pwm(PWM_L) + halsim::pwm(PWM_R));
+}
+
+void test_far_echo_is_not_an_obstacle() {
+  echo().cm = 80;
+  runMs(500);
+  TEST_ASSERT_EQUAL(MODE_NORMAL, robot.mode);
+  TEST_ASSERT_EQUAL(COURSE_START, courseIndex());
+}
+
+void test_single_spurious_echo_does_not_avoid() {
+  runMs(200);
+  uint8_t seq = rangingSeq();
+  echo().cm = 10;
+  TEST_ASSERT_TRUE(runUntil([seq] { return rangingSeq() != seq; }, 200));
+  echo().cm = -1;
+  runMs(500);
+  TEST_ASSERT_EQUAL(MODE_NORMAL, robot.mode);
+  TEST_ASSERT_EQUAL(COURSE_START, courseIndex());
+}
+
+void test_obstacle_enters_avoid_and_returns_to_normal() {
+  runMs(200);
+  echo().cm = 20;
+  TEST_ASSERT_TRUE(runUntil([] { return robot.mode == MODE_AVOID; }, 300));
+  TEST_ASSERT_EQUAL(SEG_BYPASS_LEFT, courseSegment().kind);
+  TEST_ASSERT_TRUE(motionBusy());
+
+  TEST_ASSERT_TRUE(bypassObstacle());
+  TEST_ASSERT_FALSE(motionBusy());
+  TEST_ASSERT_EQUAL(1, robot.obstaclesSeen);
+  TEST_ASSERT_EQUAL(COURSE_START + 2, courseIndex()); // 绕障段结束，进入下一段
+}
+
+void test_no_new_avoid_during_cooldown() {
+  courseBegin(COURSE, COURSE_LEN, 0, millis());
+  TEST_ASSERT_TRUE(bypassObstacle());
+  TEST_ASSERT_EQUAL(SEG_FOLLOW_UNTIL_OBSTACLE, courseSegment().kind);
+
+  // 障碍还在眼前：冷却期内不再触发
+  echo().cm = 20;
+  runMs(2500);
+  TEST_ASSERT_EQUAL(MODE_NORMAL, robot.mode);
+  TEST_ASSERT_TRUE(runUntil([] { return robot.mode == MODE_AVOID; }, 1000));
+}
+
+void test_pad_stops_robot() {
+  TEST_ASSERT_TRUE(turnPastV());
+  TEST_ASSERT_FALSE(robot.finished);
+  setLine(1, 1);
+  TEST_ASSERT_TRUE(runUntil([] { return (bool)robot.finished; }, 400));
+  runMs(50);
+  TEST_ASSERT_TRUE(courseDone());
+  TEST_ASSERT_EQUAL(0, halsim::pwm(PWM_L));
+  TEST_ASSERT_EQUAL(0, halsim::pwm(PWM_R));
+
+  // 停车后一直停着，离开黑块也不再动
+  setLine(1, 0);
+  runMs(300);
+  TEST_ASSERT_EQUAL(0, halsim::pwm(PWM_L));
+  TEST_ASSERT_EQUAL(0, halsim::pwm(PWM_R));
+}
+
+void test_short_black_is_not_a_pad() {
+  TEST_ASSERT_TRUE(turnPastV());
+  setLine(1, 1);
+  runMs(100);
+  setLine(1, 0);
+  runMs(300);
+  TEST_ASSERT_FALSE(robot.finished);
+}
+
+void test_v_apex_is_not_a_pad() {
+  // V 弯段：顶点长时间双黑也不停车
+  courseBegin(COURSE, COURSE_LEN, SEG_PAD - 1, millis());
+  runMs(300);
+  setLine(1, 1);
+  runMs(600);
+  TEST_ASSERT_FALSE(robot.finished);
+  TEST_ASSERT_EQUAL(SEG_PAD - 1, courseIndex());
+
+  // 冲出顶点丢线：过了 V 弯，离线前压的是右侧也向左找线（左轮停、右轮转）
+  setLine(0, 1);
+  runMs(100);
+  setLine(0, 0);
+  TEST_ASSERT_TRUE(runUntil([] { return courseIndex() == SEG_PAD; }, 400));
+  runMs(50);
+  TEST_ASSERT_EQUAL(0, halsim::pwm(PWM_L));
+  TEST_ASSERT_GREATER_THAN(0, halsim::pwm(PWM_R));
+
+  // 之后的双黑就是终点
+  setLine(1, 0);
+  runMs(100);
+  setLine(1, 1);
+  TEST_ASSERT_TRUE(runUntil([] { return (bool)robot.finished; }, 400));
+}
+
+void test_control_runs_at_fixed_rate() {
+  uint32_t t0 = controlTicks();
+  runMs(100); // 每轮 LOOP_US，比节拍短，一个不丢
+  TEST_ASSERT_INT_WITHIN(1, 100000 / CONTROL_PERIOD_US, controlTicks() - t0);
+  TEST_ASSERT_EQUAL(0, controlOverruns());
+}
+
+void test_slow_loop_counts_overruns() {
+  for (int i = 0; i < 10; i++) {
+    loop();
+    halsim::spend(CONTROL_PERIOD_US * 3); // 一轮拖了三个节拍
+  }
+  TEST_ASSERT_INT_WITHIN(2, 20, controlOverruns());
+}
+
+void test_bypass_timeout_returns_to_line_following() {
+  runMs(200);
+  echo().cm = 20;
+  TEST_ASSERT_TRUE(runUntil([] { return robot.mode == MODE_AVOID; }, 300));
+  // 一直没绕回线上：超过预算放弃绕障，回到巡线找线，赛程照常前进
+  setLine(0, 0);
+  TEST_ASSERT_TRUE(runUntil([] { return robot.mode == MODE_NORMAL; }, BUDGET_BYPASS_MS + 200));
+  TEST_ASSERT_EQUAL(1, budgetOverruns(BUDGET_BYPASS));
+  TEST_ASSERT_EQUAL(COURSE_START + 2, courseIndex());
+  runMs(50);
+  TEST_ASSERT_TRUE(motionBusy()); // 丢线搜索
+}
+
+void test_budget_report_kept_for_previous_run() {
+  runMs(100);
+  budgetRecord(BUDGET_GAP, 1234);
+  budgetRecord(BUDGET_CONTROL, BUDGET_CONTROL_US + 1);
+  TEST_ASSERT_EQUAL(1234, budgetWorst(BUDGET_GAP));
+  TEST_ASSERT_EQUAL(1, budgetOverruns(BUDGET_CONTROL));
+  runMs(BUDGET_SAVE_MS + 200); // 攒够一批写进 EEPROM
+
+  // 重新上电：换槽从零记，上一轮的还在另一个槽
+  setup();
+  runMs(200);
+  TEST_ASSERT_EQUAL(0, budgetWorst(BUDGET_GAP));
+  TEST_ASSERT_EQUAL(0, budgetResets());
+  TEST_ASSERT_EQUAL(BUDGET_NONE, budgetResetPath());
+  const uint8_t *at = (const uint8_t *)(uintptr_t)BUDGET_EEPROM_BASE;
+  TEST_ASSERT_EQUAL('B', eeprom_read_byte(at));
+  TEST_ASSERT_EQUAL(1 | 2, eeprom_read_byte(at + 3)); // 当前槽 1，槽 0 有效
+  const uint8_t *gap = at + 4 + 2 + 3 * BUDGET_GAP;  // 槽 0 里 gap 的记录
+  TEST_ASSERT_EQUAL(1234, eeprom_read_byte(gap) | eeprom_read_byte(gap + 1) << 8);
+
+  serialOut.clear();
+  halsim::setSerialSink(capture);
+  halsim::feedSerial("b", 1);
+  loop();
+  TEST_ASSERT_TRUE(serialOut.find("gap ms 2500 0 0 1234 0") != std::string::npos);
+  TEST_ASSERT_TRUE(serialOut.find("control us 800 0 0 801 1") != std::string::npos);
+}
+
+void test_partial_lap_profile_relearns() {
+  // 学习圈没走到黑块就断电：记录不完整，重新上电仍是学习模式
+  writeLapProfile(0);
+  setup();
+  TEST_ASSERT_EQUAL(LAP_LEARN, lapMode());
+
+  writeLapProfile(LAP_COMPLETE);
+  setup();
+  TEST_ASSERT_EQUAL(LAP_RACE, lapMode());
+  TEST_ASSERT_EQUAL(2, lapLength());
+
+  // 串口 'l'：当场改回学习，旧记录作废，下次上电也是学习
+  halsim::feedSerial("l", 1);
+  loop();
+  TEST_ASSERT_EQUAL(LAP_LEARN, lapMode());
+  runMs(200);
+  setup();
+  TEST_ASSERT_EQUAL(LAP_LEARN, lapMode());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_boot_follows_line_in_normal_mode);
+  RUN_TEST(test_far_echo_is_not_an_obstacle);
+  RUN_TEST(test_single_spurious_echo_does_not_avoid);
+  RUN_TEST(test_obstacle_enters_avoid_and_returns_to_normal);
+  RUN_TEST(test_no_new_avoid_during_cooldown);
+  RUN_TEST(test_pad_stops_robot);
+  RUN_TEST(test_short_black_is_not_a_pad);
+  RUN_TEST(test_v_apex_is_not_a_pad);
+  RUN_TEST(test_control_runs_at_fixed_rate);
+  RUN_TEST(test_slow_loop_counts_overruns);
+  RUN_TEST(test_bypass_timeout_returns_to_line_following);
+  RUN_TEST(test_budget_report_kept_for_previous_run);
+  RUN_TEST(test_partial_lap_profile_relearns);
+  return UNITY_END();
+}
@@ -0,0 +1,136 @@
+// 电机输出级：起步、停车、换向按斜率走，巡线差速直接跟随，死区补偿与刹车脉冲
+
+#include "../harness.h"
+#include "control.h"
+#include "motor.h"
+
+using namespace harness;
+
+namespace {
+
+const int UP_STEP = MOTOR_SLEW_UP * CONTROL_PERIOD_US / 1000;
+const int DOWN_STEP = MOTOR_SLEW_DOWN * CONTROL_PERIOD_US / 1000;
+
+void update(int ticks) {
+  for (int i = 0; i < ticks; i++) motorUpdate();
+}
+
+// 跑到两轮都到目标，返回用了几个节拍
+int settle(int16_t l, int16_t r) {
+  motorSet(l, r);
+  for (int i = 1; i <= 1000; i++) {
+    motorUpdate();
+    if (motorOutputL() == l && motorOutputR() == r) return i;
+  }
+  return -1;
+}
+
+} // namespace
+
+void setUp() { boot(); }
+
+void tearDown() {}
+
+void test_start_ramps_from_deadband() {
+  motorSet(200, 200);
+  motorUpdate();
+  TEST_ASSERT_EQUAL(MOTOR_DEADBAND, motorOutputL());
+  TEST_ASSERT_EQUAL(MOTOR_DEADBAND, halsim::pwm(PWM_L));
+
+  int prev = motorOutputL();
+  while (motorOutputL() < 200) {
+    motorUpdate();
+    TEST_ASSERT_LESS_OR_EQUAL(UP_STEP, motorOutputL() - prev);
+    TEST_ASSERT_GREATER_THAN(prev, motorOutputL());
+    prev = motorOutputL();
+  }
+  TEST_ASSERT_EQUAL(200, halsim::pwm(PWM_L));
+  TEST_ASSERT_EQUAL(200, halsim::pwm(PWM_R));
+}
+
+void test_steering_changes_pass_through() {
+  TEST_ASSERT_GREATER_THAN(0, settle(150, 150));
+  motorSet(MOTOR_DEADBAND, 230);
+  motorUpdate();
+  TEST_ASSERT_EQUAL(MOTOR_DEADBAND, motorOutputL());
+  TEST_ASSERT_EQUAL(230, motorOutputR());
+}
+
+void test_stop_ramps_down() {
+  settle(190, 190);
+  motorSet(0, 0);
+  motorUpdate();
+  TEST_ASSERT_EQUAL(190 - DOWN_STEP, motorOutputL());
+  int ticks = settle(0, 0);
+  TEST_ASSERT_INT_WITHIN(2, (190 - MOTOR_DEADBAND) / DOWN_STEP, ticks);
+  TEST_ASSERT_EQUAL(0, halsim::pwm(PWM_L));
+}
+
+void test_reversal_passes_through_zero() {
+  settle(150, 150);
+  motorSet(-150, 150);
+  bool sawZero = false;
+  int prev = motorOutputL();
+  for (int i = 0; i < 200 && motorOutputL() != -150; i++) {
+    motorUpdate();
+    int out = motorOutputL();
+    TEST_ASSERT_LESS_OR_EQUAL(prev, out);
+    if (out == 0) sawZero = true;
+    if (out > 0) TEST_ASSERT_EQUAL(HIGH, halsim::output(MOTOR_L_DIR));
+    if (out < 0) TEST_ASSERT_TRUE(sawZero);
+    prev = out;
+  }
+  TEST_ASSERT_EQUAL(-150, motorOutputL());
+  TEST_ASSERT_EQUAL(LOW, halsim::output(MOTOR_L_DIR));
+  TEST_ASSERT_EQUAL(150, motorOutputR());
+}
+
+void test_small_command_lifted_to_deadband() {
+  motorSet(20, -20);
+  update(5);
+  TEST_ASSERT_EQUAL(MOTOR_DEADBAND, halsim::pwm(PWM_L));
+  TEST_ASSERT_EQUAL(MOTOR_DEADBAND, halsim::pwm(PWM_R));
+  TEST_ASSERT_EQUAL(LOW, halsim::output(MOTOR_R_DIR));
+}
+
+void test_brake_pulses_reverse_then_stops() {
+  settle(255, 255);
+  motorBrake();
+  motorUpdate();
+  TEST_ASSERT_EQUAL(-MOTOR_BRAKE_PWM, motorOutputL());
+  TEST_ASSERT_EQUAL(LOW, halsim::output(MOTOR_L_DIR));
+  TEST_ASSERT_EQUAL(MOTOR_BRAKE_PWM, halsim::pwm(PWM_R));
+
+  int ticks = 1;
+  while (motorOutputL() != 0 && ticks < 1000) {
+    motorBrake(); // 停车时每个节拍都会调用，不能重新开始刹车
+    motorUpdate();
+    ticks++;
+  }
+  TEST_ASSERT_INT_WITHIN(1, MOTOR_BRAKE_MS * 1000 / CONTROL_PERIOD_US, ticks);
+  update(10);
+  TEST_ASSERT_EQUAL(0, halsim::pwm(PWM_L));
+  TEST_ASSERT_EQUAL(0, halsim::pwm(PWM_R));
+}
+
+void test_new_command_cancels_brake() {
+  settle(200, 200);
+  motorBrake();
+  motorUpdate();
+  TEST_ASSERT_LESS_THAN(0, motorOutputL());
+  motorSet(100, 100);
+  motorUpdate();
+  TEST_ASSERT_EQUAL(MOTOR_DEADBAND, motorOutputL());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_start_ramps_from_deadband);
+  RUN_TEST(test_steering_changes_pass_through);
+  RUN_TEST(test_stop_ramps_down);
+  RUN_TEST(test_reversal_passes_through_zero);
+  RUN_TEST(test_small_command_lifted_to_deadband);
+  RUN_TEST(test_brake_pulses_reverse_then_stops);
+  RUN_TEST(test_new_command_cancels_brake);
+  return UNITY_END();
+}
@@ -0,0 +1,132 @@
+// 航位推算：sin 表精度，直行路程、原地转角与电机模型的解析解一致，丢掉的节拍补推，惯性余量，线方向与横向偏差
+
+#include <math.h>
+
+#include "../harness.h"
+#include "control.h"
+#include "odometry.h"
+
+using namespace harness;
+
+namespace {
+
+const double GAIN_L = ODOM_GAIN_L_Q12 / 4096.0, GAIN_R = ODOM_GAIN_R_Q12 / 4096.0;
+const double BASE_CM = ODOM_WHEELBASE_MM / 10.0;
+
+// 模型的稳态轮速（两轮平均），cm/s
+double wheelSpeed(int pwm, double gain = (GAIN_L + GAIN_R) / 2) { return (pwm - ODOM_STALL_PWM) * gain; }
+
+// 从静止起步 t 秒走过的路程
+double lagged(double v, double t) {
+  double tau = ODOM_TAU_MS / 1000.0;
+  return v * (t - tau * (1 - exp(-t / tau)));
+}
+
+double cm(int32_t q16) { return q16 / 65536.0; }
+double deg(uint32_t angle) { return (int32_t)angle * (360.0 / 4294967296.0); }
+
+// 以 l/r 输出跑 ticks 个节拍，每次 odomUpdate 之间隔 every 拍
+void run(int16_t l, int16_t r, int ticks, int every = 1) {
+  odomUpdate(l, r);
+  for (int i = 0; i < ticks; i += every) {
+    halsim::spend(every * CONTROL_PERIOD_US);
+    controlDue();
+    odomUpdate(l, r);
+  }
+}
+
+} // namespace
+
+void setUp() {
+  halsim::reset();
+  controlBegin(nullptr);
+  odomReset();
+}
+
+void tearDown() {}
+
+void test_sin_cos_table() {
+  for (int d = -180; d <= 180; d += 7) {
+    TEST_ASSERT_INT_WITHIN(8, (int)lround(16384 * sin(d * M_PI / 180)), odomSin(odomDeg(d)));
+    TEST_ASSERT_INT_WITHIN(8, (int)lround(16384 * cos(d * M_PI / 180)), odomCos(odomDeg(d)));
+  }
+}
+
+void test_straight_run_matches_model() {
+  run(150, 150, 1000);
+  // 两轮增益不同时同样的 PWM 会走出一点弧线
+  double turn = (lagged(wheelSpeed(150, GAIN_R), 1.0) - lagged(wheelSpeed(150, GAIN_L), 1.0)) / BASE_CM;
+  TEST_ASSERT_FLOAT_WITHIN(0.3, lagged(wheelSpeed(150), 1.0), cm(odomX()));
+  TEST_ASSERT_FLOAT_WITHIN(0.05, cm(odomX()) * turn / 2, cm(odomY()));
+  TEST_ASSERT_FLOAT_WITHIN(0.1, turn * 180 / M_PI, deg(odomHeading()));
+  TEST_ASSERT_EQUAL((int)wheelSpeed(150), odomSpeedCmS());
+
+  // 低于 ODOM_STALL_PWM 不动
+  odomReset();
+  run(ODOM_STALL_PWM, ODOM_STALL_PWM, 500);
+  TEST_ASSERT_EQUAL(0, odomX());
+  TEST_ASSERT_EQUAL(0, odomTravel());
+}
+
+void test_pivot_turns_by_model() {
+  run(-150, 150, 300);
+  double rad = 2 * lagged(wheelSpeed(150), 0.3) / BASE_CM;
+  TEST_ASSERT_FLOAT_WITHIN(1.0, rad * 180 / M_PI, deg(odomHeading()));
+  TEST_ASSERT_FLOAT_WITHIN(0.1, 0, cm(odomX()));
+  TEST_ASSERT_FLOAT_WITHIN(0.1, 0, cm(odomY()));
+}
+
+void test_skipped_ticks_caught_up() {
+  run(200, 120, 600);
+  int32_t x = odomX(), y = odomY();
+  uint32_t h = odomHeading();
+
+  // 控制步每 4 拍才跑一次：补推后位姿相同
+  setUp();
+  run(200, 120, 600, 4);
+  TEST_ASSERT_INT_WITHIN(ODOM_ONE_CM / 100, x, odomX());
+  TEST_ASSERT_INT_WITHIN(ODOM_ONE_CM / 100, y, odomY());
+  TEST_ASSERT_INT_WITHIN(ODOM_DEG / 10, 0, (int32_t)(odomHeading() - h));
+}
+
+void test_coast_predicts_stopping_distance() {
+  run(180, 180, 500);
+  double coast = cm(odomCoastCm());
+  uint32_t at = odomTravel();
+  TEST_ASSERT_GREATER_THAN(0, coast);
+  run(0, 0, 1000);
+  TEST_ASSERT_FLOAT_WITHIN(coast * 0.05, coast, cm(odomTravel() - at));
+  TEST_ASSERT_EQUAL(0, odomSpeedCmS());
+}
+
+void test_line_heading_and_cross_track() {
+  // 先沿 +x 巡线，再左偏 30 度丢线：线方向仍是 +x
+  for (int i = 0; i < 20; i++) {
+    run(150, 150, 20);
+    odomTrackLine(1, 1);
+  }
+  TEST_ASSERT_FLOAT_WITHIN(0.5, 0, deg(odomLineHeading()));
+  int32_t lx = odomLineX();
+  TEST_ASSERT_FLOAT_WITHIN(0.3, cm(odomX()) + ODOM_SENSOR_MM / 10.0, cm(lx));
+
+  while (deg(odomHeading()) < 30) run(60, 150, 10);
+  run(150, 150, 300);
+  odomTrackLine(0, 0);
+  TEST_ASSERT_FLOAT_WITHIN(0.5, 0, deg(odomLineHeading()));
+  TEST_ASSERT_EQUAL(lx, odomLineX());
+
+  // 车在线的左边
+  TEST_ASSERT_GREATER_THAN(ODOM_ONE_CM, odomCrossTrack(odomLineX(), odomLineY(), odomLineHeading()));
+  TEST_ASSERT_LESS_THAN(-ODOM_ONE_CM, odomCrossTrack(odomLineX(), odomLineY(), odomLineHeading() + odomDeg(90)));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_sin_cos_table);
+  RUN_TEST(test_straight_run_matches_model);
+  RUN_TEST(test_pivot_turns_by_model);
+  RUN_TEST(test_skipped_ticks_caught_up);
+  RUN_TEST(test_coast_predicts_stopping_distance);
+  RUN_TEST(test_line_heading_and_cross_track);
+  return UNITY_END();
+}
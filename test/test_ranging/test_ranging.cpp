@@ -0,0 +1,133 @@
+// 测距换算、异步测距状态机和正前方跟踪滤波
+
+#include "../harness.h"
+#include "rangefilter.h"
+#include "ranging.h"
+
+using namespace harness;
+
+namespace {
+
+// 等下一个测距结果，返回期间新发布的结果个数（超时为 0）
+uint8_t waitSample(unsigned long timeoutMs) {
+  uint8_t seq = rangingSeq();
+  unsigned long long end = halsim::now() + timeoutMs * 1000ULL;
+  while (rangingSeq() == seq && halsim::now() < end) {
+    rangingUpdate();
+    halsim::spend(LOOP_US);
+  }
+  return rangingSeq() - seq;
+}
+
+} // namespace
+
+void setUp() {
+  halsim::reset();
+  rangeFilterReset();
+  echo() = EchoStub();
+  halsim::setBackend(&echo());
+  rangingBegin(TRIG, ECHO);
+}
+
+void tearDown() {}
+
+// 定点换算与原来的浮点公式逐点一致
+void test_echo_us_to_cm_matches_float() {
+  for (uint32_t us = 0; us <= RANGE_TIMEOUT_US; us++) {
+    long ref = (long)(us * 0.034f / 2.0f);
+    if ((long)echoUsToCm(us) != ref) {
+      TEST_ASSERT_EQUAL_INT32(ref, (long)echoUsToCm(us));
+    }
+  }
+}
+
+void test_echo_measures_distance_without_blocking() {
+  echo().cm = 42;
+  TEST_ASSERT_EQUAL(1, waitSample(100));
+  TEST_ASSERT_INT_WITHIN(1, 42, rangingDistance());
+}
+
+void test_missing_echo_times_out_far() {
+  echo().cm = 42;
+  waitSample(100);
+  echo().cm = -1;
+  TEST_ASSERT_EQUAL(1, waitSample(200));
+  TEST_ASSERT_EQUAL(RANGE_FAR_CM, rangingDistance());
+}
+
+void test_triggers_respect_interval_and_hold() {
+  echo().cm = 30;
+  waitSample(100);
+  unsigned long first = rangingStamp();
+  waitSample(200);
+  TEST_ASSERT_GREATER_OR_EQUAL(first + RANGE_INTERVAL_MS, rangingStamp());
+
+  rangingHoldUntil(millis() + 150);
+  unsigned long held = millis() + 150;
+  waitSample(400);
+  TEST_ASSERT_GREATER_OR_EQUAL(held, rangingStamp());
+}
+
+// 车以 speed cm/s 靠近 startCm 处的静止障碍，每 RANGE_INTERVAL_MS 推一个样本，返回最后一个样本的时刻
+unsigned long approach(int16_t startCm, int16_t speed, uint8_t samples, unsigned long t0 = 1000) {
+  unsigned long t = t0;
+  for (uint8_t i = 0; i < samples; i++, t += RANGE_INTERVAL_MS)
+    rangeFilterPush(startCm - (int16_t)((long)speed * (t - t0) / 1000), t, speed);
+  return t - RANGE_INTERVAL_MS;
+}
+
+void test_single_short_echo_is_rejected() {
+  rangeFilterPush(RANGE_FAR_CM, 1000, 50);
+  rangeFilterPush(12, 1040, 50);
+  TEST_ASSERT_FALSE(rangeFilterConfirmed());
+  TEST_ASSERT_EQUAL(RANGE_FAR_CM, rangeFilterTrack().cm); // 中值压掉
+  rangeFilterPush(RANGE_FAR_CM, 1080, 50);
+  TEST_ASSERT_FALSE(rangeFilterConfirmed());
+  TEST_ASSERT_EQUAL(0xFFFF, rangeFilterTimeTo(0, 1080, 50));
+}
+
+void test_approaching_obstacle_is_confirmed() {
+  approach(80, 50, 3);
+  TEST_ASSERT_TRUE(rangeFilterConfirmed());
+  TEST_ASSERT_EQUAL(78, rangeFilterTrack().cm);     // 80 78 76 的中值
+  TEST_ASSERT_EQUAL(76, rangeFilterTrack().lastCm);
+}
+
+void test_outlier_against_speed_is_gated() {
+  unsigned long t = approach(80, 50, 4);
+  uint8_t conf = rangeFilterTrack().confidence;
+  rangeFilterPush(30, t + 40, 50); // 40ms 里近了 40cm，与车速不符
+  TEST_ASSERT_LESS_THAN(conf, rangeFilterTrack().confidence);
+  TEST_ASSERT_INT_WITHIN(1, 74, rangeFilterTrack().lastCm);
+  rangeFilterPush(72, t + 80, 50); // 回到预测附近，跟踪继续
+  TEST_ASSERT_TRUE(rangeFilterConfirmed());
+}
+
+void test_dropout_keeps_track() {
+  unsigned long t = approach(80, 50, 4);
+  rangeFilterPush(RANGE_FAR_CM, t + 40, 50);
+  TEST_ASSERT_TRUE(rangeFilterConfirmed());
+  TEST_ASSERT_LESS_THAN(RF_MAX_CM, rangeFilterTrack().cm);
+}
+
+void test_time_to_extrapolates_with_speed() {
+  unsigned long t = approach(80, 50, 4); // 最后一个样本 74cm
+  TEST_ASSERT_INT_WITHIN(2, 1000, rangeFilterTimeTo(24, t, 50));
+  TEST_ASSERT_INT_WITHIN(2, 800, rangeFilterTimeTo(24, t + 200, 50));
+  TEST_ASSERT_EQUAL(0, rangeFilterTimeTo(24, t + 1200, 50));
+  TEST_ASSERT_EQUAL(0xFFFF, rangeFilterTimeTo(24, t, 0)); // 车停着不会撞上
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_echo_us_to_cm_matches_float);
+  RUN_TEST(test_echo_measures_distance_without_blocking);
+  RUN_TEST(test_missing_echo_times_out_far);
+  RUN_TEST(test_triggers_respect_interval_and_hold);
+  RUN_TEST(test_single_short_echo_is_rejected);
+  RUN_TEST(test_approaching_obstacle_is_confirmed);
+  RUN_TEST(test_outlier_against_speed_is_gated);
+  RUN_TEST(test_dropout_keeps_track);
+  RUN_TEST(test_time_to_extrapolates_with_speed);
+  return UNITY_END();
+}
@@ -0,0 +1,64 @@
+// 整圈回归：固件在 tracks/isrc2025.trk 的仿真赛道上跑一圈，车头压到终点黑块即算完成
+
+#include <string>
+
+#include "../harness.h"
+#include "course_isrc2025.h"
+#include "world.h"
+
+using namespace harness;
+
+namespace {
+
+// 测试从工程目录或任意目录运行都能找到赛道文件
+std::string trackPath() {
+  std::string self = __FILE__;
+  return self.substr(0, self.rfind("test/test_sim/")) + "tracks/isrc2025.trk";
+}
+
+// 与 sim_main 相同的驱动：上电后每轮 loop() 计入 loopUs，直到完成或超时
+SimReport lap(const Track &track, unsigned long loopUs) {
+  halsim::reset();
+  motionCancel();
+  robot = RobotState();
+  patternEvents = 0;
+  avoidCooldownUntil = 0;
+  World world(track);
+  halsim::setBackend(&world);
+  setup();
+  // 赛道只摆了第二个障碍：同 [env:sim] 的 -DCOURSE_START=2，从第 2 段开始
+  courseBegin(COURSE, COURSE_LEN, 2, millis());
+  unsigned long long limitUs = (unsigned long long)(track.limitS * 1e6);
+  while (!world.done() && halsim::now() < limitUs) {
+    loop();
+    halsim::spend(loopUs);
+  }
+  halsim::setBackend(nullptr);
+  return world.report();
+}
+
+Track track;
+
+} // namespace
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_nominal_lap_finishes() {
+  SimReport r = lap(track, 200);
+  TEST_ASSERT_TRUE(r.finished);
+  TEST_ASSERT_TRUE(r.lapS < track.limitS);
+  TEST_ASSERT_EQUAL(0, r.collisions);
+}
+
+int main() {
+  std::string err;
+  if (!track.load(trackPath(), err)) {
+    fprintf(stderr, "%s\n", err.c_str());
+    return 2;
+  }
+  UNITY_BEGIN();
+  RUN_TEST(test_nominal_lap_finishes);
+  return UNITY_END();
+}
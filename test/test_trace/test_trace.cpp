@@ -0,0 +1,152 @@
+// 轨迹记录：编码往返、只记变化、环形缓冲丢最旧并把状态并进头部、文本发出格式、串口 't' 触发
+
+#include <string>
+#include <vector>
+
+#include "../harness.h"
+#include "control.h"
+#include "trace.h"
+
+using namespace harness;
+
+namespace {
+
+std::string serialOut;
+
+void capture(const uint8_t *buf, size_t len) { serialOut.append((const char *)buf, len); }
+
+void ticks(uint32_t n) {
+  halsim::spend(n * CONTROL_PERIOD_US);
+  controlDue();
+}
+
+std::vector<TraceRecord> records() {
+  std::vector<TraceRecord> out;
+  const TraceHeader &h = traceHeader();
+  for (uint16_t pos = 0; pos < h.used;) {
+    TraceRecord r;
+    uint8_t n = traceDecode([&](uint16_t i) { return traceByte(pos + i); }, h.used - pos, r);
+    TEST_ASSERT_GREATER_THAN(0, n);
+    out.push_back(r);
+    pos += n;
+  }
+  return out;
+}
+
+} // namespace
+
+void setUp() {
+  halsim::reset();
+  controlBegin(nullptr);
+  traceBegin();
+  serialOut.clear();
+}
+
+void tearDown() {}
+
+void test_records_round_trip() {
+  traceLine(0b01);
+  ticks(3);
+  traceRange(42);
+  ticks(20);
+  traceMotor(200, -120);
+  ticks(5000);
+  traceRange(999);
+  traceRange(999);
+
+  std::vector<TraceRecord> r = records();
+  TEST_ASSERT_EQUAL(5, r.size());
+  TEST_ASSERT_EQUAL(TR_LINE, r[0].kind);
+  TEST_ASSERT_EQUAL(0b01, r[0].line);
+  TEST_ASSERT_EQUAL(0, r[0].dt);
+  TEST_ASSERT_EQUAL(TR_RANGE, r[1].kind);
+  TEST_ASSERT_EQUAL(3, r[1].dt);
+  TEST_ASSERT_EQUAL(42, r[1].a);
+  TEST_ASSERT_EQUAL(TR_MOTOR, r[2].kind);
+  TEST_ASSERT_EQUAL(20, r[2].dt);
+  TEST_ASSERT_EQUAL(200 / TRACE_MOTOR_DIV, r[2].a);
+  TEST_ASSERT_EQUAL(-120 / TRACE_MOTOR_DIV, r[2].b);
+  TEST_ASSERT_EQUAL(TR_RANGE, r[3].kind);
+  TEST_ASSERT_EQUAL(5000, r[3].dt);
+  TEST_ASSERT_EQUAL(999, r[3].a);
+  TEST_ASSERT_EQUAL(TR_RANGE_SAME, r[4].kind);
+  TEST_ASSERT_EQUAL(0, r[4].dt);
+}
+
+void test_unchanged_state_not_recorded() {
+  traceLine(0b10);
+  traceLine(0b10);
+  traceMotor(100, 100);
+  ticks(1);
+  traceMotor(101, 102); // 同一个量化格
+  TEST_ASSERT_EQUAL(2, records().size());
+  // 1 字节的线状态 + 3 字节的电机
+  TEST_ASSERT_EQUAL(4, traceHeader().used);
+}
+
+void test_full_ring_drops_oldest_into_header() {
+  for (int i = 0; i < TRACE_BYTES * 2; i++) {
+    traceLine(i & 1 ? 0b01 : 0b10);
+    ticks(1);
+  }
+  const TraceHeader &h = traceHeader();
+  TEST_ASSERT_GREATER_THAN(0, h.dropped);
+  TEST_ASSERT_LESS_OR_EQUAL(TRACE_BYTES, h.used);
+
+  std::vector<TraceRecord> r = records();
+  TEST_ASSERT_EQUAL(TRACE_BYTES * 2, h.dropped + r.size());
+  // 头部接得上：最旧一条之前的状态与它相反，时间加起来是最后一条的节拍
+  TEST_ASSERT_EQUAL(r[0].line ^ 0b11, h.baseLine);
+  uint32_t tick = h.baseTick;
+  for (const TraceRecord &x : r) tick += x.dt;
+  TEST_ASSERT_EQUAL(controlTicks() - 1, tick);
+}
+
+void test_flush_writes_text_and_restarts() {
+  halsim::setSerialSink(capture);
+  traceLine(0b11);
+  ticks(7);
+  traceRange(55);
+  uint16_t used = traceHeader().used;
+
+  traceFlush();
+  traceLine(0b00); // 发送期间不记
+  TEST_ASSERT_TRUE(traceFlushing());
+  traceService();
+  TEST_ASSERT_FALSE(traceFlushing());
+
+  TEST_ASSERT_EQUAL(0, serialOut.find("#trace 1 "));
+  size_t data = serialOut.find("\n#t ");
+  TEST_ASSERT_TRUE(data != std::string::npos);
+  TEST_ASSERT_EQUAL(used * 2, serialOut.find('\n', data + 1) - (data + 4));
+  TEST_ASSERT_EQUAL(serialOut.size() - 5, serialOut.rfind("#end\n"));
+  TEST_ASSERT_EQUAL(0, traceHeader().used);
+
+  // 发完重新开始，之后的状态照常记
+  traceLine(0b00);
+  TEST_ASSERT_EQUAL(1, records().size());
+}
+
+void test_serial_command_flushes_running_robot() {
+  boot();
+  halsim::setSerialSink(capture);
+  runMs(300);
+  TEST_ASSERT_GREATER_THAN(0, traceHeader().used);
+  TEST_ASSERT_TRUE(serialOut.find("#trace") == std::string::npos);
+
+  halsim::feedSerial("t", 1);
+  runMs(20);
+  size_t start = serialOut.find("#trace 1 ");
+  TEST_ASSERT_TRUE(start != std::string::npos);
+  TEST_ASSERT_TRUE(serialOut.find("#end\n", start) != std::string::npos);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_records_round_trip);
+  RUN_TEST(test_unchanged_state_not_recorded);
+  RUN_TEST(test_full_ring_drops_oldest_into_header);
+  RUN_TEST(test_flush_writes_text_and_restarts);
+  RUN_TEST(test_serial_command_flushes_running_robot);
+  return UNITY_END();
+}
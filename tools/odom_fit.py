@@ -0,0 +1,304 @@
+#!/usr/bin/env python3
+"""从实车上 -DODOM_CALIBRATE 标定动作的遥测抓包拟合航位推算的电机模型，生成 include/odom_params.h。
+
+标定动作见 main.cpp 的 ODOM_CAL_SEQ：先单轮原地正转、反转（右轮、左轮各一次），再前进三段、后退一段。
+
+  - 直行段：超声测距给出走过的路程。遥测里的 PWM 是控制代码的指令，按 motor.h 的斜率和死区
+    在 1ms 节拍上复原出实际输出（指令在两帧之间变化，按半帧处对齐），再按一阶惯性积分。
+    惯性 tau 和测距滞后按网格搜索，每个格点上 距离 = a - 增益 × ∫lag(PWM) + 增益 × 起转PWM × ∫lag(sign)
+    对 (a, 增益, 增益 × 起转PWM) 是线性的，最小二乘；残差最小的格点就是结果。
+  - 单轮原地转：巡线头每转一圈过线两次，第 i 和第 i+2 次压线的间隔是一圈，
+    角速度 = 该轮速度 / 轮距，得到 各轮增益 / 轮距。
+  - 两者合起来：直行给的是两轮平均增益，于是 等效轮距 = 平均增益 / 平均(各轮增益 / 轮距)。
+
+    python3 tools/odom_fit.py cal.bin
+
+仿真器里可以跑同一套流程检查拟合，结果应接近赛道文件 robot 行的参数（即 odometry.h 的默认值）；
+仿真的抓包只看结果，不写头文件：
+
+    .pio/build/sim/program tracks/odom_cal.trk --serial 2> cal.bin
+    python3 tools/odom_fit.py cal.bin --dry-run
+
+只打印结果不写文件用 --dry-run。场地、抓包方法见 README 的“航位推算标定”。
+"""
+
+import argparse
+import datetime
+import math
+import os
+import re
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from telemetry_decode import Decoder  # noqa: E402
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+HEADER = os.path.join(ROOT, "include", "odom_params.h")
+MOTOR_H = os.path.join(ROOT, "include", "motor.h")
+
+COL_T, COL_VL, COL_VR, COL_PWML, COL_PWMR, COL_DIST = 0, 1, 2, 5, 6, 10
+
+TAU_GRID = range(20, 301, 5)       # ms
+DELAY_GRID = range(0, 81, 5)       # 测距相对遥测时间的滞后，ms
+PIVOT_SETTLE_MS = 500              # 单轮转起步后这么久才开始数过线
+RANGE_FAR = 999
+
+
+def motor_constants():
+    text = open(MOTOR_H, encoding="utf-8").read()
+
+    def value(name):
+        return int(re.search(r"#define\s+%s\s+(\d+)" % name, text).group(1))
+
+    return value("MOTOR_SLEW_UP"), value("MOTOR_SLEW_DOWN"), value("MOTOR_DEADBAND")
+
+
+def read_rows(path):
+    dec = Decoder()
+    rows = []
+    with open(path, "rb") if path != "-" else sys.stdin.buffer as f:
+        while True:
+            data = f.read(65536)
+            if not data:
+                break
+            rows += dec.feed(data)
+    if dec.bad:
+        print("crc_errors=%d" % dec.bad, file=sys.stderr)
+    return rows
+
+
+def commands_per_ms(rows):
+    """每 1ms 的指令：取最近的一帧，相当于指令在两帧中间变化。"""
+    t0, t1 = rows[0][COL_T], rows[-1][COL_T]
+    cmd = []
+    k = 0
+    for t in range(t0, t1 + 1):
+        while k + 1 < len(rows) and rows[k + 1][COL_T] - t < t - rows[k][COL_T]:
+            k += 1
+        cmd.append((rows[k][COL_PWML], rows[k][COL_PWMR]))
+    return t0, cmd
+
+
+def motor_outputs(cmd, slew_up, slew_down, deadband):
+    """按 motor.cpp 的斜率与死区复原每 1ms 写出的输出（标定动作里没有刹车脉冲）。"""
+    level = [0, 0]
+    launching = [False, False]
+    out = []
+    for targets in cmd:
+        at_rest = level[0] == 0 and level[1] == 0
+        row = []
+        for i in range(2):
+            lv, target = level[i], targets[i]
+            if (lv > 0 > target) or (lv < 0 < target):
+                target = 0
+            if lv == 0 and target != 0:
+                launching[i] = at_rest
+                nxt = max(-deadband, min(deadband, target))
+            else:
+                diff = target - lv
+                up = (lv >= 0 and diff > 0) or (lv <= 0 and diff < 0)
+                running = (lv >= deadband and target >= deadband) or (lv <= -deadband and target <= -deadband)
+                if not up or not running:
+                    launching[i] = False
+                if running and not launching[i]:
+                    nxt = target
+                else:
+                    step = slew_up if up else slew_down
+                    if diff > step:
+                        nxt = lv + step
+                    elif diff < -step:
+                        nxt = lv - step
+                    else:
+                        launching[i] = False
+                        nxt = target
+            level[i] = nxt
+            mag = abs(nxt)
+            if 0 < mag < deadband:
+                mag = deadband if targets[i] != 0 else 0
+            row.append(-mag if nxt < 0 else mag)
+        out.append(row)
+    return out
+
+
+def lag_integrals(u, tau_ms):
+    """∫lag(u)：u 每 1ms 一个值，与 odometry.cpp 同样的离散一阶惯性。"""
+    alpha = 1.0 / (tau_ms + 0.5)
+    v = x = 0.0
+    xs = []
+    for ui in u:
+        v += (ui - v) * alpha
+        x += v / 1000.0
+        xs.append(x)
+    return xs
+
+
+def solve3(a, b):
+    """3x3 线性方程组，高斯消元。"""
+    m = [row[:] + [b[i]] for i, row in enumerate(a)]
+    for c in range(3):
+        p = max(range(c, 3), key=lambda r: abs(m[r][c]))
+        m[c], m[p] = m[p], m[c]
+        if abs(m[c][c]) < 1e-12:
+            return None
+        for r in range(3):
+            if r != c:
+                f = m[r][c] / m[c][c]
+                m[r] = [m[r][k] - f * m[c][k] for k in range(4)]
+    return [m[i][3] / m[i][i] for i in range(3)]
+
+
+def fit_straight(rows, t0, out):
+    """直行段：返回 (增益 cm/s/PWM, 起转 PWM, tau ms, 滞后 ms, 残差 cm)。"""
+    straight = [i for i, (l, r) in enumerate(out) if l == r and l != 0]
+    if not straight:
+        sys.exit("抓包里没有直行段（两轮指令相同）")
+    first = straight[0]
+    # 直行开始后的所有有效测距，一个读数只取第一帧
+    samples = []
+    last = None
+    for row in rows:
+        ms = row[COL_T] - t0
+        d = row[COL_DIST]
+        if ms < first or d >= RANGE_FAR:
+            continue
+        if d != last:
+            samples.append((ms, d))
+        last = d
+    if len(samples) < 10:
+        sys.exit("直行段的测距太少（%d 个），墙是否在超声范围内？" % len(samples))
+
+    u = [(l + r) / 2.0 for l, r in out]
+    s = [(1.0 if l > 0 else -1.0 if l < 0 else 0.0) for l, _ in out]
+    best = None
+    for tau in TAU_GRID:
+        x1 = lag_integrals(u, tau)
+        x0 = lag_integrals(s, tau)
+        for delay in DELAY_GRID:
+            ata = [[0.0] * 3 for _ in range(3)]
+            atb = [0.0] * 3
+            pts = []
+            for ms, d in samples:
+                k = ms - delay
+                if k < 0:
+                    continue
+                row = (1.0, -x1[k], x0[k])
+                pts.append((row, d))
+                for i in range(3):
+                    atb[i] += row[i] * d
+                    for j in range(3):
+                        ata[i][j] += row[i] * row[j]
+            sol = solve3(ata, atb)
+            if sol is None or sol[1] <= 0:
+                continue
+            err = sum((sum(r[i] * sol[i] for i in range(3)) - d) ** 2 for r, d in pts)
+            rms = math.sqrt(err / len(pts))
+            if best is None or rms < best[0]:
+                best = (rms, sol, tau, delay)
+    rms, (_, gain, gain_stall), tau, delay = best
+    return gain, gain_stall / gain, tau, delay, rms
+
+
+def pivot_phases(rows):
+    """单轮原地转的各段：[(轮 0 左/1 右, PWM, [行...])]。"""
+    phases = []
+    cur = None
+    for row in rows:
+        l, r = row[COL_PWML], row[COL_PWMR]
+        key = (0, l) if l != 0 and r == 0 else (1, r) if r != 0 and l == 0 else None
+        if cur and cur[0] == key:
+            cur[1].append(row)
+            continue
+        if cur and cur[0]:
+            phases.append((cur[0][0], cur[0][1], cur[1]))
+        cur = (key, [row])
+    if cur and cur[0]:
+        phases.append((cur[0][0], cur[0][1], cur[1]))
+    return phases
+
+
+def pivot_period(rows):
+    """转一圈的时间（ms）：两个巡线头各自第 i 和第 i+2 次压线，取能用上的最长跨度。"""
+    t_start = rows[0][COL_T] + PIVOT_SETTLE_MS
+    periods = []
+    for col in (COL_VL, COL_VR):
+        edges = [b[COL_T] for a, b in zip(rows, rows[1:]) if b[COL_T] >= t_start and not a[col] and b[col]]
+        turns = (len(edges) - 1) // 2
+        if turns >= 1:
+            periods.append((edges[2 * turns] - edges[0]) / turns)
+    return sum(periods) / len(periods) if periods else None
+
+
+def write_header(path, gains, stall, tau, base, args, summary):
+    lines = [
+        "#pragma once",
+        "",
+        "// 航位推算的电机模型参数：由 tools/odom_fit.py 从实车上 -DODOM_CALIBRATE 标定动作的遥测拟合，",
+        "// 重新生成会覆盖本文件。这里没有的参数用 odometry.h 的默认值；build_flags 里的 -D 优先于这里。",
+        "//",
+        "// %s  %s" % (datetime.date.today().isoformat(), args.label or os.path.basename(args.capture)),
+    ] + ["// " + s for s in summary] + [
+        "",
+        "#ifndef ODOM_GAIN_L_Q12",
+        "#define ODOM_GAIN_L_Q12 %d" % round(gains[0] * 4096),
+        "#endif",
+        "#ifndef ODOM_GAIN_R_Q12",
+        "#define ODOM_GAIN_R_Q12 %d" % round(gains[1] * 4096),
+        "#endif",
+        "#ifndef ODOM_STALL_PWM",
+        "#define ODOM_STALL_PWM %d" % round(stall),
+        "#endif",
+        "#ifndef ODOM_TAU_MS",
+        "#define ODOM_TAU_MS %d" % tau,
+        "#endif",
+        "#ifndef ODOM_WHEELBASE_MM",
+        "#define ODOM_WHEELBASE_MM %d" % round(base * 10),
+        "#endif",
+    ]
+    with open(path, "w", encoding="utf-8") as f:
+        f.write("\n".join(lines) + "\n")
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("capture", help="串口二进制抓包，- 为标准输入")
+    ap.add_argument("--out", default=HEADER)
+    ap.add_argument("--label", help="写进头文件注释的来源说明（哪辆车、哪套电池），默认为抓包文件名")
+    ap.add_argument("--dry-run", action="store_true", help="只打印，不写头文件")
+    args = ap.parse_args()
+
+    rows = read_rows(args.capture)
+    if len(rows) < 100:
+        sys.exit("遥测帧太少（%d 帧）" % len(rows))
+    t0, cmd = commands_per_ms(rows)
+    out = motor_outputs(cmd, *motor_constants())
+
+    gain, stall, tau, delay, rms = fit_straight(rows, t0, out)
+
+    # 各轮 增益 / 轮距（1/s 每 PWM），正反转平均
+    per_base = [[], []]
+    for wheel, pwm, phase in pivot_phases(rows):
+        period = pivot_period(phase)
+        if period is None or abs(pwm) <= stall:
+            continue
+        per_base[wheel].append(2 * math.pi / (period / 1000.0) / (abs(pwm) - stall))
+    if not per_base[0] or not per_base[1]:
+        sys.exit("缺少左轮或右轮的单轮转向段（或转得太慢，没有连续三次压线）")
+    k = [sum(v) / len(v) for v in per_base]
+    base = gain / ((k[0] + k[1]) / 2)
+    gains = (k[0] * base, k[1] * base)
+
+    summary = [
+        "直行：增益 %.4f cm/s/PWM  起转 PWM %.1f  tau %d ms  测距滞后 %d ms  残差 %.2f cm" % (gain, stall, tau, delay, rms),
+        "单轮转：左 %.5f  右 %.5f（增益 / 轮距，1/s/PWM）" % (k[0], k[1]),
+        "结果：左轮增益 %.4f  右轮增益 %.4f  等效轮距 %.1f cm" % (gains[0], gains[1], base),
+    ]
+    for s in summary:
+        print(s)
+    if not args.dry_run:
+        write_header(args.out, gains, stall, tau, base, args, summary)
+        print("写入 %s" % os.path.relpath(args.out, ROOT))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,179 @@
+#!/usr/bin/env python3
+"""固件 RAM/flash 占用报告，超出预算时失败。
+
+作为 PlatformIO 的 extra_script（见 platformio.ini 的 [env:uno]）：
+每次链接后检查总量，超出 custom_ram_budget / custom_flash_budget 时构建失败；
+另外注册一个目标按符号列出占用：
+
+    pio run -e uno -t size_report
+
+也可以单独对 elf 运行：
+
+    python3 tools/size_report.py .pio/build/uno/firmware.elf --ram 1600 --flash 32256 [--nm avr-nm]
+
+对比改动前后（比如先把改动前的 firmware.elf 复制一份）：
+
+    python3 tools/size_report.py new.elf --base old.elf
+
+RAM = .data + .bss + .noinit，flash = .text + .data（.data 的初值存在 flash 里，开机复制）。
+PROGMEM 常量在 .text 里，只算 flash。RAM 预算要给栈留余量，Uno 共 2048 字节。
+报告里另列出链接进来的软件浮点例程，热路径改成整数运算以后这一行应为空。
+"""
+
+import argparse
+import subprocess
+import sys
+
+RAM_TYPES = "bBdD"     # .bss / .data
+FLASH_TYPES = "tTrRdD"  # .text（含 PROGMEM）/ .rodata / .data 的初值
+AVR_RAM_BASE = 0x800000  # avr-nm 里数据空间地址带这个偏移
+# libgcc / avr-libc 的单精度软件浮点：四则运算、比较、与整数互转，以及 avr-libc 的 __fp_* 内部例程
+SOFT_FLOAT = ("__addsf3", "__subsf3", "__mulsf3", "__divsf3", "__cmpsf2", "__gtsf2", "__gesf2",
+              "__ltsf2", "__lesf2", "__eqsf2", "__nesf2", "__unordsf2", "__fixsfsi", "__fixunssfsi",
+              "__floatsisf", "__floatunsisf")
+
+
+def read_symbols(elf, nm="avr-nm"):
+    """返回 [(size, type, name, addr)]，按大小降序。"""
+    out = subprocess.run([nm, "--size-sort", "-C", "-S", elf],
+                         check=True, capture_output=True, text=True).stdout
+    syms = []
+    for line in out.splitlines():
+        parts = line.split(None, 3)
+        if len(parts) < 4:
+            continue
+        addr, size, kind, name = parts
+        syms.append((int(size, 16), kind, name, int(addr, 16)))
+    syms.sort(reverse=True)
+    return syms
+
+
+def in_ram(kind, addr):
+    if addr >= AVR_RAM_BASE:
+        return True
+    return kind in RAM_TYPES
+
+
+def totals(syms):
+    ram = sum(s for s, k, _, a in syms if in_ram(k, a))
+    flash = sum(s for s, k, _, a in syms if k in FLASH_TYPES)
+    return ram, flash
+
+
+def section_totals(elf, size_tool="avr-size"):
+    """按段汇总，比按符号加起来准（包含对齐填充、中断向量等无名部分）。"""
+    out = subprocess.run([size_tool, "-A", elf], check=True, capture_output=True, text=True).stdout
+    sec = {}
+    for line in out.splitlines():
+        parts = line.split()
+        if len(parts) >= 2 and parts[0].startswith(".") and parts[1].isdigit():
+            sec[parts[0]] = int(parts[1])
+    ram = sec.get(".data", 0) + sec.get(".bss", 0) + sec.get(".noinit", 0)
+    flash = sec.get(".text", 0) + sec.get(".data", 0)
+    return ram, flash
+
+
+def print_report(syms, top, out=sys.stdout):
+    ram = [(s, n) for s, k, n, a in syms if in_ram(k, a)]
+    flash = [(s, n) for s, k, n, a in syms if k in FLASH_TYPES and not in_ram(k, a)]
+    for title, rows in (("RAM", ram), ("flash", flash)):
+        print("# %s: %d 字节，最大的 %d 个符号" % (title, sum(s for s, _ in rows), min(top, len(rows))), file=out)
+        for s, n in rows[:top]:
+            print("%6d  %s" % (s, n), file=out)
+
+
+def soft_float(syms):
+    """链接进来的软件浮点例程名，按名字排序。"""
+    return sorted({n for _, k, n, _ in syms if k in "tT" and (n in SOFT_FLOAT or n.startswith("__fp_"))})
+
+
+def print_soft_float(syms, label="软件浮点", out=sys.stdout):
+    names = soft_float(syms)
+    size = sum(s for s, k, n, _ in syms if n in names and k in "tT")
+    if names:
+        print("# %s：%d 个例程 %d 字节：%s" % (label, len(names), size, " ".join(names)), file=out)
+    else:
+        print("# %s：无" % label, file=out)
+
+
+def print_compare(base, ram, flash, out=sys.stdout):
+    """base 为改动前的 (ram, flash)。"""
+    for title, old, new in (("RAM", base[0], ram), ("flash", base[1], flash)):
+        print("# %s %d -> %d 字节（%+d）" % (title, old, new, new - old), file=out)
+
+
+def check_budget(ram, flash, ram_budget, flash_budget, out=sys.stdout):
+    ok = True
+    for title, used, budget in (("RAM", ram, ram_budget), ("flash", flash, flash_budget)):
+        if not budget:
+            print("# %s %d 字节（未设预算）" % (title, used), file=out)
+            continue
+        status = "OK" if used <= budget else "超出预算"
+        print("# %s %d / %d 字节 %s" % (title, used, budget, status), file=out)
+        ok = ok and used <= budget
+    return ok
+
+
+def main(argv=None):
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("elf")
+    ap.add_argument("--ram", type=int, default=0, help="RAM 预算（字节），0 不检查")
+    ap.add_argument("--flash", type=int, default=0, help="flash 预算（字节），0 不检查")
+    ap.add_argument("--top", type=int, default=25)
+    ap.add_argument("--nm", default="avr-nm")
+    ap.add_argument("--size", default="avr-size", help="按段汇总用的 size 工具；给空串则按符号汇总")
+    ap.add_argument("--base", help="改动前的 elf，打印 RAM/flash 的前后对比")
+    args = ap.parse_args(argv)
+
+    def measure(elf):
+        syms = read_symbols(elf, args.nm)
+        return syms, section_totals(elf, args.size) if args.size else totals(syms)
+
+    syms, (ram, flash) = measure(args.elf)
+    print_report(syms, args.top)
+    print_soft_float(syms)
+    if args.base:
+        base_syms, base = measure(args.base)
+        print_soft_float(base_syms, "改动前软件浮点")
+        print_compare(base, ram, flash)
+    return 0 if check_budget(ram, flash, args.ram, args.flash) else 1
+
+
+def _platformio():
+    Import("env")  # noqa: F821 -- PlatformIO 注入
+
+    def tool(name):
+        cc = env.subst("$CC")
+        return cc[:-len("gcc")] + name if cc.endswith("gcc") else name
+
+    def budget(option):
+        value = env.GetProjectOption(option, "0")
+        return int(value) if value else 0
+
+    def run(target, source, env, verbose):
+        elf = str(source[0])
+        ram, flash = section_totals(elf, tool("size"))
+        if verbose:
+            syms = read_symbols(elf, tool("nm"))
+            print_report(syms, 25)
+            print_soft_float(syms)
+        # 动作返回非 0 即构建失败
+        return 0 if check_budget(ram, flash, budget("custom_ram_budget"), budget("custom_flash_budget")) else 1
+
+    elf = "$BUILD_DIR/${PROGNAME}.elf"
+    env.AddPostAction(elf, env.VerboseAction(lambda target, source, env: run(target, source, env, False),
+                                             "Checking RAM/flash budget"))
+    env.AddCustomTarget(
+        name="size_report",
+        dependencies=elf,
+        actions=[lambda target, source, env: run(target, source, env, True)],
+        title="Size report",
+        description="按符号列出 RAM/flash 占用并检查预算",
+    )
+
+
+# 作为 extra_script 由 SCons 执行时全局里有 Import
+if "Import" in globals():
+    _platformio()
+elif __name__ == "__main__":
+    sys.exit(main())
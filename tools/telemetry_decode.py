@@ -0,0 +1,119 @@
+#!/usr/bin/env python3
+"""把固件的二进制遥测流解码成 CSV。
+
+帧格式见 include/telemetry.h：A5 5A len payload[len] crc8。
+输入可以是抓下来的文件，也可以直接读串口（需要 pyserial）：
+
+    python3 tools/telemetry_decode.py capture.bin > run.csv
+    python3 tools/telemetry_decode.py --port /dev/ttyACM0 > run.csv
+
+帧之间混入的其它字节（例如 perf 统计的文本输出）会被跳过，CRC 错误的帧计入 stderr 的统计。
+"""
+
+import argparse
+import sys
+
+SYNC = b"\xa5\x5a"
+BAUD = 250000
+
+COLUMNS = [
+    "t_ms", "valL", "valR", "mode", "lastDir", "pwmL", "pwmR",
+    "gapsSeen", "obstaclesSeen", "gapsBridged", "distance_cm", "drops",
+]
+
+
+def crc8(data):
+    crc = 0
+    for b in data:
+        crc ^= b
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x07) & 0xFF if crc & 0x80 else (crc << 1) & 0xFF
+    return crc
+
+
+class Decoder:
+    def __init__(self):
+        self.buf = bytearray()
+        self.t_hi = 0
+        self.last_t = None
+        self.frames = 0
+        self.bad = 0
+
+    def feed(self, data):
+        """追加字节，返回其中解出的完整帧（每帧一行）。"""
+        self.buf += data
+        rows = []
+        while True:
+            i = self.buf.find(SYNC)
+            if i < 0:
+                del self.buf[:-1]
+                return rows
+            del self.buf[:i]
+            if len(self.buf) < 3:
+                return rows
+            n = self.buf[2]
+            if len(self.buf) < n + 4:
+                return rows
+            frame = bytes(self.buf[:n + 4])
+            if crc8(frame[2:n + 3]) != frame[n + 3] or n < 12:
+                self.bad += 1
+                del self.buf[:1]
+                continue
+            del self.buf[:n + 4]
+            self.frames += 1
+            rows.append(self.decode(frame[3:n + 3]))
+
+    def decode(self, p):
+        t = p[0] | p[1] << 8
+        # millis() 只发低 16 位，按单调递增展开回绕
+        if self.last_t is not None and t < self.last_t:
+            self.t_hi += 1 << 16
+        self.last_t = t
+        flags = p[2]
+        pwm_l = -p[3] if flags & 0x20 else p[3]
+        pwm_r = -p[4] if flags & 0x40 else p[4]
+        return [
+            self.t_hi + t, flags & 1, flags >> 1 & 1, flags >> 2 & 1, (flags >> 3 & 3) - 1,
+            pwm_l, pwm_r, p[5], p[6], p[7], p[8] | p[9] << 8, p[10],
+        ]
+
+
+def chunks(args):
+    if args.port:
+        import serial  # pyserial
+        with serial.Serial(args.port, args.baud, timeout=0.1) as s:
+            while True:
+                yield s.read(4096)
+    else:
+        with open(args.file, "rb") if args.file != "-" else sys.stdin.buffer as f:
+            while True:
+                data = f.read(65536)
+                if not data:
+                    return
+                yield data
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("file", nargs="?", default="-", help="二进制抓包文件，- 为标准输入")
+    ap.add_argument("--port", help="直接读串口，例如 /dev/ttyACM0")
+    ap.add_argument("--baud", type=int, default=BAUD)
+    args = ap.parse_args()
+
+    dec = Decoder()
+    out = sys.stdout
+    out.write(",".join(COLUMNS) + "\n")
+    try:
+        for data in chunks(args):
+            for row in dec.feed(data):
+                out.write(",".join(str(v) for v in row) + "\n")
+            if args.port:
+                out.flush()
+    except KeyboardInterrupt:
+        pass
+    print(f"frames={dec.frames} crc_errors={dec.bad}", file=sys.stderr)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,272 @@
+#!/usr/bin/env python3
+"""在主机仿真赛道上搜索控制参数，生成 include/tuned_params.h。
+
+每个候选参数组用 -D 编一份仿真器（源码和选项取自 platformio.ini 的 [env:sim]），在几个 loop 耗时下
+各跑一次（--race 时同一个 EEPROM 文件连跑两次：先学习再比赛，只计比赛那次），得分为
+
+    圈速 + W_OFFLINE × 离线时间 + W_COLLISION × 碰撞次数
+
+没跑完的按 limit + UNFINISHED_S × 未走完的比例计，走得越远越好。给了 --split CM 时圈速和离线时间
+换成仿真器到分段点（首次走到赛道弧长 CM 处）为止的值，用来调整体还跑不完、但前半段能比的参数；
+只在 gap / 障碍处起作用的参数，分段点之前没有 gap / 障碍时不参与搜索，也不写进头文件。
+
+取各次平均，越小越好。搜索是 (1+λ) 进化策略：每代在当前最优附近按步长随机扰动出 λ 个候选，
+多核并行评估，更好就替换；步长按 1/5 成功率规则伸缩。只在最优结果好过起点时写头文件。
+
+    python3 tools/tune.py tracks/isrc2025.trk --gens 12 --jobs 8
+    python3 tools/tune.py tracks/isrc2025.trk --race --loop-us 200,1000,2000 --seed 3
+    python3 tools/tune.py tracks/isrc2025.trk --split 550
+
+起点取 PARAMS 里的默认值，已有的 tuned_params.h 会覆盖起点（接着上次的结果搜）。
+头文件整份由本工具写出，不要手改；某个参数不想让它动，从 PARAMS 里去掉。
+生成的头文件只在 -DTUNED_PARAMS 时由 linepd.h / governor.h / main.cpp 包含：[env:sim] 打开，
+板上默认不用。仿真赛道没有打滑、电池压降等因素，上车实测确认之后再在 [env:uno] 加这个宏。
+"""
+
+import argparse
+import concurrent.futures
+import configparser
+import datetime
+import glob
+import os
+import random
+import re
+import shlex
+import shutil
+import subprocess
+import sys
+import tempfile
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+HEADER = os.path.join(ROOT, "include", "tuned_params.h")
+SIM_ENV = "env:sim"
+
+# 名称, 默认值, 下限, 上限（都是整数）, 只在哪种赛道元素处起作用（None 为全程）
+PARAMS = [
+    ("LINE_KP", 35, 15, 70, None),
+    ("LINE_KD", 15, 0, 40, None),
+    ("GOV_TOP_SPEED", 200, 120, 255, None),
+    ("SEARCH_TURN", 50, 20, 120, None),
+    ("TURN_STRONG", 80, 40, 140, None),
+    ("GAP_DETECT_MS", 200, 80, 400, "gap"),
+    ("OBST_STANDOFF", 22, 16, 32, "obstacle"),
+    ("OBST_STOP_MS", 110, 40, 250, "obstacle"),
+]
+
+W_OFFLINE = 0.5       # 每秒离线折算的圈速
+W_COLLISION = 100.0   # 每次碰撞折算的圈速，比跑不完还重：碰障的参数不能要
+UNFINISHED_S = 60.0   # 一步都没走时在 limit 之外再加，按走完的比例递减
+
+
+def read_header(path):
+    vals = {}
+    if os.path.exists(path):
+        for m in re.finditer(r"^#define\s+(\w+)\s+(-?\d+)", open(path, encoding="utf-8").read(), re.M):
+            vals[m.group(1)] = int(m.group(2))
+    return vals
+
+
+def sim_flags():
+    """platformio.ini 里 [env:sim] 的 build_flags（相对路径以工程目录为准）。"""
+    ini = configparser.ConfigParser(inline_comment_prefixes=(";",))
+    ini.read(os.path.join(ROOT, "platformio.ini"), encoding="utf-8")
+    return shlex.split(ini.get(SIM_ENV, "build_flags", fallback=""))
+
+
+def build(cand, outdir, cxx, flags):
+    # [env:sim] 的 build_src_filter 是 +<*>：src/ 下全部源码
+    srcs = sorted(glob.glob(os.path.join(ROOT, "src", "**", "*.cpp"), recursive=True))
+    exe = os.path.join(outdir, "program")
+    cmd = [cxx] + flags + ["-Iinclude"]
+    cmd += ["-D%s=%d" % kv for kv in sorted(cand.items())]
+    cmd += srcs + ["-o", exe]
+    subprocess.run(cmd, check=True, capture_output=True, cwd=ROOT)
+    return exe
+
+
+def run_sim(exe, track, loop_us, eeprom, split_cm):
+    cmd = [exe, track, "--loop-us", str(loop_us)]
+    if eeprom:
+        cmd += ["--eeprom", eeprom]
+    if split_cm:
+        cmd += ["--split", str(split_cm)]
+    out = subprocess.run(cmd, capture_output=True, text=True).stdout
+    return {k: float(v) for k, v in re.findall(r"^(\w+)=([-\d.]+)$", out, re.M)}
+
+
+def score_run(r, limit_s, goal_cm, split):
+    if split:
+        done, lap = r.get("split_s", -1) >= 0, r.get("split_s", -1)
+        off = r.get("split_offline_s", 0) if done else r.get("offline_s", 0)
+    else:
+        done, lap = r.get("finished", 0) == 1, r.get("lap_s", 0)
+        off = r.get("offline_s", 0)
+    if not done:
+        lap = limit_s + UNFINISHED_S * (1 - min(1.0, r.get("progress_cm", 0) / goal_cm))
+    return lap + W_OFFLINE * off + W_COLLISION * r.get("collisions", 0)
+
+
+def evaluate(cand, args, limit_s, goal_cm):
+    """返回 (得分, 各次原始结果)；编译失败得分为 inf。"""
+    workdir = tempfile.mkdtemp(prefix="tune_")
+    try:
+        try:
+            exe = build(cand, workdir, args.cxx, args.flags)
+        except subprocess.CalledProcessError as e:
+            sys.stderr.write(e.stderr.decode(errors="replace")[-2000:])
+            return float("inf"), []
+        scores, runs = [], []
+        for lu in args.loop_us:
+            eeprom = os.path.join(workdir, "eeprom_%d.bin" % lu) if args.race else None
+            r = run_sim(exe, args.track, lu, eeprom, args.split)
+            if args.race:
+                r = run_sim(exe, args.track, lu, eeprom, args.split)  # 学习之后的比赛圈
+            scores.append(score_run(r, limit_s, goal_cm, args.split))
+            runs.append(r)
+        return sum(scores) / len(scores), runs
+    finally:
+        shutil.rmtree(workdir, ignore_errors=True)
+
+
+def mutate(base, names, sigma, rng):
+    cand = {}
+    for name, _, lo, hi, _ in PARAMS:
+        if name not in names:
+            continue
+        v = base[name] + rng.gauss(0, sigma * (hi - lo))
+        cand[name] = int(round(min(hi, max(lo, v))))
+    return cand
+
+
+def arc_of(pts, x, y):
+    """点 (x, y) 投影到折线上最近处的弧长。"""
+    best, best_d, s = 0.0, float("inf"), 0.0
+    for (x0, y0), (x1, y1) in zip(pts, pts[1:]):
+        dx, dy = x1 - x0, y1 - y0
+        seg = (dx * dx + dy * dy) ** 0.5
+        t = 0.0 if seg == 0 else min(1.0, max(0.0, ((x - x0) * dx + (y - y0) * dy) / (seg * seg)))
+        d = ((x0 + t * dx - x) ** 2 + (y0 + t * dy - y) ** 2) ** 0.5
+        if d < best_d:
+            best, best_d = s + t * seg, d
+        s += seg
+    return best
+
+
+def track_info(track):
+    """返回 (limit 秒, path 折线总长 cm, {赛道元素: 第一处的弧长 cm})。"""
+    text = open(track, encoding="utf-8").read()
+    m = re.search(r"^limit\s+([\d.]+)", text, re.M)
+    pts = []
+    for line in re.findall(r"^path\s+(.*)$", text, re.M):
+        nums = [float(x) for x in line.split("#")[0].split()]
+        pts += list(zip(nums[0::2], nums[1::2]))
+    length = sum(((x1 - x0) ** 2 + (y1 - y0) ** 2) ** 0.5 for (x0, y0), (x1, y1) in zip(pts, pts[1:]))
+    first = {}
+    for line in re.findall(r"^gap\s+(.*)$", text, re.M):
+        first["gap"] = min(first.get("gap", float("inf")), float(line.split()[0]))
+    for line in re.findall(r"^obstacle\s+(.*)$", text, re.M):
+        x, y = (float(v) for v in line.split()[:2])
+        first["obstacle"] = min(first.get("obstacle", float("inf")), arc_of(pts, x, y))
+    return (float(m.group(1)) if m else 120.0), max(1.0, length), first
+
+
+def exercised(goal_cm, first):
+    """计分范围内起作用的参数：分段点之前没有对应赛道元素的不搜。"""
+    return [name for name, _, _, _, feature in PARAMS if feature is None or first.get(feature, float("inf")) < goal_cm]
+
+
+def summary(runs, split):
+    key = "split_s" if split else "lap_s"
+    laps = [r[key] for r in runs if (r.get("split_s", -1) >= 0 if split else r.get("finished") == 1)]
+    mean = sum(laps) / len(laps) if laps else float("nan")
+    off = sum(r.get("split_offline_s" if split else "offline_s", 0) for r in runs) / max(1, len(runs))
+    coll = sum(int(r.get("collisions", 0)) for r in runs)
+    return "%s %d/%d  %s %.3fs  offline %.2fs  collisions %d" % (
+        "split" if split else "finished", len(laps), len(runs), key[:-2], mean, off, coll)
+
+
+def write_header(path, best, names, score, start_score, args):
+    defaults = {name: d for name, d, _, _, _ in PARAMS}
+    lines = [
+        "#pragma once",
+        "",
+        "// 参数覆盖：由 tools/tune.py 在主机仿真赛道上搜索后生成，重新生成会覆盖本文件，不要手改。",
+        "// 只在 -DTUNED_PARAMS 时包含（[env:sim] 打开，板上实测确认之前不用）。",
+        "// 这里没有的参数用各自定义处的默认值；build_flags 里的 -D 优先于这里。",
+        "// 可调参数：LINE_KP LINE_KD（linepd.h）、GOV_TOP_SPEED（governor.h）、",
+        "// SEARCH_TURN TURN_STRONG GAP_DETECT_MS OBST_STANDOFF OBST_STOP_MS（main.cpp）",
+        "//",
+        "// 本次搜索：%s" % " ".join(names),
+        "// %s  %s  loop-us %s%s  seed %d" % (datetime.date.today().isoformat(), os.path.relpath(args.track, ROOT),
+                                              ",".join(map(str, args.loop_us)), "  race" if args.race else "", args.seed),
+        "// 计分：%s" % ("到弧长 %g cm 的分段时间" % args.split if args.split else "圈速"),
+        "// 得分 %.3f -> %.3f" % (start_score, score),
+        "",
+    ]
+    for name in names:
+        if best[name] == defaults[name]:
+            continue
+        lines += ["#ifndef %s" % name, "#define %s %d" % (name, best[name]), "#endif"]
+    with open(path, "w", encoding="utf-8") as f:
+        f.write("\n".join(lines) + "\n")
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("track")
+    ap.add_argument("--gens", type=int, default=10, help="代数")
+    ap.add_argument("--lambda", dest="lam", type=int, default=0, help="每代候选数（默认等于 --jobs，至少 4）")
+    ap.add_argument("--jobs", type=int, default=os.cpu_count() or 1, help="并行进程数")
+    # loop 耗时稀了容易调出只在这几个点上能跑完的参数
+    ap.add_argument("--loop-us", default=",".join(str(us) for us in range(200, 3001, 200)),
+                    type=lambda s: [int(x) for x in s.split(",")], help="逗号分隔的 loop 耗时（us）")
+    ap.add_argument("--race", action="store_true", help="每个 loop 耗时先学习一圈，按比赛圈计分")
+    ap.add_argument("--split", type=float, default=0, help="按首次走到赛道弧长 CM 处的时间计分，代替圈速")
+    ap.add_argument("--sigma", type=float, default=0.15, help="初始步长（参数范围的比例）")
+    ap.add_argument("--seed", type=int, default=1)
+    ap.add_argument("--out", default=HEADER)
+    ap.add_argument("--cxx", default=os.environ.get("CXX", "c++"))
+    args = ap.parse_args()
+
+    args.track = os.path.abspath(args.track)
+    args.flags = sim_flags()
+    lam = args.lam or max(4, args.jobs)
+    limit_s, path_cm, first = track_info(args.track)
+    goal_cm = args.split or path_cm
+    names = exercised(goal_cm, first)
+    rng = random.Random(args.seed)
+
+    best = {name: d for name, d, _, _, _ in PARAMS if name in names}
+    best.update({k: v for k, v in read_header(args.out).items() if k in best})
+    sigma = args.sigma
+    print("tuning " + " ".join(names), flush=True)
+
+    with concurrent.futures.ThreadPoolExecutor(max_workers=args.jobs) as pool:
+        start_score, runs = evaluate(best, args, limit_s, goal_cm)
+        best_score = start_score
+        print("start  %.3f  %s" % (start_score, summary(runs, args.split)), flush=True)
+
+        for gen in range(1, args.gens + 1):
+            cands = [mutate(best, names, sigma, rng) for _ in range(lam)]
+            results = list(pool.map(lambda c: evaluate(c, args, limit_s, goal_cm), cands))
+            wins = 0
+            for cand, (score, runs) in zip(cands, results):
+                if score < best_score:
+                    best, best_score, best_runs = cand, score, runs
+                    wins += 1
+            # 1/5 成功率规则
+            sigma *= 1.5 if wins * 5 > lam else 0.82
+            sigma = min(0.5, max(0.01, sigma))
+            print("gen %2d  best %.3f  sigma %.3f  %s" % (gen, best_score, sigma,
+                  summary(best_runs, args.split) if wins else "(no improvement)"), flush=True)
+
+    print("best: " + " ".join("%s=%d" % (n, best[n]) for n in names))
+    if best_score < start_score:
+        write_header(args.out, best, names, best_score, start_score, args)
+        print("wrote %s" % os.path.relpath(args.out, ROOT))
+    else:
+        print("no improvement over start, %s unchanged" % os.path.relpath(args.out, ROOT))
+
+
+if __name__ == "__main__":
+    main()